@@ -0,0 +1,199 @@
+/*
+ * ADBHelper.cpp
+ * Copyright (C) 2019-2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ADBHelper.h"
+
+#if defined(RASPBERRY_PI) || defined(ESP32)
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static bool ADB_valid(const ADB_header_t *hdr, size_t size)
+{
+  uint64_t disp_end = (uint64_t) hdr->disp_offset + (uint64_t) hdr->buckets * sizeof(uint16_t);
+  uint64_t slot_end = (uint64_t) hdr->slot_offset + (uint64_t) hdr->count * sizeof(ADB_slot_t);
+  uint64_t str_end  = (uint64_t) hdr->str_offset  + hdr->str_size;
+
+  return hdr->magic   == ADB_MAGIC   &&
+         hdr->version == ADB_VERSION &&
+         hdr->fields  == ADB_FIELDS  &&
+         hdr->count > 0 && hdr->buckets > 0 && hdr->str_size > 0 &&
+         disp_end <= size && slot_end <= size && str_end <= size;
+}
+
+#if defined(RASPBERRY_PI)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Nothing is read at open: the pages come in as lookups touch them */
+bool ADB_open(ADB_t *adb, const char *path)
+{
+  struct stat st;
+  void *map;
+  int fd;
+
+  adb->disp     = NULL;
+  adb->map      = NULL;
+  adb->map_size = 0;
+
+  if ((fd = open(path, O_RDONLY)) < 0) {
+    return false;
+  }
+
+  if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(ADB_header_t)) {
+    close(fd);
+    return false;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  memcpy(&adb->hdr, map, sizeof(ADB_header_t));
+
+  if (!ADB_valid(&adb->hdr, st.st_size)) {
+    printf("%s: not an aircraft database of this version\n", path);
+    munmap(map, st.st_size);
+    return false;
+  }
+
+  adb->map      = (const uint8_t *) map;
+  adb->map_size = st.st_size;
+  adb->disp     = (const uint16_t *) (adb->map + adb->hdr.disp_offset);
+
+  return true;
+}
+
+static bool ADB_read(ADB_t *adb, uint32_t offset, void *buf, size_t size)
+{
+  memcpy(buf, adb->map + offset, size);
+  return true;
+}
+
+void ADB_close(ADB_t *adb)
+{
+  if (adb->map != NULL) {
+    munmap((void *) adb->map, adb->map_size);
+  }
+  adb->map  = NULL;
+  adb->disp = NULL;
+}
+
+#else
+
+#include <SD.h>
+
+/* The bucket table is kept in RAM: half a byte per aircraft */
+bool ADB_open(ADB_t *adb, const char *path)
+{
+  size_t size;
+
+  adb->disp     = NULL;
+  adb->disp_buf = NULL;
+
+  adb->file = SD.open(path, FILE_READ);
+  if (!adb->file) {
+    return false;
+  }
+
+  size = adb->file.size();
+
+  if (adb->file.read((uint8_t *) &adb->hdr, sizeof(ADB_header_t)) != sizeof(ADB_header_t) ||
+      !ADB_valid(&adb->hdr, size)) {
+    adb->file.close();
+    return false;
+  }
+
+  adb->disp_buf = (uint16_t *) malloc(adb->hdr.buckets * sizeof(uint16_t));
+
+  if (adb->disp_buf == NULL ||
+      !adb->file.seek(adb->hdr.disp_offset) ||
+      adb->file.read((uint8_t *) adb->disp_buf, adb->hdr.buckets * sizeof(uint16_t)) !=
+        adb->hdr.buckets * sizeof(uint16_t)) {
+    ADB_close(adb);
+    return false;
+  }
+  adb->disp = adb->disp_buf;
+
+  return true;
+}
+
+static bool ADB_read(ADB_t *adb, uint32_t offset, void *buf, size_t size)
+{
+  return adb->file.seek(offset) && adb->file.read((uint8_t *) buf, size) == size;
+}
+
+void ADB_close(ADB_t *adb)
+{
+  if (adb->file) {
+    adb->file.close();
+  }
+  if (adb->disp_buf != NULL) {
+    free(adb->disp_buf);
+  }
+  adb->disp_buf = NULL;
+  adb->disp     = NULL;
+}
+
+#endif /* RASPBERRY_PI */
+
+/* Two reads: the slot, then the label asked for */
+bool ADB_query(ADB_t *adb, uint32_t id, uint8_t field, char *buf, size_t size)
+{
+  const ADB_header_t *hdr = &adb->hdr;
+  ADB_slot_t slot;
+  char label[ADB_LABEL_MAX + 1];
+
+  if (!ADB_is_open(adb) || field >= ADB_FIELDS || size == 0) {
+    return false;
+  }
+
+  uint16_t disp = adb->disp[ADB_hash(id, hdr->seed) % hdr->buckets];
+  uint32_t index = ADB_slot(hdr, id, disp);
+
+  if (!ADB_read(adb, hdr->slot_offset + index * sizeof(ADB_slot_t), &slot, sizeof(slot)) ||
+      slot.id != id || slot.label[field] >= hdr->str_size) {
+    return false;
+  }
+
+  size_t len = hdr->str_size - slot.label[field];
+  len = len > ADB_LABEL_MAX ? ADB_LABEL_MAX : len;
+
+  if (!ADB_read(adb, hdr->str_offset + slot.label[field], label, len)) {
+    return false;
+  }
+  label[len] = 0;
+
+  if (label[0] == 0) {
+    return false;
+  }
+
+  strncpy(buf, label, size - 1);
+  buf[size - 1] = 0;
+
+  return true;
+}
+
+#endif /* RASPBERRY_PI || ESP32 */
@@ -0,0 +1,108 @@
+/*
+ * ADBHelper.h
+ * Copyright (C) 2019-2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBHELPER_H
+#define ADBHELPER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ESP32)
+#include <FS.h>
+#endif /* ESP32 */
+
+/*
+ * Compiled aircraft database (.adb), read-only, little-endian:
+ *
+ *   ADB_header_t
+ *   uint16_t      disp[buckets]        displacement of each hash bucket
+ *   ADB_slot_t    slot[count]          one per aircraft, minimal perfect hash
+ *   char          strings[str_size]    NUL-terminated, each one stored once
+ *
+ * An ID goes to bucket ADB_hash(id, seed) % buckets and to slot
+ * ADB_hash(id, seed + (disp + 1) * ADB_HASH_STEP) % count. The slot
+ * has the ID, to tell an aircraft that is not there, and where its
+ * labels are - in the order of idpref: registration, tail, model.
+ * Built by software/utils/adb from the SQLite tables.
+ */
+#define ADB_MAGIC         0x42444153  /* "SADB" */
+#define ADB_VERSION       1
+#define ADB_FIELDS        3
+#define ADB_HASH_STEP     0x9E3779B9
+
+#define ADB_LABEL_MAX     64          /* longest string read on a lookup */
+
+typedef struct ADB_header_struct {
+  uint32_t  magic;
+  uint16_t  version;
+  uint16_t  fields;
+  uint32_t  count;
+  uint32_t  buckets;
+  uint32_t  seed;
+  uint32_t  disp_offset;
+  uint32_t  slot_offset;
+  uint32_t  str_offset;
+  uint32_t  str_size;
+} ADB_header_t;
+
+typedef struct ADB_slot_struct {
+  uint32_t  id;
+  uint32_t  label[ADB_FIELDS];        /* offsets into the strings */
+} ADB_slot_t;
+
+typedef struct ADB_struct {
+  ADB_header_t    hdr;
+  const uint16_t  *disp;
+#if defined(RASPBERRY_PI)
+  const uint8_t   *map;               /* the whole file */
+  size_t          map_size;
+#elif defined(ESP32)
+  File            file;
+  uint16_t        *disp_buf;
+#endif
+} ADB_t;
+
+static inline uint32_t ADB_hash(uint32_t id, uint32_t seed)
+{
+  uint32_t h = id ^ seed;
+
+  h ^= h >> 16;
+  h *= 0x85EBCA6B;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35;
+  h ^= h >> 16;
+
+  return h;
+}
+
+static inline uint32_t ADB_slot(const ADB_header_t *hdr, uint32_t id, uint16_t disp)
+{
+  return ADB_hash(id, hdr->seed + (disp + 1) * ADB_HASH_STEP) % hdr->count;
+}
+
+#if defined(RASPBERRY_PI) || defined(ESP32)
+
+bool ADB_open(ADB_t *, const char *);
+bool ADB_query(ADB_t *, uint32_t, uint8_t, char *, size_t);
+void ADB_close(ADB_t *);
+
+#define ADB_is_open(adb)  ((adb)->disp != NULL)
+
+#endif /* RASPBERRY_PI || ESP32 */
+
+#endif /* ADBHELPER_H */
@@ -0,0 +1,245 @@
+/*
+ * BenchHelper.cpp
+ * Copyright (C) 2019-2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined(RASPBERRY_PI) && defined(USE_EPD_CANVAS)
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <TimeLib.h>
+
+#include "SoCHelper.h"
+#include "EEPROMHelper.h"
+#include "NMEAHelper.h"
+#include "TrafficHelper.h"
+#include "EPDHelper.h"
+#include "BenchHelper.h"
+
+#include "SkyView.h"
+
+/*
+ * Host side benchmark of the e-paper views, drawn into the in-memory
+ * 2.7" panel:
+ *
+ *   ./SkyView-host --bench [--frames=DIR] [views[:FRAMES]]
+ *
+ * One frame per call with none, one, about half and all of the traffic
+ * slots in use. The traffic turns a degree around own ship every frame,
+ * so that the views have something new to draw. A view leaves the panel
+ * alone when nothing it shows has changed, so the percentiles are of the
+ * frames that refreshed it. --frames saves the last frame of each run.
+ */
+
+static const char *Bench_frames;
+
+static const struct {
+  const char    *name;
+  void          (*loop)();
+} Bench_view[] = {
+  { "radar",   EPD_radar_loop },
+  { "text",    EPD_text_loop  },
+};
+
+#define BENCH_VIEWS (sizeof(Bench_view) / sizeof(Bench_view[0]))
+
+static uint64_t Bench_ns()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void Bench_report(const char *name, unsigned long items, uint64_t ns)
+{
+  double secs = ns / 1e9;
+
+  printf("%-16s %10lu items %8.3f s %12.0f items/s %8.1f ns/item\n",
+         name, items, secs, items / secs, (double) ns / items);
+}
+
+static int Bench_cmp_ns(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a;
+  uint32_t y = *(const uint32_t *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* A fix for isValidGNSSFix() to hold for a few more seconds */
+static void Bench_GNSS_fix()
+{
+  static const char fix[] =
+    "$GPGGA,120000.00,5600.000,N,03800.000,E,1,08,1.0,1000.0,M,14.0,M,,*5A\r\n"
+    "$GPRMC,120000.00,A,5600.000,N,03800.000,E,0.0,90.0,010121,,,A*6F\r\n";
+
+  NMEA_Feed(fix, sizeof(fix) - 1);
+}
+
+static void Bench_View_traffic(int aircraft, unsigned long frame)
+{
+  for (int i = 0; i < MAX_TRACKING_OBJECTS; i++) {
+    traffic_t *fop = &Container[i];
+
+    if (i >= aircraft) {
+      *fop = EmptyFO;
+      continue;
+    }
+
+    /* all of them inside of the default radar range, above, level and below */
+    float distance = 300 + 1500 * (i + 1) / MAX_TRACKING_OBJECTS;
+    float bearing  = radians((40 * i + frame) % 360);
+
+    fop->timestamp        = now();
+    fop->ID               = 0x100000 + i;
+    fop->IDType           = ADDR_TYPE_ICAO;
+    fop->AcftType         = 1;
+    fop->Track            = (40 * i + frame + 90) % 360;
+    fop->GroundSpeed      = 50;
+    fop->RelativeNorth    = distance * cos(bearing);
+    fop->RelativeEast     = distance * sin(bearing);
+    fop->RelativeVertical = 100 * (i % 3 - 1);
+  }
+}
+
+void Bench_Views(unsigned long frames)
+{
+  const int load[] = { 0, 1, MAX_TRACKING_OBJECTS / 2, MAX_TRACKING_OBJECTS };
+  uint32_t *ns;
+
+  if (frames == 0) {
+    return;
+  }
+
+  ns = (uint32_t *) calloc(frames, sizeof(uint32_t));
+
+  /* the settings of the Pi, less its hardware */
+  SoC = &RPi_ops;
+  RPi_defaults();
+  settings->connection = CON_NONE;
+  hw_info.display      = DISPLAY_EPD_2_7;
+
+  /* as EPD_setup() has it, less the splash screen */
+  SoC->EPD_setup();
+  display->init();
+  display->setRotation(0);
+  display->setTextColor(GxEPD_BLACK);
+  display->epd2.rotation = display->getRotation();
+
+  EPD_radar_setup();
+  EPD_text_setup();
+
+  /* the input counts as connected only this far into the run */
+  if (millis() <= DATA_TIMEOUT) {
+    delay(DATA_TIMEOUT + 1 - millis());
+  }
+
+  for (size_t v = 0; v < BENCH_VIEWS; v++) {
+    for (size_t l = 0; l < sizeof(load) / sizeof(load[0]); l++) {
+      uint32_t refreshes = display->epd2.frames;
+      uint64_t pixels    = display->epd2.refreshed_pixels;
+      uint64_t total     = 0;
+      unsigned long drawn = 0;
+      char name[24];
+
+      EPD_display_frontpage = false;
+
+      for (unsigned long f = 0; f < frames; f++) {
+        uint32_t before = display->epd2.frames;
+        uint64_t start, elapsed;
+
+        Bench_GNSS_fix();
+        Bench_View_traffic(load[l], f);
+
+        /* a view draws at most every 2 seconds: these have passed */
+        EPDTimeMarker = millis() - 2001;
+
+        start = Bench_ns();
+        Bench_view[v].loop();
+        elapsed = Bench_ns() - start;
+        total  += elapsed;
+
+        if (display->epd2.frames != before) {
+          ns[drawn++] = elapsed;
+        }
+      }
+
+      refreshes = display->epd2.frames - refreshes;
+      pixels    = display->epd2.refreshed_pixels - pixels;
+
+      snprintf(name, sizeof(name), "%s/%d", Bench_view[v].name, load[l]);
+      Bench_report(name, frames, total);
+
+      if (drawn > 0) {
+        qsort(ns, drawn, sizeof(uint32_t), Bench_cmp_ns);
+        printf("%-16s %10lu drawing p50 %7u p90 %7u max %8u ns,",
+               "", drawn, ns[drawn * 50 / 100], ns[drawn * 90 / 100],
+               ns[drawn - 1]);
+      } else {
+        printf("%-16s %10s drawing,", "", "none");
+      }
+      printf(" %u refreshes %6.0f pixels each, hash %08x\n",
+             refreshes, refreshes ? (double) pixels / refreshes : 0.0,
+             display->epd2.hash());
+
+      if (Bench_frames) {
+        char path[PATH_MAX];
+
+        snprintf(path, sizeof(path), "%s/%s-%d.pbm",
+                 Bench_frames, Bench_view[v].name, load[l]);
+        if (!display->epd2.save(path, display->epd2.rotation)) {
+          perror(path);
+        }
+      }
+    }
+  }
+
+  free(ns);
+
+  for (int i = 0; i < MAX_TRACKING_OBJECTS; i++) {
+    Container[i] = EmptyFO;
+  }
+}
+
+int Bench_main(int argc, char *argv[])
+{
+  unsigned long frames = BENCH_VIEWS_FRAMES;
+
+  for (int j = 0; j < argc; j++) {
+    if (!strncmp(argv[j], "--frames=", 9)) {
+      Bench_frames = argv[j] + 9;
+    } else if (!strcmp(argv[j], "views")) {
+      /* the default count */
+    } else if (!strncmp(argv[j], "views:", 6)) {
+      frames = strtoul(argv[j] + 6, NULL, 0);
+    } else {
+      fprintf(stderr, "Unknown benchmark: %s\n", argv[j]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  Bench_Views(frames);
+
+  return EXIT_SUCCESS;
+}
+
+#endif /* RASPBERRY_PI && USE_EPD_CANVAS */
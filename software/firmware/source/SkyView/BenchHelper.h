@@ -0,0 +1,32 @@
+/*
+ * BenchHelper.h
+ * Copyright (C) 2019-2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHHELPER_H
+#define BENCHHELPER_H
+
+#if defined(RASPBERRY_PI) && defined(USE_EPD_CANVAS)
+
+/* frames per view and traffic load */
+#define BENCH_VIEWS_FRAMES      1000
+
+int  Bench_main(int, char *[]);
+void Bench_Views(unsigned long);
+
+#endif /* RASPBERRY_PI && USE_EPD_CANVAS */
+
+#endif /* BENCHHELPER_H */
@@ -37,6 +37,7 @@
 #define maxof2(a,b)             (a > b ? a : b)
 
 #define EPD_RADAR_V_THRESHOLD   50      /* metres */
+#define EPD_RADAR_GLYPH_HALF    8       /* pixels, glyph extent from centre */
 
 #define TEXT_VIEW_LINE_LENGTH   13      /* characters */
 #define TEXT_VIEW_LINE_SPACING  15      /* pixels */
@@ -53,6 +54,23 @@ typedef struct navbox_struct
   uint32_t  timestamp;
 } navbox_t;
 
+enum
+{
+  EPD_GLYPH_LEVEL,
+  EPD_GLYPH_LEVEL_TEAM,
+  EPD_GLYPH_ABOVE,
+  EPD_GLYPH_ABOVE_TEAM,
+  EPD_GLYPH_BELOW,
+  EPD_GLYPH_BELOW_TEAM
+};
+
+typedef struct radar_glyph_struct
+{
+  int16_t   x;
+  int16_t   y;
+  uint8_t   shape;
+} radar_glyph_t;
+
 byte EPD_setup(bool);
 void EPD_loop();
 void EPD_fini(const char *);
@@ -74,7 +92,15 @@ void EPD_text_next();
 void EPD_text_prev();
 void EPD_text_Draw_Message(const char *, const char *);
 
-extern GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> *display;
+#if defined(USE_EPD_CANVAS)
+#include "../SoftRF/src/driver/Canvas.h"
+
+typedef GxEPD2_BW<EPD_Canvas, EPD_Canvas::HEIGHT> EPD_display_t;
+#else
+typedef GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> EPD_display_t;
+#endif /* USE_EPD_CANVAS */
+
+extern EPD_display_t *display;
 extern unsigned long EPDTimeMarker;
 extern bool EPD_display_frontpage;
 
@@ -326,6 +326,15 @@ void NMEA_loop()
   }
 }
 
+/* Sentences from other than the connection, as the bench has them */
+void NMEA_Feed(const char *buf, size_t size)
+{
+  for (size_t i=0; i < size; i++) {
+    NMEA_Parse_Character(buf[i]);
+  }
+  NMEA_TimeMarker = millis();
+}
+
 bool NMEA_isConnected()
 {
   return (NMEA_TimeMarker > DATA_TIMEOUT &&
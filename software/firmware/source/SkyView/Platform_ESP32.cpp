@@ -29,6 +29,7 @@
 #include "EEPROMHelper.h"
 #include "WiFiHelper.h"
 #include "BluetoothHelper.h"
+#include "ADBHelper.h"
 
 #include "SkyView.h"
 
@@ -115,6 +116,9 @@ static sqlite3 *fln_db  = NULL;
 static sqlite3 *ogn_db  = NULL;
 static sqlite3 *icao_db = NULL;
 
+/* compiled database of settings->adb, when there is one on the card */
+static ADB_t ESP32_ADB;
+
 static uint8_t sdcard_files_to_open = 0;
 
 SPIClass SPI1(HSPI);
@@ -415,6 +419,14 @@ static bool ESP32_DB_init()
     return rval;
   }
 
+  const char *adb_path = settings->adb == DB_FLN  ? "/Aircrafts/fln.adb"  :
+                         settings->adb == DB_OGN  ? "/Aircrafts/ogn.adb"  :
+                         settings->adb == DB_ICAO ? "/Aircrafts/icao.adb" : NULL;
+
+  if (adb_path != NULL && ADB_open(&ESP32_ADB, adb_path)) {
+    return true;
+  }
+
   sqlite3_initialize();
 
   if (settings->adb == DB_FLN) {
@@ -466,6 +478,11 @@ static bool ESP32_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     return false;
   }
 
+  if (ADB_is_open(&ESP32_ADB)) {
+    return type == settings->adb &&
+           ADB_query(&ESP32_ADB, id, settings->idpref, buf, size);
+  }
+
   switch (type)
   {
   case DB_OGN:
@@ -564,6 +581,8 @@ static void ESP32_DB_fini()
   if (settings->adapter == ADAPTER_TTGO_T5S) {
 
     if (settings->adb != DB_NONE) {
+      ADB_close(&ESP32_ADB);
+
       if (fln_db != NULL) {
         sqlite3_close(fln_db);
       }
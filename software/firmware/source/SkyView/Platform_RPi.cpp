@@ -25,6 +25,11 @@
  *
  *  pi@raspberrypi $ sudo ./SkyView
  *
+ *  The views drawn into an in-memory panel on any Linux host, timed:
+ *
+ *  $ make -f Makefile.RPi host
+ *  $ ./SkyView-host --bench views:200 --frames=/tmp/views
+ *
  */
 
 #if defined(RASPBERRY_PI)
@@ -45,6 +50,8 @@
 #include "JSONHelper.h"
 #include "EPDHelper.h"
 #include "OLEDHelper.h"
+#include "ADBHelper.h"
+#include "BenchHelper.h"
 
 #include "SkyView.h"
 
@@ -58,9 +65,13 @@ TTYSerial SerialInput("/dev/ttyACM0");
 
 static const uint8_t SS    = 8; // pin 24
 
+#if defined(USE_EPD_CANVAS)
+EPD_display_t epd_canvas((EPD_Canvas()));
+#else
 /* Waveshare Pi HAT 2.7" */
-GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> epd_waveshare(GxEPD2_270(/*CS=*/ SS,
+EPD_display_t epd_waveshare(GxEPD2_270(/*CS=*/ SS,
                                        /*DC=*/ 25, /*RST=*/ 17, /*BUSY=*/ 24));
+#endif /* USE_EPD_CANVAS */
 
 Adafruit_SSD1306 odisplay(SCREEN_WIDTH, SCREEN_HEIGHT,
   &SPI, /*DC=*/ 25, /*RST=*/ 17, /*CS=*/ SS);
@@ -101,6 +112,15 @@ static sqlite3 *fln_db;
 static sqlite3 *ogn_db;
 static sqlite3 *icao_db;
 
+/* compiled databases, when there are: looked up instead of SQLite */
+static ADB_t RPi_ADB[DB_ICAO + 1];
+
+/* one per database and idpref column, the ID is a bound parameter */
+static sqlite3_stmt *RPi_DB_stmt[DB_ICAO + 1][ID_MAM + 1];
+static DB_cache_t RPi_DB_cache[DB_CACHE_SIZE];
+static uint8_t RPi_DB_idpref = ID_REG;
+static DB_stats_t RPi_DB_stats;
+
 std::string input_line;
 
 //-------------------------------------------------------------------------
@@ -179,7 +199,7 @@ void RPi_SerialNumber(void)
 
 //----- end of MIT License ------------------------------------------------
 
-static void RPi_setup()
+void RPi_defaults()
 {
   eeprom_block.field.settings.adapter         = ADAPTER_WAVESHARE_PI_HAT_2_7;
 
@@ -202,7 +222,11 @@ static void RPi_setup()
   eeprom_block.field.settings.filter          = TRAFFIC_FILTER_OFF;
   eeprom_block.field.settings.power_save      = POWER_SAVE_NONE;
   eeprom_block.field.settings.team            = 0;
+}
 
+static void RPi_setup()
+{
+  RPi_defaults();
   RPi_SerialNumber();
 }
 
@@ -234,7 +258,11 @@ static float RPi_Battery_voltage()
 
 static void RPi_EPD_setup()
 {
+#if defined(USE_EPD_CANVAS)
+  display = &epd_canvas;
+#else
   display = &epd_waveshare;
+#endif /* USE_EPD_CANVAS */
 }
 
 static size_t RPi_WiFi_Receive_UDP(uint8_t *buf, size_t max_size)
@@ -249,6 +277,10 @@ static int RPi_WiFi_clients_count()
 
 static bool RPi_DB_init()
 {
+  ADB_open(&RPi_ADB[DB_FLN],  "Aircrafts/fln.adb");
+  ADB_open(&RPi_ADB[DB_OGN],  "Aircrafts/ogn.adb");
+  ADB_open(&RPi_ADB[DB_ICAO], "Aircrafts/icao.adb");
+
   sqlite3_open("Aircrafts/fln.db", &fln_db);
 
   if (fln_db == NULL)
@@ -279,12 +311,9 @@ static bool RPi_DB_init()
   return true;
 }
 
-static bool RPi_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
+/* Prepared once, on first use */
+static sqlite3_stmt *RPi_DB_statement(uint8_t type)
 {
-  sqlite3_stmt *stmt;
-  char *query = NULL;
-  int error;
-  bool rval = false;
   const char *reg_key, *db_key;
   sqlite3 *db;
 
@@ -341,47 +370,131 @@ static bool RPi_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     }
     db_key  = "aircrafts";
     db      = fln_db;
+    type    = DB_FLN;
     break;
   }
 
-  if (db == NULL) {
-    return false;
+  uint8_t column = settings->idpref > ID_MAM ? ID_REG : settings->idpref;
+  sqlite3_stmt **stmt = &RPi_DB_stmt[type][column];
+
+  if (*stmt == NULL && db != NULL) {
+    char query[64];
+
+    snprintf(query, sizeof(query), "select %s from %s where id = ?1", reg_key, db_key);
+
+    if (sqlite3_prepare_v2(db, query, -1, stmt, NULL) != SQLITE_OK) {
+      *stmt = NULL;
+    }
   }
 
-  error = asprintf(&query, "select %s from %s where id = %d",reg_key, db_key, id);
+  return *stmt;
+}
 
-  if (error == -1) {
+static bool RPi_DB_copy(DB_cache_t *entry, char *buf, size_t size)
+{
+  if (!entry->found || size == 0) {
     return false;
   }
 
-  sqlite3_prepare_v2(db, query, strlen(query), &stmt, NULL);
+  strncpy(buf, entry->label, size - 1);
+  buf[size - 1] = 0;
 
-  while (sqlite3_step(stmt) != SQLITE_DONE) {
-    if (sqlite3_column_type(stmt, 0) == SQLITE3_TEXT) {
+  return true;
+}
 
-      size_t len = strlen((char *) sqlite3_column_text(stmt, 0));
+/*
+ * Every redraw and voice message looks the same few IDs up again:
+ * they are answered from the cache, misses included, and only the
+ * least recently used entry is refilled from SQLite.
+ */
+static bool RPi_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
+{
+  DB_cache_t *victim = &RPi_DB_cache[0];
+  ADB_t *adb = &RPi_ADB[type == DB_OGN || type == DB_ICAO ? type : DB_FLN];
+  sqlite3_stmt *stmt;
 
-      if (len > 0) {
-        len = len > size ? size : len;
-        strncpy(buf, (char *) sqlite3_column_text(stmt, 0), len);
-        if (len < size) {
-          buf[len] = 0;
-        } else if (len == size) {
-          buf[len-1] = 0;
-        }
-        rval = true;
-      }
+  if (settings->idpref != RPi_DB_idpref) {
+    memset(RPi_DB_cache, 0, sizeof(RPi_DB_cache));
+    RPi_DB_idpref = settings->idpref;
+  }
+
+  uint32_t tick = ++RPi_DB_stats.lookups;
+
+  for (int i = 0; i < DB_CACHE_SIZE; i++) {
+    DB_cache_t *entry = &RPi_DB_cache[i];
+
+    if (entry->used && entry->type == type && entry->id == id) {
+      entry->used = tick;
+      RPi_DB_stats.hits++;
+      return RPi_DB_copy(entry, buf, size);
+    }
+    if (entry->used < victim->used) {
+      victim = entry;
     }
   }
 
-  sqlite3_finalize(stmt);
-  free(query);
+  victim->id       = id;
+  victim->type     = type;
+  victim->found    = false;
+  victim->used     = tick;
+  victim->label[0] = 0;
+
+  if (ADB_is_open(adb)) {
+    unsigned long start = micros();
+
+    victim->found = ADB_query(adb, id, settings->idpref,
+                              victim->label, sizeof(victim->label));
+
+    RPi_DB_stats.queries++;
+    RPi_DB_stats.query_us += micros() - start;
+  } else if ((stmt = RPi_DB_statement(type)) != NULL) {
+    unsigned long start = micros();
+
+    sqlite3_bind_int64(stmt, 1, id);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW &&
+        sqlite3_column_type(stmt, 0) == SQLITE3_TEXT) {
+      const char *label = (const char *) sqlite3_column_text(stmt, 0);
+
+      if (label != NULL && label[0]) {
+        strncpy(victim->label, label, sizeof(victim->label) - 1);
+        victim->label[sizeof(victim->label) - 1] = 0;
+        victim->found = true;
+      }
+    }
+    sqlite3_reset(stmt);
+
+    RPi_DB_stats.queries++;
+    RPi_DB_stats.query_us += micros() - start;
+  }
 
-  return rval;
+  return RPi_DB_copy(victim, buf, size);
 }
 
 static void RPi_DB_fini()
 {
+  for (int i = 0; i <= DB_ICAO; i++) {
+    ADB_close(&RPi_ADB[i]);
+  }
+
+  for (int i = 0; i <= DB_ICAO; i++) {
+    for (int j = 0; j <= ID_MAM; j++) {
+      if (RPi_DB_stmt[i][j] != NULL) {
+        sqlite3_finalize(RPi_DB_stmt[i][j]);
+        RPi_DB_stmt[i][j] = NULL;
+      }
+    }
+  }
+
+  if (RPi_DB_stats.lookups > 0) {
+    printf("DB: %u lookups, %u from cache, %u queries",
+           RPi_DB_stats.lookups, RPi_DB_stats.hits, RPi_DB_stats.queries);
+    if (RPi_DB_stats.query_us > 0) {
+      printf(" at %.0f queries/s", RPi_DB_stats.queries * 1e6 / RPi_DB_stats.query_us);
+    }
+    printf("\n");
+  }
+
   if (fln_db != NULL) {
     sqlite3_close(fln_db);
   }
@@ -695,6 +808,12 @@ int main(int argc, char *argv[])
   bool isSysVinit = false;
   int opt;
 
+#if defined(USE_EPD_CANVAS)
+  if (argc > 1 && !strcmp(argv[1], "--bench")) {
+    return Bench_main(argc - 2, argv + 2);
+  }
+#endif /* USE_EPD_CANVAS */
+
   while ((opt = getopt(argc, argv, "b")) != -1) {
       switch (opt) {
       case 'b': isSysVinit = true; break;
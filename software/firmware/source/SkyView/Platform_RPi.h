@@ -30,6 +30,25 @@
 #define PCM_DEVICE              "default"
 #define WAV_FILE_PREFIX         "Audio/"
 
+/* Registration lookups: LRU cache in front of the aircraft databases */
+#define DB_CACHE_SIZE           64      /* entries */
+#define DB_LABEL_SIZE           32
+
+typedef struct DB_cache_struct {
+  uint32_t  id;
+  uint8_t   type;
+  bool      found;                      /* false for an ID not in the DB */
+  uint32_t  used;                       /* lookup count at the last hit, 0 - free */
+  char      label[DB_LABEL_SIZE];
+} DB_cache_t;
+
+typedef struct DB_stats_struct {
+  uint32_t  lookups;
+  uint32_t  hits;
+  uint32_t  queries;                    /* those that went down to SQLite */
+  uint64_t  query_us;
+} DB_stats_t;
+
 /* Waveshare Pi HAT 2.7" buttons mapping */
 #define SOC_GPIO_BUTTON_MODE    RPI_V2_GPIO_P1_29
 #define SOC_GPIO_BUTTON_UP      RPI_V2_GPIO_P1_31
@@ -38,6 +57,8 @@
 
 extern TTYSerial SerialInput;
 
+void RPi_defaults(void);
+
 #endif /* PLATFORM_RPI_H */
 
 #endif /* RASPBERRY_PI */
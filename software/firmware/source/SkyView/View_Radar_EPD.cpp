@@ -41,6 +41,14 @@ static navbox_t navbox4;
 
 static int EPD_zoom = ZOOM_MEDIUM;
 
+/* Targets drawn on the previous frame, and what it was drawn with */
+static radar_glyph_t EPD_glyphs_prev[MAX_TRACKING_OBJECTS];
+static uint8_t EPD_glyph_count_prev = 0;
+static bool    EPD_radar_valid      = false;
+static int32_t EPD_divider_prev     = 0;
+static uint8_t EPD_orientation_prev = 0;
+static int     EPD_track_prev       = 0;
+
 static void EPD_Draw_NavBoxes()
 {
   int16_t  tbx, tby;
@@ -159,6 +167,8 @@ void EPD_radar_Draw_Message(const char *msg1, const char *msg2)
     uint16_t radar_y = (display->height() - display->width()) / 2;
     uint16_t radar_w = display->width();
 
+    EPD_radar_valid = false;
+
     display->setPartialWindow(radar_x, radar_y, radar_w, radar_w);
 
     display->setFont(&FreeMonoBold18pt7b);
@@ -194,6 +204,68 @@ void EPD_radar_Draw_Message(const char *msg1, const char *msg2)
   }
 }
 
+static void EPD_Draw_Glyph(const radar_glyph_t *g)
+{
+  int16_t x = g->x;
+  int16_t y = g->y;
+
+  switch (g->shape)
+  {
+  case EPD_GLYPH_ABOVE_TEAM:
+    display->drawTriangle(x - 5, y + 4, x, y - 6, x + 5, y + 4, GxEPD_BLACK);
+    display->drawTriangle(x - 6, y + 5, x, y - 7, x + 6, y + 5, GxEPD_BLACK);
+    break;
+  case EPD_GLYPH_ABOVE:
+    display->fillTriangle(x - 4, y + 3, x, y - 5, x + 4, y + 3, GxEPD_BLACK);
+    break;
+  case EPD_GLYPH_BELOW_TEAM:
+    display->drawTriangle(x - 5, y - 4, x, y + 6, x + 5, y - 4, GxEPD_BLACK);
+    display->drawTriangle(x - 6, y - 5, x, y + 7, x + 6, y - 5, GxEPD_BLACK);
+    break;
+  case EPD_GLYPH_BELOW:
+    display->fillTriangle(x - 4, y - 3, x, y + 5, x + 4, y - 3, GxEPD_BLACK);
+    break;
+  case EPD_GLYPH_LEVEL_TEAM:
+    display->drawCircle(x, y, 6, GxEPD_BLACK);
+    display->drawCircle(x, y, 7, GxEPD_BLACK);
+    break;
+  case EPD_GLYPH_LEVEL:
+  default:
+    display->fillCircle(x, y, 5, GxEPD_BLACK);
+    break;
+  }
+}
+
+static bool EPD_Glyph_in(const radar_glyph_t *g, const radar_glyph_t *set, uint8_t count)
+{
+  for (uint8_t i = 0; i < count; i++) {
+    if (set[i].x == g->x && set[i].y == g->y && set[i].shape == g->shape) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* Grow rect (x0, y0, x1, y1) by the glyph, unless the other frame has it too */
+static void EPD_Glyph_dirty(const radar_glyph_t *g, const radar_glyph_t *other,
+                            uint8_t other_count, int16_t *rect)
+{
+  if (EPD_Glyph_in(g, other, other_count)) {
+    return;
+  }
+
+  if (g->x - EPD_RADAR_GLYPH_HALF < rect[0]) rect[0] = g->x - EPD_RADAR_GLYPH_HALF;
+  if (g->y - EPD_RADAR_GLYPH_HALF < rect[1]) rect[1] = g->y - EPD_RADAR_GLYPH_HALF;
+  if (g->x + EPD_RADAR_GLYPH_HALF > rect[2]) rect[2] = g->x + EPD_RADAR_GLYPH_HALF;
+  if (g->y + EPD_RADAR_GLYPH_HALF > rect[3]) rect[3] = g->y + EPD_RADAR_GLYPH_HALF;
+}
+
+/*
+ * Only the part of the radar where targets have come, gone or moved is
+ * refreshed, and nothing at all when none of them has. A change of scale,
+ * orientation or (track up) own course redraws the whole radar.
+ */
 static void EPD_Draw_Radar()
 {
   int16_t  tbx, tby;
@@ -201,6 +273,8 @@ static void EPD_Draw_Radar()
   uint16_t x;
   uint16_t y;
   char cog_text[6];
+  radar_glyph_t glyphs[MAX_TRACKING_OBJECTS];
+  uint8_t count = 0;
 
   /* divider is a half of full scale */
   int32_t divider = 2000; 
@@ -212,8 +286,6 @@ static void EPD_Draw_Radar()
   uint16_t radar_y = (display->height() - display->width()) / 2;
   uint16_t radar_w = display->width();
 
-  display->setPartialWindow(radar_x, radar_y, radar_w, radar_w);
-
   uint16_t radar_center_x = radar_w / 2;
   uint16_t radar_center_y = radar_y + radar_w / 2;
   uint16_t radius = radar_w / 2 - 2;
@@ -254,108 +326,95 @@ static void EPD_Draw_Radar()
     }
   }
 
-  display->firstPage();
-  do
-  {
-    for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (Container[i].ID && (now() - Container[i].timestamp) <= EPD_EXPIRATION_TIME) {
+  /* track up: one rotation by the own course for all of the targets */
+  float rot_cos = 1.0;
+  float rot_sin = 0.0;
+
+  if (settings->orientation == DIRECTION_TRACK_UP) {
+    rot_cos = cos(radians(ThisAircraft.Track));
+    rot_sin = sin(radians(ThisAircraft.Track));
+  }
 
-        float rel_x;
-        float rel_y;
-        float distance;
-        float bearing;
+  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    if (Container[i].ID && (now() - Container[i].timestamp) <= EPD_EXPIRATION_TIME) {
 
-        bool isTeam = (Container[i].ID == settings->team) ;
+      bool isTeam = (Container[i].ID == settings->team) ;
 
 #if 0
-        Serial.print(F(" ID="));
-        Serial.print((Container[i].ID >> 16) & 0xFF, HEX);
-        Serial.print((Container[i].ID >>  8) & 0xFF, HEX);
-        Serial.print((Container[i].ID      ) & 0xFF, HEX);
-        Serial.println();
-
-        Serial.print(F(" RelativeNorth=")); Serial.println(Container[i].RelativeNorth);
-        Serial.print(F(" RelativeEast="));  Serial.println(Container[i].RelativeEast);
+      Serial.print(F(" ID="));
+      Serial.print((Container[i].ID >> 16) & 0xFF, HEX);
+      Serial.print((Container[i].ID >>  8) & 0xFF, HEX);
+      Serial.print((Container[i].ID      ) & 0xFF, HEX);
+      Serial.println();
+
+      Serial.print(F(" RelativeNorth=")); Serial.println(Container[i].RelativeNorth);
+      Serial.print(F(" RelativeEast="));  Serial.println(Container[i].RelativeEast);
 #endif
-        switch (settings->orientation)
-        {
-        case DIRECTION_NORTH_UP:
-          rel_x = Container[i].RelativeEast;
-          rel_y = Container[i].RelativeNorth;
-          break;
-        case DIRECTION_TRACK_UP:
-          distance = sqrtf(Container[i].RelativeNorth * Container[i].RelativeNorth +
-                           Container[i].RelativeEast  * Container[i].RelativeEast);
-
-          bearing = atan2f(Container[i].RelativeNorth,
-                           Container[i].RelativeEast) * 180.0 / PI;  /* -180 ... 180 */
-
-          /* convert from math angle into course relative to north */
-          bearing = (bearing <= 90.0 ? 90.0 - bearing :
-                                      450.0 - bearing);
-
-          bearing -= ThisAircraft.Track;
-
-          rel_x = distance * sin(radians(bearing));
-          rel_y = distance * cos(radians(bearing));
-
-          break;
-        default:
-          /* TBD */
-          break;
-        }
+      float rel_x = Container[i].RelativeEast  * rot_cos -
+                    Container[i].RelativeNorth * rot_sin;
+      float rel_y = Container[i].RelativeNorth * rot_cos +
+                    Container[i].RelativeEast  * rot_sin;
 
-        int16_t x = constrain((rel_x * radius) / divider, -32768, 32767);
-        int16_t y = constrain((rel_y * radius) / divider, -32768, 32767);
-
-        if        (Container[i].RelativeVertical >   EPD_RADAR_V_THRESHOLD) {
-          if (isTeam) {
-            display->drawTriangle(radar_center_x + x - 5, radar_center_y - y + 4,
-                                  radar_center_x + x    , radar_center_y - y - 6,
-                                  radar_center_x + x + 5, radar_center_y - y + 4,
-                                  GxEPD_BLACK);
-            display->drawTriangle(radar_center_x + x - 6, radar_center_y - y + 5,
-                                  radar_center_x + x    , radar_center_y - y - 7,
-                                  radar_center_x + x + 6, radar_center_y - y + 5,
-                                  GxEPD_BLACK);
-          } else {
-            display->fillTriangle(radar_center_x + x - 4, radar_center_y - y + 3,
-                                  radar_center_x + x    , radar_center_y - y - 5,
-                                  radar_center_x + x + 4, radar_center_y - y + 3,
-                                  GxEPD_BLACK);
-          }
-        } else if (Container[i].RelativeVertical < - EPD_RADAR_V_THRESHOLD) {
-          if (isTeam) {
-            display->drawTriangle(radar_center_x + x - 5, radar_center_y - y - 4,
-                                  radar_center_x + x    , radar_center_y - y + 6,
-                                  radar_center_x + x + 5, radar_center_y - y - 4,
-                                  GxEPD_BLACK);
-            display->drawTriangle(radar_center_x + x - 6, radar_center_y - y - 5,
-                                  radar_center_x + x    , radar_center_y - y + 7,
-                                  radar_center_x + x + 6, radar_center_y - y - 5,
-                                  GxEPD_BLACK);
-          } else {
-            display->fillTriangle(radar_center_x + x - 4, radar_center_y - y - 3,
-                                  radar_center_x + x    , radar_center_y - y + 5,
-                                  radar_center_x + x + 4, radar_center_y - y - 3,
-                                  GxEPD_BLACK);
-          }
-        } else {
-          if (isTeam) {
-            display->drawCircle(radar_center_x + x,
-                                radar_center_y - y,
-                                6, GxEPD_BLACK);
-            display->drawCircle(radar_center_x + x,
-                                radar_center_y - y,
-                                7, GxEPD_BLACK);
-           } else {
-            display->fillCircle(radar_center_x + x,
-                                radar_center_y - y,
-                                5, GxEPD_BLACK);
-          }
-        }
+      int16_t x = constrain((rel_x * radius) / divider, -32768, 32767);
+      int16_t y = constrain((rel_y * radius) / divider, -32768, 32767);
+
+      radar_glyph_t *g = &glyphs[count++];
+
+      g->x = constrain(radar_center_x + x, -32768, 32767);
+      g->y = constrain(radar_center_y - y, -32768, 32767);
+
+      if        (Container[i].RelativeVertical >   EPD_RADAR_V_THRESHOLD) {
+        g->shape = isTeam ? EPD_GLYPH_ABOVE_TEAM : EPD_GLYPH_ABOVE;
+      } else if (Container[i].RelativeVertical < - EPD_RADAR_V_THRESHOLD) {
+        g->shape = isTeam ? EPD_GLYPH_BELOW_TEAM : EPD_GLYPH_BELOW;
+      } else {
+        g->shape = isTeam ? EPD_GLYPH_LEVEL_TEAM : EPD_GLYPH_LEVEL;
       }
     }
+  }
+
+  int16_t window[4] = { (int16_t) radar_x, (int16_t) radar_y,
+                        (int16_t) (radar_x + radar_w - 1),
+                        (int16_t) (radar_y + radar_w - 1) };
+
+  if (EPD_radar_valid &&
+      divider == EPD_divider_prev &&
+      settings->orientation == EPD_orientation_prev &&
+      (settings->orientation != DIRECTION_TRACK_UP ||
+       ThisAircraft.Track == EPD_track_prev)) {
+
+    int16_t dirty[4] = { 32767, 32767, -32768, -32768 };
+
+    for (uint8_t i = 0; i < EPD_glyph_count_prev; i++) {
+      EPD_Glyph_dirty(&EPD_glyphs_prev[i], glyphs, count, dirty);
+    }
+    for (uint8_t i = 0; i < count; i++) {
+      EPD_Glyph_dirty(&glyphs[i], EPD_glyphs_prev, EPD_glyph_count_prev, dirty);
+    }
+
+    if (dirty[0] > window[0]) window[0] = dirty[0];
+    if (dirty[1] > window[1]) window[1] = dirty[1];
+    if (dirty[2] < window[2]) window[2] = dirty[2];
+    if (dirty[3] < window[3]) window[3] = dirty[3];
+
+    if (window[0] > window[2] || window[1] > window[3]) {
+      /* the screen already shows this frame */
+      memcpy(EPD_glyphs_prev, glyphs, count * sizeof(radar_glyph_t));
+      EPD_glyph_count_prev = count;
+      return;
+    }
+  }
+
+  display->setPartialWindow(window[0], window[1],
+                            window[2] - window[0] + 1,
+                            window[3] - window[1] + 1);
+
+  display->firstPage();
+  do
+  {
+    for (uint8_t i = 0; i < count; i++) {
+      EPD_Draw_Glyph(&glyphs[i]);
+    }
 
     display->drawCircle(  radar_center_x, radar_center_y,
                           radius, GxEPD_BLACK);
@@ -434,11 +493,17 @@ static void EPD_Draw_Radar()
       /* TBD */
       break;
     }
-
   }
   while (display->nextPage());
 
   display->powerOff();
+
+  memcpy(EPD_glyphs_prev, glyphs, count * sizeof(radar_glyph_t));
+  EPD_glyph_count_prev = count;
+  EPD_divider_prev     = divider;
+  EPD_orientation_prev = settings->orientation;
+  EPD_track_prev       = ThisAircraft.Track;
+  EPD_radar_valid      = true;
 }
 
 static void EPD_Update_NavBoxes()
@@ -595,6 +660,7 @@ void EPD_radar_loop()
 
     EPD_Draw_NavBoxes();
 
+    EPD_radar_valid = false;
     EPD_display_frontpage = true;
 
   } else {
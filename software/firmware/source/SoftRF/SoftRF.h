@@ -67,6 +67,8 @@
 #define GDL90_DST_PORT    4000
 #define NMEA_UDP_PORT     10110
 #define NMEA_TCP_PORT     2000
+#define GDL90_TCP_PORT    4000
+#define D1090_TCP_PORT    30002
 
 /*
  * Serial I/O default values.
@@ -144,6 +146,13 @@ typedef struct UFO {
     uint8_t   callsign[8];
 } ufo_t;
 
+/* What the exporters report: the live tables, or a snapshot of them */
+typedef struct traffic_view_struct {
+    ufo_t     *own;
+    ufo_t     *traffic;
+    bool      fix;
+} traffic_view_t;
+
 typedef struct hardware_info {
     byte  model;
     byte  revision;
@@ -62,6 +62,9 @@
 
 #include "src/system/OTA.h"
 #include "src/system/Time.h"
+#include "src/system/Profile.h"
+#include "src/system/Coverage.h"
+#include "src/system/Capture.h"
 #include "src/driver/LED.h"
 #include "src/driver/GNSS.h"
 #include "src/driver/RF.h"
@@ -74,6 +77,7 @@
 #include "src/protocol/data/D1090.h"
 #include "src/system/SoC.h"
 #include "src/driver/WiFi.h"
+#include "src/driver/UDPOut.h"
 #include "src/ui/Web.h"
 #include "src/driver/Baro.h"
 #include "src/TTNHelper.h"
@@ -88,10 +92,9 @@
 #endif /* LOGGER_IS_ENABLED */
 
 #define DEBUG 0
-#define DEBUG_TIMING 0
 
 #define isTimeToDisplay() (millis() - LEDTimeMarker     > 1000)
-#define isTimeToExport()  (millis() - ExportTimeMarker  > 1000)
+#define isTimeToExport()  (Time_since(ExportTimeMarker) > 1000)
 
 ufo_t ThisAircraft;
 
@@ -106,7 +109,7 @@ hardware_info_t hw_info = {
 };
 
 unsigned long LEDTimeMarker = 0;
-unsigned long ExportTimeMarker = 0;
+uint64_t ExportTimeMarker = 0;
 
 void setup()
 {
@@ -177,6 +180,8 @@ void setup()
 
   Battery_setup();
   Traffic_setup();
+  Coverage_setup();
+  Capture_setup(CAPTURE_FILE);
 
   SoC->swSer_enableRx(false);
 
@@ -262,8 +267,19 @@ void loop()
     break;
   }
 
+  // Send out UDP datagrams assembled on this pass
+  UDPOut_loop();
+
+#if defined(USE_TRAFFIC_SNAPSHOT)
+  // The views draw from a snapshot of the traffic table, in every mode
+  Traffic_publish_loop();
+#endif /* USE_TRAFFIC_SNAPSHOT */
+
   // Show status info on tiny OLED display
-  SoC->Display_loop();
+  {
+    PROFILE(PROFILE_DISPLAY);
+    SoC->Display_loop();
+  }
 
   // battery status LED
   LED_loop();
@@ -281,6 +297,9 @@ void loop()
   Logger_loop();
 #endif /* LOGGER_IS_ENABLED */
 
+  Coverage_loop();
+  Capture_loop();
+
   SoC->loop();
 
   if (SoC->Bluetooth_ops) {
@@ -329,6 +348,7 @@ void shutdown(int reason)
   SoC->Display_fini(reason);
 
   RF_Shutdown();
+  Capture_fini();
 
   SoC->Button_fini();
 
@@ -380,7 +400,7 @@ void normal()
   success = true;
 #endif
 
-  if (success && isValidFix()) ParseData();
+  if (success) ParseData(isValidFix());
 
 #if defined(ENABLE_TTN)
   TTN_loop();
@@ -406,7 +426,7 @@ void normal()
     if (isValidFix()) {
       D1090_Export();
     }
-    ExportTimeMarker = millis();
+    ExportTimeMarker = Time_ms();
   }
 
   // Handle Air Connect
@@ -442,11 +462,11 @@ void uav()
 
   success = RF_Receive();
 
-  if (success && isValidMAVFix()) ParseData();
+  if (success) ParseData(isValidMAVFix());
 
   if (isTimeToExport() && isValidMAVFix()) {
     MAVLinkShareTraffic();
-    ExportTimeMarker = millis();
+    ExportTimeMarker = Time_ms();
   }
 
   ClearExpired();
@@ -475,10 +495,7 @@ void bridge()
     memcpy(fo.raw, RxBuffer, rx_size);
 
     if (settings->nmea_p) {
-      StdOut.print(F("$PSRFI,"));
-      StdOut.print((unsigned long) now());    StdOut.print(F(","));
-      StdOut.print(Bin2Hex(fo.raw, rx_size)); StdOut.print(F(","));
-      StdOut.println(RF_last_rssi);
+      RF_PrintFrame(false, fo.raw, rx_size, RF_last_utc, now(), RF_last_rssi);
     }
 
     Raw_Transmit_UDP();
@@ -506,10 +523,7 @@ void watchout()
     memcpy(fo.raw, RxBuffer, rx_size);
 
     if (settings->nmea_p) {
-      StdOut.print(F("$PSRFI,"));
-      StdOut.print((unsigned long) now());    StdOut.print(F(","));
-      StdOut.print(Bin2Hex(fo.raw, rx_size)); StdOut.print(F(","));
-      StdOut.println(RF_last_rssi);
+      RF_PrintFrame(false, fo.raw, rx_size, RF_last_utc, now(), RF_last_rssi);
     }
   }
 
@@ -528,13 +542,6 @@ unsigned long TxPosUpdMarker = 0;
 void txrx_test()
 {
   bool success = false;
-#if DEBUG_TIMING
-  unsigned long baro_start_ms, baro_end_ms;
-  unsigned long tx_start_ms, tx_end_ms, rx_start_ms, rx_end_ms;
-  unsigned long parse_start_ms, parse_end_ms, led_start_ms, led_end_ms;
-  unsigned long export_start_ms, export_end_ms;
-  unsigned long oled_start_ms, oled_end_ms;
-#endif
   ThisAircraft.timestamp = now();
 
   if (TxPosUpdMarker == 0 || (millis() - TxPosUpdMarker) > 4000 ) {
@@ -548,38 +555,16 @@ void txrx_test()
   ThisAircraft.speed = TXRX_TEST_SPEED;
   ThisAircraft.vs = TXRX_TEST_VS;
 
-#if DEBUG_TIMING
-  baro_start_ms = millis();
-#endif
   Baro_loop();
-#if DEBUG_TIMING
-  baro_end_ms = millis();
-#endif
 
 #if defined(ENABLE_AHRS)
   AHRS_loop();
 #endif /* ENABLE_AHRS */
 
-#if DEBUG_TIMING
-  tx_start_ms = millis();
-#endif
   RF_Transmit(RF_Encode(&ThisAircraft), true);
-#if DEBUG_TIMING
-  tx_end_ms = millis();
-  rx_start_ms = millis();
-#endif
   success = RF_Receive();
-#if DEBUG_TIMING
-  rx_end_ms = millis();
-#endif
 
-#if DEBUG_TIMING
-  parse_start_ms = millis();
-#endif
-  if (success) ParseData();
-#if DEBUG_TIMING
-  parse_end_ms = millis();
-#endif
+  if (success) ParseData(true);
 
 #if defined(ENABLE_TTN)
   TTN_loop();
@@ -587,20 +572,11 @@ void txrx_test()
 
   Traffic_loop();
 
-#if DEBUG_TIMING
-  led_start_ms = millis();
-#endif
   if (isTimeToDisplay()) {
     LED_DisplayTraffic();
     LEDTimeMarker = millis();
   }
-#if DEBUG_TIMING
-  led_end_ms = millis();
-#endif
 
-#if DEBUG_TIMING
-  export_start_ms = millis();
-#endif
   if (isTimeToExport()) {
 #if defined(USE_NMEALIB)
     NMEA_Position();
@@ -608,64 +584,10 @@ void txrx_test()
     NMEA_Export();
     GDL90_Export();
     D1090_Export();
-    ExportTimeMarker = millis();
+    ExportTimeMarker = Time_ms();
   }
-#if DEBUG_TIMING
-  export_end_ms = millis();
-#endif
 
-#if DEBUG_TIMING
-  oled_start_ms = millis();
-#endif
 //  SoC->Display_loop();
-#if DEBUG_TIMING
-  oled_end_ms = millis();
-#endif
-
-#if DEBUG_TIMING
-  if (baro_start_ms - baro_end_ms) {
-    Serial.print(F("Baro start: "));
-    Serial.print(baro_start_ms);
-    Serial.print(F(" Baro stop: "));
-    Serial.println(baro_end_ms);
-  }
-  if (tx_end_ms - tx_start_ms) {
-    Serial.print(F("TX start: "));
-    Serial.print(tx_start_ms);
-    Serial.print(F(" TX stop: "));
-    Serial.println(tx_end_ms);
-  }
-  if (rx_end_ms - rx_start_ms) {
-    Serial.print(F("RX start: "));
-    Serial.print(rx_start_ms);
-    Serial.print(F(" RX stop: "));
-    Serial.println(rx_end_ms);
-  }
-  if (parse_end_ms - parse_start_ms) {
-    Serial.print(F("Parse start: "));
-    Serial.print(parse_start_ms);
-    Serial.print(F(" Parse stop: "));
-    Serial.println(parse_end_ms);
-  }
-  if (led_end_ms - led_start_ms) {
-    Serial.print(F("LED start: "));
-    Serial.print(led_start_ms);
-    Serial.print(F(" LED stop: "));
-    Serial.println(led_end_ms);
-  }
-  if (export_end_ms - export_start_ms) {
-    Serial.print(F("Export start: "));
-    Serial.print(export_start_ms);
-    Serial.print(F(" Export stop: "));
-    Serial.println(export_end_ms);
-  }
-  if (oled_end_ms - oled_start_ms) {
-    Serial.print(F("OLED start: "));
-    Serial.print(oled_start_ms);
-    Serial.print(F(" OLED stop: "));
-    Serial.println(oled_end_ms);
-  }
-#endif
 
   // Handle Air Connect
   NMEA_loop();
@@ -231,7 +231,7 @@ void rx_test_loop()
 
   success = RF_Receive();
 
-  if (success) ParseData();
+  if (success) ParseData(true);
 
   if (isTimeToDisplay()) {
     LED_DisplayTraffic();
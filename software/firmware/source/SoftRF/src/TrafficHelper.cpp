@@ -20,14 +20,25 @@
 #include "driver/EEPROM.h"
 #include "driver/RF.h"
 #include "driver/GNSS.h"
+#include "system/Profile.h"
+#include "system/Coverage.h"
 #include "ui/Web.h"
 #include "protocol/radio/Legacy.h"
+#include "protocol/data/JSON.h"
 
-unsigned long UpdateTrafficTimeMarker = 0;
+uint64_t UpdateTrafficTimeMarker = 0;
 
 ufo_t fo, Container[MAX_TRACKING_OBJECTS], EmptyFO;
 traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];
 
+#if defined(USE_TRAFFIC_SNAPSHOT)
+static traffic_snapshot_t Traffic_snapshot[TRAFFIC_SNAPSHOTS];
+static traffic_snapshot_t *Traffic_current = &Traffic_snapshot[0];
+static traffic_snapshot_t *Traffic_hazard[TRAFFIC_READERS];
+static uint32_t Traffic_seq = 0;
+static uint64_t Traffic_publish_marker = 0;
+#endif /* USE_TRAFFIC_SNAPSHOT */
+
 static int8_t (*Alarm_Level)(ufo_t *, ufo_t *);
 
 /*
@@ -137,43 +148,70 @@ void Traffic_Update(ufo_t *fop)
   }
 }
 
-void ParseData()
+void ParseData(bool fix)
 {
+    ParseFrame(RxBuffer, RF_last_rssi, RF_last_utc, fix);
+}
+
+/*
+ * Decode a frame received with the RSSI given, at UTC in us (0 if unknown),
+ * then file it into the traffic table if own ship has a fix. The outcome
+ * counts either way, as every frame the radio passes on does.
+ */
+void ParseFrame(byte *raw, int8_t rssi, uint64_t utc, bool fix)
+{
+    PROFILE(PROFILE_DECODE);
+
     size_t rx_size = RF_Payload_Size(settings->rf_protocol);
     rx_size = rx_size > sizeof(fo.raw) ? sizeof(fo.raw) : rx_size;
 
 #if DEBUG
-    Hex2Bin(TxDataTemplate, RxBuffer);
+    Hex2Bin(TxDataTemplate, raw);
 #endif
 
     memset(fo.raw, 0, sizeof(fo.raw));
-    memcpy(fo.raw, RxBuffer, rx_size);
+    memcpy(fo.raw, raw, rx_size);
 
     if (settings->nmea_p) {
-      StdOut.print(F("$PSRFI,"));
-      StdOut.print((unsigned long) now()); StdOut.print(F(","));
-      StdOut.print(Bin2Hex(fo.raw, rx_size)); StdOut.print(F(","));
-      StdOut.println(RF_last_rssi);
+      RF_PrintFrame(false, fo.raw, rx_size, utc, now(), rssi);
     }
 
-    if (protocol_decode && (*protocol_decode)((void *) RxBuffer, &ThisAircraft, &fo)) {
+    RF_stats_t *stats = &RF_STATS(settings->rf_protocol);
+
+    RF_reject = RF_REJECT_DECODE;
+
+    if (protocol_decode && (*protocol_decode)((void *) raw, &ThisAircraft, &fo)) {
       int i;
 
       /* ignore if the received packet is from myself. */
-      if (fo.addr == ThisAircraft.addr)
+      if (fo.addr == ThisAircraft.addr) {
+        stats->reject[RF_REJECT_SELF]++;
         return;
+      }
 
-      fo.rssi = RF_last_rssi;
-
-      Traffic_Update(&fo);
+      fo.rssi = rssi;
 
       for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
         if (Container[i].addr == fo.addr) {
-          Container[i] = fo;
-          return;
+          if (memcmp(Container[i].raw, fo.raw, sizeof(fo.raw)) == 0) {
+            stats->duplicates++;
+          }
+          break;
         }
       }
 
+      if (!fix) {
+        return;
+      }
+
+      Traffic_Update(&fo);
+      Coverage_add(&fo);
+
+      if (i < MAX_TRACKING_OBJECTS) {
+        Container[i] = fo;
+        return;
+      }
+
       int max_dist_ndx = 0;
       int min_level_ndx = 0;
 
@@ -205,6 +243,8 @@ void ParseData()
       }
 #endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
 
+    } else if (protocol_decode) {
+      stats->reject[RF_reject]++;
     }
 }
 
@@ -231,6 +271,8 @@ void Traffic_setup()
 void Traffic_loop()
 {
   if (isTimeToUpdateTraffic()) {
+    PROFILE(PROFILE_TRAFFIC);
+
     for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
 
       if (Container[i].addr &&
@@ -242,7 +284,7 @@ void Traffic_loop()
       }
     }
 
-    UpdateTrafficTimeMarker = millis();
+    UpdateTrafficTimeMarker = Time_ms();
   }
 }
 
@@ -268,6 +310,84 @@ int Traffic_Count()
   return count;
 }
 
+/* Own ship and the traffic table as they are now, for the main loop's exports */
+traffic_view_t Traffic_live()
+{
+  traffic_view_t view = { &ThisAircraft, Container, isValidFix() };
+
+  return view;
+}
+
+#if defined(USE_TRAFFIC_SNAPSHOT)
+
+/*
+ * Snapshots are never modified once published. A reader announces
+ * the one it is working on in its hazard slot, and the writer only
+ * ever fills a buffer that is neither current nor announced, so that
+ * neither side waits on the other. Sequentially consistent atomics
+ * make the announcement visible to the writer before the reader uses it.
+ */
+uint32_t Traffic_publish(bool fix)
+{
+  traffic_snapshot_t *current = __atomic_load_n(&Traffic_current, __ATOMIC_SEQ_CST);
+  traffic_snapshot_t *snap = NULL;
+
+  for (int i = 0; i < TRAFFIC_SNAPSHOTS && snap == NULL; i++) {
+    snap = &Traffic_snapshot[i];
+
+    if (snap == current) {
+      snap = NULL;
+      continue;
+    }
+    for (int r = 0; r < TRAFFIC_READERS; r++) {
+      if (__atomic_load_n(&Traffic_hazard[r], __ATOMIC_SEQ_CST) == snap) {
+        snap = NULL;
+        break;
+      }
+    }
+  }
+
+  snap->own = ThisAircraft;
+  memcpy(snap->traffic, Container, sizeof(snap->traffic));
+  snap->fix   = fix;
+  snap->seq   = ++Traffic_seq;
+  snap->stamp = micros();
+
+  __atomic_store_n(&Traffic_current, snap, __ATOMIC_SEQ_CST);
+  Traffic_publish_marker = Time_ms();
+
+  return snap->seq;
+}
+
+/* The views draw from a snapshot whatever the mode, so there is a fresh one */
+void Traffic_publish_loop()
+{
+  if (Time_since(Traffic_publish_marker) >= TRAFFIC_PUBLISH_INTERVAL_MS) {
+    Traffic_publish(isValidFix());
+  }
+}
+
+/* Latest snapshot, valid until the reader releases it */
+traffic_snapshot_t *Traffic_acquire(uint8_t reader)
+{
+  traffic_snapshot_t *snap;
+
+  do {
+    snap = __atomic_load_n(&Traffic_current, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&Traffic_hazard[reader], snap, __ATOMIC_SEQ_CST);
+  } while (snap != __atomic_load_n(&Traffic_current, __ATOMIC_SEQ_CST));
+
+  return snap;
+}
+
+void Traffic_release(uint8_t reader)
+{
+  __atomic_store_n(&Traffic_hazard[reader], (traffic_snapshot_t *) NULL,
+                   __ATOMIC_SEQ_CST);
+}
+
+#endif /* USE_TRAFFIC_SNAPSHOT */
+
 int traffic_cmp_by_distance(const void *a, const void *b)
 {
   traffic_by_dist_t *ta = (traffic_by_dist_t *)a;
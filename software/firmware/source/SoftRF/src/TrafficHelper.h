@@ -20,6 +20,7 @@
 #define TRAFFICHELPER_H
 
 #include "system/SoC.h"
+#include "system/Time.h"
 
 #define ALARM_ZONE_NONE       10000 /* zone range is 1000m <-> 10000m */
 #define ALARM_ZONE_LOW        1000  /* zone range is  700m <->  1000m */
@@ -31,7 +32,7 @@
 
 #define TRAFFIC_VECTOR_UPDATE_INTERVAL 2 /* seconds */
 #define TRAFFIC_UPDATE_INTERVAL_MS (TRAFFIC_VECTOR_UPDATE_INTERVAL * 1000)
-#define isTimeToUpdateTraffic() (millis() - UpdateTrafficTimeMarker > \
+#define isTimeToUpdateTraffic() (Time_since(UpdateTrafficTimeMarker) > \
                                   TRAFFIC_UPDATE_INTERVAL_MS)
 
 typedef struct traffic_by_dist_struct {
@@ -39,6 +40,32 @@ typedef struct traffic_by_dist_struct {
   float distance;
 } traffic_by_dist_t;
 
+#if defined(USE_TRAFFIC_SNAPSHOT)
+/*
+ * Own ship and the traffic table as of one moment, for the readers
+ * that run alongside the main loop. The main loop is the only writer.
+ */
+typedef struct traffic_snapshot_struct {
+  ufo_t         own;
+  ufo_t         traffic[MAX_TRACKING_OBJECTS];
+  bool          fix;
+  uint32_t      seq;
+  unsigned int  stamp;              /* micros() when published */
+} traffic_snapshot_t;
+
+enum
+{
+	TRAFFIC_READER_EXPORT,
+	TRAFFIC_READER_DISPLAY,
+	TRAFFIC_READERS
+};
+
+/* one per reader, the current one and the one being written */
+#define TRAFFIC_SNAPSHOTS     (TRAFFIC_READERS + 2)
+
+#define TRAFFIC_PUBLISH_INTERVAL_MS 1000
+#endif /* USE_TRAFFIC_SNAPSHOT */
+
 enum
 {
 	TRAFFIC_ALARM_NONE,
@@ -47,16 +74,26 @@ enum
 	TRAFFIC_ALARM_LEGACY
 };
 
-void ParseData(void);
+void ParseData(bool);
+void ParseFrame(byte *, int8_t, uint64_t, bool);
 void Traffic_setup(void);
 void Traffic_loop(void);
 void ClearExpired(void);
 void Traffic_Update(ufo_t *);
 int  Traffic_Count(void);
+traffic_view_t Traffic_live(void);
 
 int  traffic_cmp_by_distance(const void *, const void *);
 
+#if defined(USE_TRAFFIC_SNAPSHOT)
+uint32_t Traffic_publish(bool);
+void Traffic_publish_loop(void);
+traffic_snapshot_t *Traffic_acquire(uint8_t);
+void Traffic_release(uint8_t);
+#endif /* USE_TRAFFIC_SNAPSHOT */
+
 extern ufo_t fo, Container[MAX_TRACKING_OBJECTS], EmptyFO;
 extern traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];
+extern uint64_t UpdateTrafficTimeMarker;
 
 #endif /* TRAFFICHELPER_H */
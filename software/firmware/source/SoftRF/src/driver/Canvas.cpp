@@ -0,0 +1,396 @@
+/*
+ * CanvasHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* built for SkyView as well, so it stands on GxEPD2 alone */
+#if defined(USE_EPD_CANVAS)
+
+#include <stdio.h>
+#include <strings.h>
+
+#include "Canvas.h"
+
+#define CANVAS_ROW        (EPD_Canvas::WIDTH / 8)
+
+EPD_Canvas::EPD_Canvas() :
+  GxEPD2_EPD(-1, -1, -1, -1, LOW, 0, WIDTH, HEIGHT, panel, hasColor, hasPartialUpdate, hasFastPartialUpdate)
+{
+  dump             = NULL;
+  rotation         = 0;
+  frames           = 0;
+  full_refreshes   = 0;
+  refreshed_pixels = 0;
+  memset(_ram,    0xFF, sizeof(_ram));
+  memset(_screen, 0xFF, sizeof(_screen));
+}
+
+/* No pins and no SPI to bring up */
+void EPD_Canvas::init(uint32_t serial_diag_bitrate, bool initial, bool pulldown_rst_mode)
+{
+  _initial_write = initial;
+  _initial_refresh = initial;
+  _pulldown_rst_mode = pulldown_rst_mode;
+  _power_is_on = false;
+  _using_partial_mode = false;
+  _hibernating = false;
+}
+
+void EPD_Canvas::clearScreen(uint8_t value)
+{
+  writeScreenBuffer(value);
+  refresh(false);
+}
+
+void EPD_Canvas::writeScreenBuffer(uint8_t value)
+{
+  memset(_ram, value, sizeof(_ram));
+}
+
+void EPD_Canvas::writeImage(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  /* the same alignment as the controllers have */
+  int16_t wb = (w + 7) / 8;
+  x -= x % 8;
+  w = wb * 8;
+
+  writeImagePart(bitmap, 0, 0, w, h, x, y, w, h, invert, mirror_y, pgm);
+}
+
+void EPD_Canvas::writeImagePart(const uint8_t bitmap[], int16_t x_part, int16_t y_part, int16_t w_bitmap, int16_t h_bitmap,
+                                int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  int16_t wb_bitmap = (w_bitmap + 7) / 8;
+
+  for (int16_t i = 0; i < h; i++) {
+    int16_t ys = mirror_y ? h_bitmap - 1 - (y_part + i) : y_part + i;
+    int16_t yd = y + i;
+
+    if (ys < 0 || ys >= h_bitmap || yd < 0 || yd >= HEIGHT) {
+      continue;
+    }
+
+    const uint8_t *src = bitmap + ys * wb_bitmap;
+    uint8_t *dst = _ram + yd * CANVAS_ROW;
+
+    if (x % 8 == 0 && x_part % 8 == 0 && w % 8 == 0 &&
+        x >= 0 && x + w <= WIDTH && x_part + w <= w_bitmap) {
+      for (int16_t j = 0; j < w / 8; j++) {
+        uint8_t data = src[x_part / 8 + j];
+        dst[x / 8 + j] = invert ? ~data : data;
+      }
+      continue;
+    }
+
+    for (int16_t j = 0; j < w; j++) {
+      int16_t xs = x_part + j;
+      int16_t xd = x + j;
+
+      if (xs < 0 || xs >= w_bitmap || xd < 0 || xd >= WIDTH) {
+        continue;
+      }
+
+      bool white = (src[xs / 8] >> (7 - xs % 8)) & 1;
+      if (invert) white = !white;
+
+      if (white) {
+        dst[xd / 8] |=  (1 << (7 - xd % 8));
+      } else {
+        dst[xd / 8] &= ~(1 << (7 - xd % 8));
+      }
+    }
+  }
+}
+
+void EPD_Canvas::writeImage(const uint8_t* black, const uint8_t* color, int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  if (black) {
+    writeImage(black, x, y, w, h, invert, mirror_y, pgm);
+  }
+}
+
+void EPD_Canvas::writeImagePart(const uint8_t* black, const uint8_t* color, int16_t x_part, int16_t y_part, int16_t w_bitmap, int16_t h_bitmap,
+                                int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  if (black) {
+    writeImagePart(black, x_part, y_part, w_bitmap, h_bitmap, x, y, w, h, invert, mirror_y, pgm);
+  }
+}
+
+void EPD_Canvas::writeNative(const uint8_t* data1, const uint8_t* data2, int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  if (data1) {
+    writeImage(data1, x, y, w, h, invert, mirror_y, pgm);
+  }
+}
+
+void EPD_Canvas::drawImage(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  writeImage(bitmap, x, y, w, h, invert, mirror_y, pgm);
+  refresh(x, y, w, h);
+}
+
+void EPD_Canvas::drawImagePart(const uint8_t bitmap[], int16_t x_part, int16_t y_part, int16_t w_bitmap, int16_t h_bitmap,
+                               int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  writeImagePart(bitmap, x_part, y_part, w_bitmap, h_bitmap, x, y, w, h, invert, mirror_y, pgm);
+  refresh(x, y, w, h);
+}
+
+void EPD_Canvas::drawImage(const uint8_t* black, const uint8_t* color, int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  writeImage(black, color, x, y, w, h, invert, mirror_y, pgm);
+  refresh(x, y, w, h);
+}
+
+void EPD_Canvas::drawImagePart(const uint8_t* black, const uint8_t* color, int16_t x_part, int16_t y_part, int16_t w_bitmap, int16_t h_bitmap,
+                               int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  writeImagePart(black, color, x_part, y_part, w_bitmap, h_bitmap, x, y, w, h, invert, mirror_y, pgm);
+  refresh(x, y, w, h);
+}
+
+void EPD_Canvas::drawNative(const uint8_t* data1, const uint8_t* data2, int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm)
+{
+  writeNative(data1, data2, x, y, w, h, invert, mirror_y, pgm);
+  refresh(x, y, w, h);
+}
+
+void EPD_Canvas::refresh(bool partial_update_mode)
+{
+  if (!partial_update_mode) {
+    full_refreshes++;
+  }
+  _refresh(0, 0, WIDTH, HEIGHT);
+}
+
+void EPD_Canvas::refresh(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  _refresh(x, y, w, h);
+}
+
+void EPD_Canvas::powerOff()
+{
+  _power_is_on = false;
+}
+
+void EPD_Canvas::hibernate()
+{
+  powerOff();
+  _hibernating = true;
+}
+
+bool EPD_Canvas::probe()
+{
+  return true;
+}
+
+void EPD_Canvas::_refresh(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  int16_t x1 = x < 0 ? 0 : x;
+  int16_t y1 = y < 0 ? 0 : y;
+  int16_t x2 = x + w > WIDTH  ? WIDTH  : x + w;
+  int16_t y2 = y + h > HEIGHT ? HEIGHT : y + h;
+
+  /* whole bytes, as the controllers do */
+  x1 -= x1 % 8;
+  x2 += (8 - x2 % 8) % 8;
+
+  if (x1 >= x2 || y1 >= y2) {
+    return;
+  }
+
+  for (int16_t i = y1; i < y2; i++) {
+    memcpy(_screen + i * CANVAS_ROW + x1 / 8,
+           _ram    + i * CANVAS_ROW + x1 / 8, (x2 - x1) / 8);
+  }
+
+  frames++;
+  refreshed_pixels += (uint32_t) (x2 - x1) * (y2 - y1);
+  _power_is_on = true;
+
+  if (dump) {
+    char path[256];
+
+    snprintf(path, sizeof(path), dump, frames);
+    if (!save(path, rotation)) {
+      perror(path);
+    }
+  }
+}
+
+/* Pixel (x, y) of the screen as the views see it, true if white */
+bool EPD_Canvas::_pixel(int16_t x, int16_t y, uint8_t rotation) const
+{
+  int16_t t;
+
+  switch (rotation & 3)
+  {
+    case 1:
+      t = x; x = WIDTH - y - 1; y = t;
+      break;
+    case 2:
+      x = WIDTH - x - 1;
+      y = HEIGHT - y - 1;
+      break;
+    case 3:
+      t = x; x = y; y = HEIGHT - t - 1;
+      break;
+  }
+
+  return (_screen[y * CANVAS_ROW + x / 8] >> (7 - x % 8)) & 1;
+}
+
+static uint32_t Canvas_crc32(uint32_t crc, const uint8_t *buf, size_t size)
+{
+  crc = ~crc;
+  while (size--) {
+    crc ^= *buf++;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+  }
+
+  return ~crc;
+}
+
+static void Canvas_be32(uint8_t *buf, uint32_t value)
+{
+  buf[0] = value >> 24;
+  buf[1] = value >> 16;
+  buf[2] = value >>  8;
+  buf[3] = value;
+}
+
+static void Canvas_chunk(FILE *file, const char *type, const uint8_t *data, uint32_t size)
+{
+  uint8_t head[8];
+  uint8_t tail[4];
+
+  Canvas_be32(head, size);
+  memcpy(head + 4, type, 4);
+  Canvas_be32(tail, Canvas_crc32(Canvas_crc32(0, head + 4, 4), data, size));
+
+  fwrite(head, sizeof(head), 1, file);
+  fwrite(data, size, 1, file);
+  fwrite(tail, sizeof(tail), 1, file);
+}
+
+/*
+ * 1-bit grayscale PNG. The image data is deflated with "stored" blocks
+ * only, which is valid and needs no zlib for a frame this small.
+ */
+static void Canvas_png(FILE *file, const uint8_t *rows, uint16_t width, uint16_t height)
+{
+  static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  uint32_t stride = 1 + (width + 7) / 8;       /* filter type and pixels */
+  uint32_t raw    = stride * height;
+  uint32_t blocks = (raw + 0xFFFF - 1) / 0xFFFF;
+  uint32_t size   = 2 + blocks * 5 + raw + 4;
+  uint8_t  ihdr[13];
+  uint8_t  *idat  = (uint8_t *) malloc(size);
+  uint8_t  *p     = idat;
+  uint32_t a = 1, b = 0;
+
+  Canvas_be32(ihdr, width);
+  Canvas_be32(ihdr + 4, height);
+  ihdr[8]  = 1;   /* bit depth */
+  ihdr[9]  = 0;   /* grayscale */
+  ihdr[10] = 0;
+  ihdr[11] = 0;
+  ihdr[12] = 0;
+
+  *p++ = 0x78;
+  *p++ = 0x01;
+  for (uint32_t done = 0; done < raw; ) {
+    uint32_t len = raw - done > 0xFFFF ? 0xFFFF : raw - done;
+
+    *p++ = (done + len == raw);
+    *p++ = len;
+    *p++ = len >> 8;
+    *p++ = ~len;
+    *p++ = ~len >> 8;
+    memcpy(p, rows + done, len);
+    p    += len;
+    done += len;
+  }
+  for (uint32_t i = 0; i < raw; i++) {
+    a = (a + rows[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  Canvas_be32(p, (b << 16) | a);
+
+  fwrite(signature, sizeof(signature), 1, file);
+  Canvas_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+  Canvas_chunk(file, "IDAT", idat, size);
+  Canvas_chunk(file, "IEND", NULL, 0);
+
+  free(idat);
+}
+
+bool EPD_Canvas::save(const char *path, uint8_t rotation) const
+{
+  uint16_t width  = rotation & 1 ? HEIGHT : WIDTH;
+  uint16_t height = rotation & 1 ? WIDTH  : HEIGHT;
+  uint32_t stride = 1 + (width + 7) / 8;
+  uint8_t  *rows  = (uint8_t *) calloc(stride, height);
+  const char *ext = strrchr(path, '.');
+  bool png = ext && !strcasecmp(ext, ".png");
+  FILE *file;
+
+  /* PNG and PBM rows, the first byte being the PNG filter type (none) */
+  for (uint16_t y = 0; y < height; y++) {
+    uint8_t *row = rows + y * stride + 1;
+    for (uint16_t x = 0; x < width; x++) {
+      if (_pixel(x, y, rotation) == png) {
+        row[x / 8] |= 1 << (7 - x % 8);
+      }
+    }
+  }
+
+  file = fopen(path, "wb");
+  if (file == NULL) {
+    free(rows);
+    return false;
+  }
+
+  if (png) {
+    Canvas_png(file, rows, width, height);
+  } else {
+    /* PBM: 1 is black */
+    fprintf(file, "P4\n%u %u\n", width, height);
+    for (uint16_t y = 0; y < height; y++) {
+      fwrite(rows + y * stride + 1, stride - 1, 1, file);
+    }
+  }
+
+  free(rows);
+
+  return fclose(file) == 0;
+}
+
+uint32_t EPD_Canvas::hash() const
+{
+  uint32_t h = 2166136261UL;
+
+  for (size_t i = 0; i < sizeof(_screen); i++) {
+    h = (h ^ _screen[i]) * 16777619UL;
+  }
+
+  return h;
+}
+
+#endif /* USE_EPD_CANVAS */
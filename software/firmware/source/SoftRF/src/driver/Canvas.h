@@ -0,0 +1,90 @@
+/*
+ * CanvasHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CANVASHELPER_H
+#define CANVASHELPER_H
+
+#include <GxEPD2_EPD.h>
+
+/* The 1.54" panel of SoftRF; SkyView builds it as its 2.7" one */
+#if !defined(EPD_CANVAS_WIDTH)
+#define EPD_CANVAS_WIDTH    200
+#define EPD_CANVAS_HEIGHT   200
+#define EPD_CANVAS_PANEL    GxEPD2::GDEH0154D67
+#endif
+
+/*
+ * An e-paper panel in memory, for GxEPD2_BW to drive on a host without
+ * one. It has the geometry of the panel the views are laid out for.
+ * What a refresh puts on the "screen" can be saved as PBM or PNG.
+ */
+class EPD_Canvas : public GxEPD2_EPD
+{
+  public:
+    // attributes
+    static const uint16_t WIDTH = EPD_CANVAS_WIDTH;
+    static const uint16_t HEIGHT = EPD_CANVAS_HEIGHT;
+    static const GxEPD2::Panel panel = EPD_CANVAS_PANEL;
+    static const bool hasColor = false;
+    static const bool hasPartialUpdate = true;
+    static const bool hasFastPartialUpdate = false;
+    // constructor
+    EPD_Canvas();
+    // methods (virtual)
+    using GxEPD2_EPD::init;
+    void init(uint32_t serial_diag_bitrate, bool initial, bool pulldown_rst_mode = false);
+    void clearScreen(uint8_t value = 0xFF);
+    void writeScreenBuffer(uint8_t value = 0xFF);
+    void writeImage(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void writeImagePart(const uint8_t bitmap[], int16_t x_part, int16_t y_part, int16_t w_bitmap, int16_t h_bitmap,
+                        int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void writeImage(const uint8_t* black, const uint8_t* color, int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void writeImagePart(const uint8_t* black, const uint8_t* color, int16_t x_part, int16_t y_part, int16_t w_bitmap, int16_t h_bitmap,
+                        int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void writeNative(const uint8_t* data1, const uint8_t* data2, int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void drawImage(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void drawImagePart(const uint8_t bitmap[], int16_t x_part, int16_t y_part, int16_t w_bitmap, int16_t h_bitmap,
+                       int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void drawImage(const uint8_t* black, const uint8_t* color, int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void drawImagePart(const uint8_t* black, const uint8_t* color, int16_t x_part, int16_t y_part, int16_t w_bitmap, int16_t h_bitmap,
+                       int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void drawNative(const uint8_t* data1, const uint8_t* data2, int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void refresh(bool partial_update_mode = false);
+    void refresh(int16_t x, int16_t y, int16_t w, int16_t h);
+    void powerOff();
+    void hibernate();
+    bool probe();
+    // the screen, turned by an Adafruit_GFX rotation, as PBM or (*.png) PNG
+    bool save(const char *path, uint8_t rotation = 0) const;
+    // FNV-1a of the screen, to tell one frame from another
+    uint32_t hash() const;
+  public:
+    const char *dump;              // saved on every refresh, "%u" is the frame
+    uint8_t  rotation;             // of the dump
+    uint32_t frames;               // refreshes, full or not
+    uint32_t full_refreshes;
+    uint64_t refreshed_pixels;
+  private:
+    void _refresh(int16_t x, int16_t y, int16_t w, int16_t h);
+    bool _pixel(int16_t x, int16_t y, uint8_t rotation) const;
+  private:
+    uint8_t _ram[(WIDTH / 8) * HEIGHT];      // controller memory, 1 is white
+    uint8_t _screen[(WIDTH / 8) * HEIGHT];   // what the panel shows
+};
+
+#endif /* CANVASHELPER_H */
@@ -17,6 +17,7 @@
  */
 
 #include "../system/SoC.h"
+#include "../system/Time.h"
 
 #if defined(USE_EPAPER)
 
@@ -40,7 +41,7 @@ const char EPD_RTC_text[]     = "RTC     ";
 const char EPD_Flash_text[]   = "FLASH   ";
 const char EPD_Baro_text[]    = "BARO  ";
 
-unsigned long EPDTimeMarker = 0;
+uint64_t EPDTimeMarker = 0;
 
 static int EPD_view_mode = 0;
 bool EPD_vmode_updated = true;
@@ -121,7 +122,7 @@ bool EPD_setup(bool splash_screen)
   EPD_text_setup();
   EPD_time_setup();
 
-  EPDTimeMarker = millis();
+  EPDTimeMarker = Time_ms();
 
   return rval;
 }
@@ -226,7 +227,7 @@ void EPD_loop()
         break;
       }
 
-      EPDTimeMarker = millis();
+      EPDTimeMarker = Time_ms();
     }
     break;
 
@@ -33,7 +33,7 @@
 #define NAVBOX5_TITLE           "RX"
 #define NAVBOX6_TITLE           "TX"
 
-#define isTimeToEPD()           (millis() - EPDTimeMarker > 1000)
+#define isTimeToEPD()           (Time_since(EPDTimeMarker) > 1000)
 #define maxof2(a,b)             (a > b ? a : b)
 
 #define EPD_RADAR_V_THRESHOLD   50      /* metres */
@@ -182,7 +182,7 @@ void EPD_time_loop();
 void EPD_time_next();
 void EPD_time_prev();
 
-extern unsigned long EPDTimeMarker;
+extern uint64_t EPDTimeMarker;
 extern bool EPD_vmode_updated;
 extern volatile bool EPD_ready_to_display;
 
@@ -25,6 +25,7 @@
 #include "EEPROM.h"
 #include "../protocol/data/NMEA.h"
 #include "../system/SoC.h"
+#include "../system/Time.h"
 #include "WiFi.h"
 #include "RF.h"
 #include "Battery.h"
@@ -79,6 +80,7 @@ const char *GNSS_name[] = {
 #include "LED.h"
 #include "../protocol/data/GDL90.h"
 #include "../protocol/data/D1090.h"
+#include "../system/Profile.h"
 
 TinyGPSCustom C_Version      (gnss, "PSRFC", 1);
 TinyGPSCustom C_Mode         (gnss, "PSRFC", 2);
@@ -100,6 +102,8 @@ TinyGPSCustom C_Stealth      (gnss, "PSRFC", 17);
 TinyGPSCustom C_noTrack      (gnss, "PSRFC", 18);
 TinyGPSCustom C_PowerSave    (gnss, "PSRFC", 19);
 
+TinyGPSCustom S_Query        (gnss, "PSRFS", 1);
+
 static uint8_t C_NMEA_Source;
 
 #endif /* USE_NMEA_CFG */
@@ -1115,6 +1119,9 @@ void GNSS_fini()
 
 void GNSSTimeSync()
 {
+  /* reading the time out of TinyGPS++ clears the flag */
+  bool updated = gnss.time.isValid() && gnss.time.isUpdated() && gnss.date.isValid();
+
   if (GNSSTimeSyncMarker == 0 && gnss.time.isValid() && gnss.time.isUpdated()) {
       setTime(gnss.time.hour(), gnss.time.minute(), gnss.time.second(), gnss.date.day(), gnss.date.month(), gnss.date.year());
       GNSSTimeSyncMarker = millis();
@@ -1134,6 +1141,46 @@ void GNSSTimeSync()
       GNSSTimeSyncMarker = millis();
     }
   }
+
+  if (updated) {
+    tmElements_t tm;
+    uint64_t received = Time_us() - (uint64_t) gnss.time.age() * 1000;
+
+    tm.Year   = CalendarYrToTm(gnss.date.year());
+    tm.Month  = gnss.date.month();
+    tm.Day    = gnss.date.day();
+    tm.Hour   = gnss.time.hour();
+    tm.Minute = gnss.time.minute();
+    tm.Second = gnss.time.second();
+
+    Time_nmea(makeTime(tm), gnss.time.centisecond() * 10000, received);
+  }
+}
+
+/* Own position, course and speed out of the latest fix */
+void GNSS_Ownship(ufo_t *this_aircraft)
+{
+  this_aircraft->latitude = gnss.location.lat();
+  this_aircraft->longitude = gnss.location.lng();
+  this_aircraft->altitude = gnss.altitude.meters();
+  this_aircraft->course = gnss.course.deg();
+  this_aircraft->speed = gnss.speed.knots();
+  this_aircraft->hdop = (uint16_t) gnss.hdop.value();
+  this_aircraft->geoid_separation = gnss.separation.meters();
+
+#if !defined(EXCLUDE_EGM96)
+  /*
+   * When geoidal separation is zero or not available - use approx. EGM96 value
+   */
+  if (this_aircraft->geoid_separation == 0.0) {
+    this_aircraft->geoid_separation = (float) LookupSeparation(
+                                                this_aircraft->latitude,
+                                                this_aircraft->longitude
+                                              );
+    /* we can assume the GPS unit is giving ellipsoid height */
+    this_aircraft->altitude -= this_aircraft->geoid_separation;
+  }
+#endif /* EXCLUDE_EGM96 */
 }
 
 void PickGNSSFix()
@@ -1437,6 +1484,12 @@ void PickGNSSFix()
           }
         }
       }
+      if (S_Query.isUpdated()) {
+        if (strncmp(S_Query.value(), "?", 1) == 0) {
+          Profile_NMEA(C_NMEA_Source);
+          RF_Stats_NMEA(C_NMEA_Source);
+        }
+      }
 #endif /* USE_NMEA_CFG */
     }
     if (GNSSbuf[GNSS_cnt] == '\n' || GNSS_cnt == sizeof(GNSSbuf)-1) {
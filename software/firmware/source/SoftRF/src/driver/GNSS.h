@@ -21,6 +21,8 @@
 
 #include <TinyGPS++.h>
 
+#include "../system/SoC.h"
+
 typedef enum
 {
   GNSS_MODULE_NONE,
@@ -60,6 +62,7 @@ byte GNSS_setup      (void);
 void GNSS_loop       (void);
 void GNSS_fini       (void);
 void GNSSTimeSync    (void);
+void GNSS_Ownship    (ufo_t *);
 void PickGNSSFix     (void);
 int LookupSeparation (float, float);
 
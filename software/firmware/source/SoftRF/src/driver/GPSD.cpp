@@ -0,0 +1,415 @@
+/*
+ * GPSDHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Native gpsd client. Own-ship position, time and PPS come straight
+ * from gpsd's watch stream instead of through "gpspipe -w | SoftRF".
+ */
+
+#include "GPSD.h"
+
+#if defined(RASPBERRY_PI)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <TimeLib.h>
+#include <TinyGPS++.h>
+
+#include "LineIn.h"
+#include "GNSS.h"
+#include "../system/Time.h"
+#include "../protocol/data/JSON.h"
+
+GPSD_pps_t   GPSD_pps;
+GPSD_stats_t GPSD_stats;
+
+static uint8_t  GPSD_state = GPSD_DISCONNECTED;
+static char     GPSD_host[64] = GPSD_DEFAULT_HOST;
+static char     GPSD_port[8];
+static LineIn_t GPSD_in;
+
+static uint64_t GPSD_retry_marker = 0;
+static uint64_t GPSD_fix_marker   = 0;
+
+/*
+ * Points at the value of a "key": member, or NULL.
+ * gpsd reports are flat apart from the SKY satellites array,
+ * none of which members share a name with a top level one that is used.
+ */
+static const char *GPSD_value(const char *json, const char *key)
+{
+  size_t key_len = strlen(key);
+  const char *p = json;
+
+  while ((p = strchr(p, '"')) != NULL) {
+    p++;
+    if (!strncmp(p, key, key_len) && p[key_len] == '"') {
+      const char *v = p + key_len + 1;
+
+      while (*v == ' ') v++;
+      if (*v == ':') {
+        v++;
+        while (*v == ' ') v++;
+        return v;
+      }
+    }
+    /* skip over the rest of this string */
+    while (*p && *p != '"') {
+      p += (*p == '\\' && p[1]) ? 2 : 1;
+    }
+    if (*p) p++;
+  }
+
+  return NULL;
+}
+
+static bool GPSD_is(const char *v, const char *s)
+{
+  size_t len = strlen(s);
+
+  return v && *v == '"' && !strncmp(v + 1, s, len) && v[1 + len] == '"';
+}
+
+static int GPSD_digits(const char *s, int n)
+{
+  int value = 0;
+
+  while (n-- > 0) {
+    if (*s < '0' || *s > '9') {
+      return -1;
+    }
+    value = value * 10 + (*s++ - '0');
+  }
+
+  return value;
+}
+
+/* "2018-11-06T09:16:39.196Z" */
+static bool GPSD_time(const char *v)
+{
+  if (!v || *v++ != '"' || strlen(v) < 20 || v[4] != '-' || v[10] != 'T') {
+    return false;
+  }
+
+  int yr = GPSD_digits(v,      4);
+  int mo = GPSD_digits(v +  5, 2);
+  int dy = GPSD_digits(v +  8, 2);
+  int hr = GPSD_digits(v + 11, 2);
+  int mn = GPSD_digits(v + 14, 2);
+  int sc = GPSD_digits(v + 17, 2);
+
+  if (yr < 0 || mo < 0 || dy < 0 || hr < 0 || mn < 0 || sc < 0) {
+    return false;
+  }
+
+  setTime(hr, mn, sc, dy, mo, yr);
+
+  /* fraction of the second, to the microsecond */
+  uint32_t usec = 0;
+  if (v[19] == '.') {
+    const char *f = v + 20;
+
+    for (uint32_t scale = 100000; scale > 0 && *f >= '0' && *f <= '9'; scale /= 10) {
+      usec += (*f++ - '0') * scale;
+    }
+  }
+  Time_nmea((uint32_t) now(), usec, Time_us());
+
+  return true;
+}
+
+static void GPSD_TPV(const char *json)
+{
+  const char *v;
+
+  GPSD_stats.tpv++;
+
+  v = GPSD_value(json, "mode");
+  if (!v || atoi(v) != 3) { // 3D fix
+    return;
+  }
+
+  if (GPSD_time(GPSD_value(json, "time"))) {
+    hasValidGPSDFix = true;
+    GPSD_fix_marker = Time_ms();
+  }
+
+  if ((v = GPSD_value(json, "lat")) != NULL) {
+    ThisAircraft.latitude = strtod(v, NULL);
+  }
+  if ((v = GPSD_value(json, "lon")) != NULL) {
+    ThisAircraft.longitude = strtod(v, NULL);
+  }
+  /* gpsd 3.20 and newer tell MSL altitude apart from the HAE one */
+  if ((v = GPSD_value(json, "altMSL")) != NULL ||
+      (v = GPSD_value(json, "alt"))    != NULL) {
+    ThisAircraft.altitude = strtod(v, NULL);
+  }
+  if ((v = GPSD_value(json, "geoidSep")) != NULL) {
+    ThisAircraft.geoid_separation = strtod(v, NULL);
+  }
+  if ((v = GPSD_value(json, "track")) != NULL) {
+    ThisAircraft.course = strtod(v, NULL);
+  }
+  if ((v = GPSD_value(json, "speed")) != NULL) {
+    ThisAircraft.speed = strtod(v, NULL) / _GPS_MPS_PER_KNOT;
+  }
+}
+
+static void GPSD_SKY(const char *json)
+{
+  const char *v;
+
+  GPSD_stats.sky++;
+
+  if ((v = GPSD_value(json, "hdop")) != NULL) {
+    ThisAircraft.hdop = (uint16_t) (strtod(v, NULL) * 100);
+  }
+}
+
+static void GPSD_PPS(const char *json)
+{
+  const char *real_sec   = GPSD_value(json, "real_sec");
+  const char *real_nsec  = GPSD_value(json, "real_nsec");
+  const char *clock_sec  = GPSD_value(json, "clock_sec");
+  const char *clock_nsec = GPSD_value(json, "clock_nsec");
+
+  if (!real_sec || !real_nsec || !clock_sec || !clock_nsec) {
+    return;
+  }
+
+  GPSD_stats.pps++;
+
+  GPSD_pps.real_sec   = strtoll(real_sec,   NULL, 10);
+  GPSD_pps.real_nsec  = strtol (real_nsec,  NULL, 10);
+  GPSD_pps.clock_sec  = strtoll(clock_sec,  NULL, 10);
+  GPSD_pps.clock_nsec = strtol (clock_nsec, NULL, 10);
+  GPSD_pps.offset_ns  = (GPSD_pps.real_sec  - GPSD_pps.clock_sec) * 1000000000LL +
+                        (GPSD_pps.real_nsec - GPSD_pps.clock_nsec);
+  GPSD_pps.marker     = millis();
+  GPSD_pps.count++;
+
+  /* gpsd has labelled the edge already */
+  if (GPSD_pps.real_nsec == 0) {
+    Time_pps(Time_from_realtime(GPSD_pps.clock_sec, GPSD_pps.clock_nsec),
+             (uint32_t) GPSD_pps.real_sec);
+  }
+
+  /* the second has just begun - line the TimeLib clock up with it */
+  if (hasValidGPSDFix) {
+    setTime((time_t) GPSD_pps.real_sec);
+  }
+}
+
+static void GPSD_Parse(char *line, size_t len, uint8_t kind)
+{
+  if (kind != LINEIN_JSON) {
+    return;
+  }
+
+  const char *msg_class = GPSD_value(line, "class");
+
+  if (GPSD_is(msg_class, "TPV")) {
+    GPSD_TPV(line);
+  } else if (GPSD_is(msg_class, "SKY")) {
+    GPSD_SKY(line);
+  } else if (GPSD_is(msg_class, "PPS")) {
+    GPSD_PPS(line);
+  }
+}
+
+static void GPSD_close()
+{
+  if (GPSD_in.fd >= 0) {
+    close(GPSD_in.fd);
+    GPSD_in.fd = -1;
+  }
+  LineIn_reset(&GPSD_in);
+
+  if (GPSD_state != GPSD_OFF) {
+    GPSD_state = GPSD_DISCONNECTED;
+  }
+  GPSD_retry_marker = Time_ms();
+}
+
+static void GPSD_connect()
+{
+  struct addrinfo hints, *res;
+  int fd;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags    = AI_NUMERICSERV;
+
+  GPSD_retry_marker = Time_ms();
+
+  if (getaddrinfo(GPSD_host, GPSD_port, &hints, &res) != 0) {
+    return;
+  }
+
+  fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    freeaddrinfo(res);
+    return;
+  }
+
+  if (connect(fd, res->ai_addr, res->ai_addrlen) < 0 && errno != EINPROGRESS) {
+    close(fd);
+    freeaddrinfo(res);
+    return;
+  }
+  freeaddrinfo(res);
+
+  GPSD_in.fd = fd;
+  GPSD_state = GPSD_CONNECTING;
+}
+
+/* Non-blocking connect has completed - subscribe to the reports */
+static void GPSD_connected()
+{
+  int err = 0;
+  socklen_t len = sizeof(err);
+  struct timeval tv = { 0, 0 };
+  fd_set wfds;
+
+  FD_ZERO(&wfds);
+  FD_SET(GPSD_in.fd, &wfds);
+  if (select(GPSD_in.fd + 1, NULL, &wfds, NULL, &tv) <= 0) {
+    if (Time_since(GPSD_retry_marker) > GPSD_RETRY_INTERVAL) {
+      GPSD_close();
+    }
+    return;
+  }
+
+  if (getsockopt(GPSD_in.fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0 ||
+      send(GPSD_in.fd, GPSD_WATCH, strlen(GPSD_WATCH), MSG_NOSIGNAL) < 0) {
+    GPSD_close();
+    return;
+  }
+
+  GPSD_state = GPSD_CONNECTED;
+  GPSD_stats.connects++;
+
+  fprintf(stderr, "gpsd: connected to %s:%s\n", GPSD_host, GPSD_port);
+}
+
+/* "host", "host:port" or "OFF" */
+bool GPSD_configure(const char *endpoint)
+{
+  const char *colon;
+
+  if (!strcmp(endpoint, "OFF")) {
+    GPSD_close();
+    GPSD_state = GPSD_OFF;
+    return true;
+  }
+
+  colon = strrchr(endpoint, ':');
+  if (colon) {
+    size_t len = colon - endpoint;
+
+    if (len == 0 || len >= sizeof(GPSD_host) || strlen(colon + 1) >= sizeof(GPSD_port)) {
+      return false;
+    }
+    memcpy(GPSD_host, endpoint, len);
+    GPSD_host[len] = 0;
+    strcpy(GPSD_port, colon + 1);
+  } else {
+    if (strlen(endpoint) >= sizeof(GPSD_host)) {
+      return false;
+    }
+    strcpy(GPSD_host, endpoint);
+    snprintf(GPSD_port, sizeof(GPSD_port), "%d", GPSD_DEFAULT_PORT);
+  }
+
+  /* (re)connect on the next pass */
+  GPSD_close();
+  GPSD_state = GPSD_DISCONNECTED;
+  GPSD_retry_marker = Time_ms() - GPSD_RETRY_INTERVAL;
+
+  return true;
+}
+
+void GPSD_setup()
+{
+  if (GPSD_port[0] == 0) {
+    snprintf(GPSD_port, sizeof(GPSD_port), "%d", GPSD_DEFAULT_PORT);
+  }
+
+  LineIn_init(&GPSD_in, "gpsd", -1);
+
+  memset(&GPSD_pps, 0, sizeof(GPSD_pps));
+  GPSD_retry_marker = Time_ms() - GPSD_RETRY_INTERVAL;
+}
+
+void GPSD_loop()
+{
+  switch (GPSD_state)
+  {
+  case GPSD_DISCONNECTED:
+    if (Time_since(GPSD_retry_marker) >= GPSD_RETRY_INTERVAL) {
+      GPSD_connect();
+    }
+    break;
+  case GPSD_CONNECTING:
+    GPSD_connected();
+    break;
+  case GPSD_CONNECTED:
+    LineIn_poll(&GPSD_in, GPSD_Parse);
+    if (GPSD_in.eof) {
+      fprintf(stderr, "gpsd: connection lost\n");
+      GPSD_close();
+    }
+    break;
+  case GPSD_OFF:
+  default:
+    break;
+  }
+
+  /* gpsd has gone quiet, or has lost the fix */
+  if (GPSD_fix_marker && Time_since(GPSD_fix_marker) > GPSD_FIX_TIMEOUT) {
+    hasValidGPSDFix = false;
+    GPSD_fix_marker = 0;
+  }
+}
+
+void GPSD_fini()
+{
+  GPSD_close();
+}
+
+/* Socket to wait on, if any: writable once connected, then readable */
+int GPSD_fd()
+{
+  return GPSD_state == GPSD_CONNECTING || GPSD_state == GPSD_CONNECTED ?
+         GPSD_in.fd : -1;
+}
+
+bool GPSD_connecting()
+{
+  return GPSD_state == GPSD_CONNECTING;
+}
+
+#endif /* RASPBERRY_PI */
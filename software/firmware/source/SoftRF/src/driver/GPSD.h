@@ -0,0 +1,71 @@
+/*
+ * GPSDHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GPSDHELPER_H
+#define GPSDHELPER_H
+
+#include "../system/SoC.h"
+
+#if defined(RASPBERRY_PI)
+
+#define GPSD_DEFAULT_HOST     "127.0.0.1"
+#define GPSD_DEFAULT_PORT     2947
+#define GPSD_RETRY_INTERVAL   5000  /* ms */
+#define GPSD_FIX_TIMEOUT      3000  /* ms without a 3D TPV */
+
+#define GPSD_WATCH  "?WATCH={\"enable\":true,\"json\":true,\"pps\":true};\n"
+
+enum
+{
+	GPSD_OFF,
+	GPSD_DISCONNECTED,
+	GPSD_CONNECTING,
+	GPSD_CONNECTED
+};
+
+/* Latest PPS report: the edge as seen by the GNSS (real) and by the system clock */
+typedef struct GPSD_pps_struct {
+  int64_t       real_sec;
+  int32_t       real_nsec;
+  int64_t       clock_sec;
+  int32_t       clock_nsec;
+  int64_t       offset_ns;  /* real - clock */
+  unsigned long marker;     /* millis() when received */
+  uint32_t      count;
+} GPSD_pps_t;
+
+typedef struct GPSD_stats_struct {
+  uint32_t  connects;
+  uint32_t  tpv;
+  uint32_t  sky;
+  uint32_t  pps;
+} GPSD_stats_t;
+
+void GPSD_setup(void);
+void GPSD_loop(void);
+void GPSD_fini(void);
+int  GPSD_fd(void);
+bool GPSD_connecting(void);
+bool GPSD_configure(const char *);
+
+extern GPSD_pps_t   GPSD_pps;
+extern GPSD_stats_t GPSD_stats;
+
+#endif /* RASPBERRY_PI */
+
+#endif /* GPSDHELPER_H */
@@ -0,0 +1,153 @@
+/*
+ * LineInHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LineIn.h"
+
+#if defined(RASPBERRY_PI)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Input is taken in bounded portions so that RF is never starved */
+#define LINEIN_MAX_READS    4
+
+void LineIn_init(LineIn_t *in, const char *name, int fd)
+{
+  in->name = name;
+  in->fd   = fd;
+
+  if (fd >= 0) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  }
+
+  LineIn_reset(in);
+  memset(&in->stats, 0, sizeof(in->stats));
+  in->rate_lines  = 0;
+  in->rate_marker = Time_ms();
+}
+
+/* Forget a partial line, e.g. after a reconnect */
+void LineIn_reset(LineIn_t *in)
+{
+  in->len     = 0;
+  in->eof     = false;
+  in->discard = false;
+}
+
+static uint8_t LineIn_kind(const char *line)
+{
+  switch (line[0])
+  {
+  case '$':  return LINEIN_NMEA;
+  case '{':  return LINEIN_JSON;
+  default:   return LINEIN_OTHER;
+  }
+}
+
+/* Hands out every complete line, returns the number of bytes consumed */
+static size_t LineIn_split(LineIn_t *in, LineIn_handler_t handler)
+{
+  char *start = in->buf;
+  char *end   = in->buf + in->len;
+  char *nl;
+
+  while (start < end && (nl = (char *) memchr(start, '\n', end - start)) != NULL) {
+    char *line = start;
+    size_t size = nl - start;
+
+    start = nl + 1;
+
+    if (in->discard) {
+      in->stats.dropped += size + 1;
+      in->discard = false;
+      continue;
+    }
+
+    if (size > 0 && line[size - 1] == '\r') {
+      size--;
+    }
+    if (size == 0) {
+      continue;
+    }
+    line[size] = 0;
+
+    uint8_t kind = LineIn_kind(line);
+
+    in->stats.lines[kind]++;
+    in->rate_lines++;
+
+    if (handler) {
+      handler(line, size, kind);
+    }
+  }
+
+  return start - in->buf;
+}
+
+void LineIn_poll(LineIn_t *in, LineIn_handler_t handler)
+{
+  if (in->fd < 0 || in->eof) {
+    return;
+  }
+
+  for (int i = 0; i < LINEIN_MAX_READS; i++) {
+    ssize_t n = read(in->fd, in->buf + in->len, sizeof(in->buf) - 1 - in->len);
+
+    if (n == 0) {
+      in->eof = true;
+      break;
+    }
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        in->eof = true;
+      }
+      break;
+    }
+
+    in->len += n;
+    in->stats.bytes += n;
+
+    size_t used = LineIn_split(in, handler);
+
+    /* the partial line at the end moves to the front, in one piece */
+    if (used > 0) {
+      in->len -= used;
+      memmove(in->buf, in->buf + used, in->len);
+    }
+
+    /* no room for the rest of this line - drop what there is of it */
+    if (in->len == sizeof(in->buf) - 1) {
+      in->stats.dropped += in->len;
+      in->len = 0;
+      in->discard = true;
+    }
+  }
+
+  if (Time_since(in->rate_marker) >= 1000) {
+    in->stats.lines_per_sec = in->rate_lines;
+    in->rate_lines  = 0;
+    in->rate_marker = Time_ms();
+  }
+}
+
+#endif /* RASPBERRY_PI */
@@ -0,0 +1,68 @@
+/*
+ * LineInHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINEINHELPER_H
+#define LINEINHELPER_H
+
+#include "../system/SoC.h"
+#include "../system/Time.h"
+
+#if defined(RASPBERRY_PI)
+
+#define LINEIN_BUFFER_SIZE  16384   /* longest line accepted is one byte less */
+
+enum
+{
+	LINEIN_NMEA,
+	LINEIN_JSON,
+	LINEIN_OTHER,
+	LINEIN_KINDS
+};
+
+typedef struct LineIn_stats_struct {
+  uint32_t  lines[LINEIN_KINDS];
+  uint32_t  bytes;
+  uint32_t  dropped;        /* bytes of overlong lines */
+  uint32_t  lines_per_sec;  /* over the last full second */
+} LineIn_stats_t;
+
+/*
+ * Lines are handed out in place, '\0' terminated, '\r' and '\n' stripped.
+ * A handler is free to modify a line (e.g. parse JSON in situ).
+ */
+typedef void (*LineIn_handler_t)(char *, size_t, uint8_t);
+
+typedef struct LineIn_struct {
+  const char        *name;
+  int               fd;
+  bool              eof;
+  bool              discard;  /* skipping the rest of an overlong line */
+  size_t            len;
+  char              buf[LINEIN_BUFFER_SIZE];
+  LineIn_stats_t    stats;
+  uint32_t          rate_lines;
+  uint64_t          rate_marker;
+} LineIn_t;
+
+void LineIn_init(LineIn_t *, const char *, int);
+void LineIn_poll(LineIn_t *, LineIn_handler_t);
+void LineIn_reset(LineIn_t *);
+
+#endif /* RASPBERRY_PI */
+
+#endif /* LINEINHELPER_H */
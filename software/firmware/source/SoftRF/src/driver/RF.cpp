@@ -21,6 +21,11 @@
 
 #include "RF.h"
 #include "../system/SoC.h"
+#include "../system/Time.h"
+#include "../system/Profile.h"
+#include "../system/Capture.h"
+#include "../system/Pipeline.h"
+#include "../protocol/data/NMEA.h"
 #include "EEPROM.h"
 #include "../ui/Web.h"
 #if !defined(EXCLUDE_MAVLINK)
@@ -34,13 +39,37 @@
 
 byte RxBuffer[MAX_PKT_SIZE] __attribute__((aligned(sizeof(uint32_t))));
 
-unsigned long TxTimeMarker = 0;
+uint64_t TxTimeMarker = 0;
 byte TxBuffer[MAX_PKT_SIZE] __attribute__((aligned(sizeof(uint32_t))));
 
 uint32_t tx_packets_counter = 0;
 uint32_t rx_packets_counter = 0;
 
 int8_t RF_last_rssi = 0;
+unsigned int RF_last_stamp = 0;
+uint64_t RF_last_utc = 0;
+uint64_t RF_last_tx_utc = 0;
+
+RF_stats_t RF_stats[RF_STATS_PROTOCOLS];
+RF_stats_t RF_stats_void;
+uint8_t RF_reject = RF_REJECT_DECODE;
+uint32_t RF_frequency = 0;
+
+static const char *RF_stats_name[RF_STATS_PROTOCOLS] = {
+  [RF_PROTOCOL_LEGACY]    = "legacy",
+  [RF_PROTOCOL_OGNTP]     = "ogntp",
+  [RF_PROTOCOL_P3I]       = "p3i",
+  [RF_PROTOCOL_ADSB_1090] = "adsb",
+  [RF_PROTOCOL_ADSB_UAT]  = "uat",
+  [RF_PROTOCOL_FANET]     = "fanet",
+};
+
+static const char *RF_reject_name[RF_REJECT_REASONS] = {
+  [RF_REJECT_DECODE]  = "decode",
+  [RF_REJECT_PARITY]  = "parity",
+  [RF_REJECT_SELF]    = "self",
+  [RF_REJECT_TYPE]    = "type",
+};
 
 FreqPlan RF_FreqPlan;
 static bool RF_ready = false;
@@ -83,6 +112,13 @@ static bool cc13xx_receive(void);
 static void cc13xx_transmit(void);
 static void cc13xx_shutdown(void);
 
+static bool virtual_probe(void);
+static void virtual_setup(void);
+static void virtual_channel(uint8_t);
+static bool virtual_receive(void);
+static void virtual_transmit(void);
+static void virtual_shutdown(void);
+
 static bool ognrf_probe(void);
 static void ognrf_setup(void);
 static void ognrf_channel(uint8_t);
@@ -150,6 +186,18 @@ const rfchip_ops_t cc13xx_ops = {
   cc13xx_shutdown
 };
 #endif /* EXCLUDE_CC13XX */
+#if defined(RASPBERRY_PI)
+const rfchip_ops_t virtual_ops = {
+  RF_IC_VIRTUAL,
+  "VIRTUAL",
+  virtual_probe,
+  virtual_setup,
+  virtual_channel,
+  virtual_receive,
+  virtual_transmit,
+  virtual_shutdown
+};
+#endif /* RASPBERRY_PI */
 #if defined(USE_OGN_RF_DRIVER)
 
 #define vTaskDelay  delay
@@ -198,6 +246,11 @@ byte RF_setup(void)
 
   if (rf_chip == NULL) {
 #if !defined(USE_OGN_RF_DRIVER)
+#if defined(RASPBERRY_PI)
+    if (virtual_ops.probe()) {
+      rf_chip = &virtual_ops;
+    } else
+#endif /* RASPBERRY_PI */
 #if !defined(EXCLUDE_SX12XX)
 #if !defined(EXCLUDE_SX1276)
     if (sx1276_ops.probe()) {
@@ -267,23 +320,34 @@ byte RF_setup(void)
   }
 }
 
-void RF_SetChannel(void)
+/*
+ * What channel selection needs of the main loop, taken on the main loop.
+ * The slot clock is as of the GNSS sentences: slot second 'second'
+ * began at Time_us() 'local'.
+ */
+void RF_Sync(RF_sync_t *sync)
 {
   tmElements_t tm;
-  time_t Time;
+
+  sync->latitude  = ThisAircraft.latitude;
+  sync->longitude = ThisAircraft.longitude;
+  sync->model     = false;
+  sync->local     = Time_us();
 
   switch (settings->mode)
   {
   case SOFTRF_MODE_TXRX_TEST:
-    Time = now();
+    sync->second = now();
     break;
 #if !defined(EXCLUDE_MAVLINK)
   case SOFTRF_MODE_UAV:
-    Time = the_aircraft.location.gps_time_stamp / 1000000;
+    sync->second = the_aircraft.location.gps_time_stamp / 1000000;
     break;
 #endif /* EXCLUDE_MAVLINK */
   case SOFTRF_MODE_NORMAL:
   default:
+    sync->model = true;
+
     unsigned long pps_btime_ms = SoC->get_PPS_TimeMarker();
     unsigned long time_corr_pos = 0;
     unsigned long time_corr_neg = 0;
@@ -310,9 +374,29 @@ void RF_SetChannel(void)
     tm.Minute = gnss.time.minute();
     tm.Second = gnss.time.second();
 
-    Time = makeTime(tm) + (gnss.time.age() - time_corr_neg + time_corr_pos)/ 1000;
+    /* ms past the labelled second: whole seconds, then the rest */
+    int32_t ms  = (int32_t) gnss.time.age() - (int32_t) time_corr_neg +
+                  (int32_t) time_corr_pos;
+    int32_t rem = (ms % 1000 + 1000) % 1000;
+
+    sync->second = makeTime(tm) + (ms - rem) / 1000;
+    sync->local -= (uint64_t) rem * 1000;
     break;
   }
+}
+
+void RF_SetChannel(const RF_sync_t *sync)
+{
+  time_t Time;
+  uint32_t utc_err;
+  uint64_t utc = sync->model ? utc_now_us(&utc_err) : 0;
+
+  /* slots open 400 ms after the PPS edge for V6, 350 ms - for OGNTP */
+  if (utc && utc_err < TIME_SLOT_ERROR) {
+    Time = (time_t) ((utc + 400000) / 1000000);
+  } else {
+    Time = sync->second + (time_t) ((Time_us() - sync->local) / 1000000);
+  }
 
   uint8_t Slot = 0; /* only #0 "400ms" timeslot is currently in use */
   uint8_t OGN = (settings->rf_protocol == RF_PROTOCOL_OGNTP ? 1 : 0);
@@ -324,6 +408,19 @@ void RF_SetChannel(void)
 
   uint8_t chan = RF_FreqPlan.getChannel(Time, Slot, OGN);
 
+  switch (settings->rf_protocol)
+  {
+  case RF_PROTOCOL_ADSB_UAT:
+    RF_frequency = 978000000UL;
+    break;
+  case RF_PROTOCOL_ADSB_1090:
+    RF_frequency = 1090000000UL;
+    break;
+  default:
+    RF_frequency = RF_FreqPlan.getChanFrequency(chan);
+    break;
+  }
+
 #if DEBUG
   Serial.print("Plan: "); Serial.println(RF_FreqPlan.Plan);
   Serial.print("Slot: "); Serial.println(Slot);
@@ -336,13 +433,14 @@ void RF_SetChannel(void)
   }
 }
 
-void RF_loop()
+/* Takes nothing but the sync from the main loop, so runs on any thread */
+void RF_Hop(const RF_sync_t *sync)
 {
   if (!RF_ready) {
     if (RF_FreqPlan.Plan == RF_BAND_AUTO) {
-      if (ThisAircraft.latitude || ThisAircraft.longitude) {
-        RF_FreqPlan.setPlan((int32_t)(ThisAircraft.latitude  * 600000),
-                            (int32_t)(ThisAircraft.longitude * 600000));
+      if (sync->latitude || sync->longitude) {
+        RF_FreqPlan.setPlan((int32_t)(sync->latitude  * 600000),
+                            (int32_t)(sync->longitude * 600000));
         RF_ready = true;
       }
     } else {
@@ -351,10 +449,18 @@ void RF_loop()
   }
 
   if (RF_ready) {
-    RF_SetChannel();
+    RF_SetChannel(sync);
   }
 }
 
+void RF_loop()
+{
+  RF_sync_t sync;
+
+  RF_Sync(&sync);
+  RF_Hop(&sync);
+}
+
 size_t RF_Encode(ufo_t *fop)
 {
   size_t size = 0;
@@ -364,13 +470,65 @@ size_t RF_Encode(ufo_t *fop)
       return size;
     }
 
-    if ((millis() - TxTimeMarker) > TxRandomValue) {
+    if (Time_since(TxTimeMarker) > TxRandomValue) {
       size = (*protocol_encode)((void *) &TxBuffer[0], fop);
     }
   }
   return size;
 }
 
+/* UTC of a Time_us() reading if it is good enough to stamp a frame with, or 0 */
+static uint64_t RF_utc(uint64_t local)
+{
+  uint32_t err;
+  uint64_t utc = Time_to_utc(local, &err);
+
+  return err < TIME_STAMP_ERROR ? utc : 0;
+}
+
+/*
+ * $PSRFI,<time>,<hex>,<rssi> for a frame received, $PSRFO,<time>,<hex>
+ * for one sent; the time to the microsecond when known, else whole seconds.
+ * The sentence goes out in one piece, through the export stage while the
+ * pipeline runs, so call it from the main loop only.
+ */
+void RF_PrintFrame(bool tx, const byte *raw, size_t size, uint64_t utc,
+                   time_t timestamp, int8_t rssi)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  char buf[40 + 2 * MAX_PKT_SIZE];
+  size_t len;
+
+  size = size > MAX_PKT_SIZE ? MAX_PKT_SIZE : size;
+
+  if (utc) {
+    len = snprintf(buf, sizeof(buf), "$PSRF%c,%lu.%06lu,", tx ? 'O' : 'I',
+                   (unsigned long) (utc / 1000000), (unsigned long) (utc % 1000000));
+  } else {
+    len = snprintf(buf, sizeof(buf), "$PSRF%c,%lu,", tx ? 'O' : 'I',
+                   (unsigned long) timestamp);
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    buf[len++] = hex[raw[i] >> 4];
+    buf[len++] = hex[raw[i] & 0xF];
+  }
+
+  if (!tx) {
+    len += snprintf(buf + len, sizeof(buf) - len, ",%d", rssi);
+  }
+  buf[len++] = '\r';
+  buf[len++] = '\n';
+
+#if defined(RASPBERRY_PI)
+  if (Pipeline_defer(NMEA_UART, (byte *) buf, len, false)) {
+    return;
+  }
+#endif /* RASPBERRY_PI */
+
+  StdOut.write((byte *) buf, len);
+}
+
 bool RF_Transmit(size_t size, bool wait)
 {
   if (RF_ready && rf_chip && (size > 0)) {
@@ -380,20 +538,31 @@ bool RF_Transmit(size_t size, bool wait)
       return true;
     }
 
-    if (!wait || (millis() - TxTimeMarker) > TxRandomValue) {
+    if (!wait || Time_since(TxTimeMarker) > TxRandomValue) {
 
       time_t timestamp = now();
+      uint64_t utc = RF_utc(Time_us());
+      uint32_t start = Profile_start();
 
       rf_chip->transmit();
+      Profile_stop(PROFILE_TX, start);
+
+      Capture_frame((byte *) &TxBuffer[0], RF_Payload_Size(settings->rf_protocol),
+                    0, utc, true);
+      RF_last_tx_utc = utc;
 
-      if (settings->nmea_p) {
-        StdOut.print(F("$PSRFO,"));
-        StdOut.print((unsigned long) timestamp);
-        StdOut.print(F(","));
-        StdOut.println(Bin2Hex((byte *) &TxBuffer[0],
-                               RF_Payload_Size(settings->rf_protocol)));
+#if defined(RASPBERRY_PI)
+      /* the radio stage hands the frame back to the main loop to print */
+      if (settings->nmea_p && !Pipeline_active())
+#else
+      if (settings->nmea_p)
+#endif /* RASPBERRY_PI */
+      {
+        RF_PrintFrame(true, TxBuffer, RF_Payload_Size(settings->rf_protocol),
+                      utc, timestamp, 0);
       }
       tx_packets_counter++;
+      RF_STATS(settings->rf_protocol).tx_sent++;
       RF_tx_size = 0;
 
       TxRandomValue = (
@@ -403,25 +572,196 @@ bool RF_Transmit(size_t size, bool wait)
 #endif
         SoC->random(LEGACY_TX_INTERVAL_MIN, LEGACY_TX_INTERVAL_MAX));
 
-      TxTimeMarker = millis();
+      TxTimeMarker = Time_ms();
 
       return true;
     }
+
+    RF_STATS(settings->rf_protocol).tx_deferred++;
   }
   return false;
 }
 
+/* Time_ms() value past which the duty cycle rule lets the next packet out */
+uint64_t RF_Transmit_deadline()
+{
+  if (!RF_ready || !rf_chip || settings->txpower == RF_TX_POWER_OFF) {
+    return 0;
+  }
+
+  return TxTimeMarker + TxRandomValue + 1;
+}
+
 bool RF_Receive(void)
 {
   bool rval = false;
 
   if (RF_ready && rf_chip) {
+    /* drivers that know when the frame came in overwrite it */
+    unsigned int start = micros();
+
+    RF_last_stamp = start;
     rval = rf_chip->receive();
+
+    if (rval) {
+      RF_stats_t *stats = &RF_STATS(settings->rf_protocol);
+      int bucket = (RF_last_rssi - RF_RSSI_FLOOR) / RF_RSSI_STEP;
+
+      Profile_stop(PROFILE_RX, start);
+      if (RF_last_stamp != start) {
+        Profile_stop(PROFILE_RX_WAIT, RF_last_stamp);
+      }
+      RF_last_utc = RF_utc(Time_us() - (unsigned int) (micros() - RF_last_stamp));
+
+      stats->rx_ok++;
+      stats->rssi[constrain(bucket, 0, RF_RSSI_BUCKETS - 1)]++;
+
+      /* every frame, fix or not, on the channel it came in on */
+      Capture_frame((byte *) &RxBuffer[0], RF_Payload_Size(settings->rf_protocol),
+                    RF_last_rssi, RF_last_utc, false);
+    }
   }
   
   return rval;
 }
 
+#if defined(RASPBERRY_PI)
+static int virtual_fd = -1;
+
+/* Descriptor that becomes readable on a radio IRQ, or -1 */
+int RF_irq_fd()
+{
+  if (rf_chip == &virtual_ops) {
+    return virtual_fd;
+  }
+
+#if defined(USE_BASICMAC)
+  /* SX1276 DIO0 signals RX and TX done, unless the radio driver owns the line */
+  if (rf_chip == &sx1276_ops && lmic_pins.dio[0] == LMIC_UNUSED_PIN) {
+    return hal_irq_open(SOC_GPIO_PIN_DIO0);
+  }
+#endif /* USE_BASICMAC */
+
+  return -1;
+}
+#endif /* RASPBERRY_PI */
+
+static bool RF_Stats_empty(RF_stats_t *stats)
+{
+  static const RF_stats_t none = { 0 };
+
+  return memcmp(stats, &none, sizeof(none)) == 0;
+}
+
+/*
+ * For every protocol that has seen any traffic:
+ * $PSRFS,LINK,<protocol>,<rx>,<crc fail>,<fec corrected>,<fec fail>,
+ *        <reject decode>,<parity>,<self>,<type>,<duplicates>,<tx>,<tx deferred>
+ * $PSRFS,RSSI,<protocol>,<floor dBm>,<step dB>,<count>,...
+ */
+void RF_Stats_NMEA(uint8_t dest)
+{
+  char buf[NMEA_BATCH_SIZE];
+  NmeaWriter_t w;
+
+  NMEA_writer_init(&w, buf, sizeof(buf), dest);
+
+  for (uint8_t p = 0; p < RF_STATS_PROTOCOLS; p++) {
+    RF_stats_t *stats = &RF_stats[p];
+
+    if (RF_Stats_empty(stats)) {
+      continue;
+    }
+
+    NMEA_begin(&w, "PSRFS,LINK");
+    NMEA_field(&w); NMEA_put_str(&w, RF_stats_name[p]);
+    NMEA_field(&w); NMEA_put_uint(&w, stats->rx_ok, 0);
+    NMEA_field(&w); NMEA_put_uint(&w, stats->crc_fail, 0);
+    NMEA_field(&w); NMEA_put_uint(&w, stats->fec_corrected, 0);
+    NMEA_field(&w); NMEA_put_uint(&w, stats->fec_fail, 0);
+    for (uint8_t r = 0; r < RF_REJECT_REASONS; r++) {
+      NMEA_field(&w); NMEA_put_uint(&w, stats->reject[r], 0);
+    }
+    NMEA_field(&w); NMEA_put_uint(&w, stats->duplicates, 0);
+    NMEA_field(&w); NMEA_put_uint(&w, stats->tx_sent, 0);
+    NMEA_field(&w); NMEA_put_uint(&w, stats->tx_deferred, 0);
+    NMEA_end(&w);
+
+    NMEA_begin(&w, "PSRFS,RSSI");
+    NMEA_field(&w); NMEA_put_str(&w, RF_stats_name[p]);
+    NMEA_field(&w); NMEA_put_int(&w, RF_RSSI_FLOOR);
+    NMEA_field(&w); NMEA_put_uint(&w, RF_RSSI_STEP, 0);
+    for (uint8_t b = 0; b < RF_RSSI_BUCKETS; b++) {
+      NMEA_field(&w); NMEA_put_uint(&w, stats->rssi[b], 0);
+    }
+    NMEA_end(&w);
+  }
+
+  NMEA_flush(&w);
+}
+
+/* One JSON object, keyed by protocol, NUL terminated; returns its length or 0 */
+size_t RF_Stats_JSON(char *buf, size_t size)
+{
+  size_t len = 0;
+  bool first = true;
+  int n;
+
+#define RF_STATS_PUT(...)                                           \
+  do {                                                              \
+    n = snprintf(buf + len, size - len, __VA_ARGS__);               \
+    if (n < 0 || (size_t) n >= size - len) { buf[0] = 0; return 0; } \
+    len += n;                                                       \
+  } while (0)
+
+  if (size == 0) {
+    return 0;
+  }
+
+  RF_STATS_PUT("{");
+
+  for (uint8_t p = 0; p < RF_STATS_PROTOCOLS; p++) {
+    RF_stats_t *stats = &RF_stats[p];
+
+    if (RF_Stats_empty(stats)) {
+      continue;
+    }
+
+    RF_STATS_PUT("%s\"%s\":{\"rx\":%lu,\"crc_fail\":%lu,\"fec_corrected\":%lu,"
+                 "\"fec_fail\":%lu,\"reject\":{",
+                 first ? "" : ",", RF_stats_name[p],
+                 (unsigned long) stats->rx_ok, (unsigned long) stats->crc_fail,
+                 (unsigned long) stats->fec_corrected, (unsigned long) stats->fec_fail);
+    first = false;
+
+    for (uint8_t r = 0; r < RF_REJECT_REASONS; r++) {
+      RF_STATS_PUT("%s\"%s\":%lu", r ? "," : "", RF_reject_name[r],
+                   (unsigned long) stats->reject[r]);
+    }
+
+    RF_STATS_PUT("},\"duplicates\":%lu,\"tx\":%lu,\"tx_deferred\":%lu,"
+                 "\"rssi\":{\"floor\":%d,\"step\":%d,\"count\":[",
+                 (unsigned long) stats->duplicates, (unsigned long) stats->tx_sent,
+                 (unsigned long) stats->tx_deferred, RF_RSSI_FLOOR, RF_RSSI_STEP);
+
+    for (uint8_t b = 0; b < RF_RSSI_BUCKETS; b++) {
+      RF_STATS_PUT("%s%lu", b ? "," : "", (unsigned long) stats->rssi[b]);
+    }
+    RF_STATS_PUT("]}}");
+  }
+
+  RF_STATS_PUT("}");
+
+#undef RF_STATS_PUT
+
+  return len;
+}
+
+void RF_Stats_reset()
+{
+  memset(RF_stats, 0, sizeof(RF_stats));
+}
+
 void RF_Shutdown(void)
 {
   if (rf_chip) {
@@ -922,6 +1262,10 @@ static bool sx12xx_receive()
     }
 
     RF_last_rssi = LMIC.rssi;
+#if defined(RASPBERRY_PI) && defined(USE_BASICMAC)
+    /* end of frame, as of the IRQ edge when there is one */
+    RF_last_stamp = (unsigned int) (LMIC.rxtime << US_PER_OSTICK_EXPONENT);
+#endif /* RASPBERRY_PI && USE_BASICMAC */
     rx_packets_counter++;
     success = true;
   }
@@ -948,6 +1292,9 @@ static void sx12xx_transmit()
 static void sx12xx_shutdown()
 {
   LMIC_shutdown();
+#if defined(RASPBERRY_PI) && defined(USE_BASICMAC)
+  hal_irq_close();
+#endif /* RASPBERRY_PI && USE_BASICMAC */
   SPI.end();
 
   pinMode(lmic_pins.nss, INPUT);
@@ -976,6 +1323,7 @@ static void sx12xx_rx_func (osjob_t* job) {
 
   /* FANET (LoRa) LMIC IRQ handler may deliver empty packets here when CRC is invalid. */
   if (LMIC.dataLen == 0) {
+    RF_STATS(LMIC.protocol->type).crc_fail++;
     return;
   }
 
@@ -1063,6 +1411,7 @@ static void sx12xx_rx_func (osjob_t* job) {
         LMIC.frame[i], LMIC.frame[i+1], LMIC.frame[i+2],
         LMIC.frame[i+3], LMIC.frame[i+4], LMIC.frame[i+5]);
 #endif
+      RF_STATS(LMIC.protocol->type).fec_fail++;
       sx12xx_receive_complete = false;
     } else {
       sx12xx_receive_complete = true;
@@ -1080,6 +1429,7 @@ static void sx12xx_rx_func (osjob_t* job) {
     if (crc8 == pkt_crc8) {
       sx12xx_receive_complete = true;
     } else {
+      RF_STATS(LMIC.protocol->type).crc_fail++;
       sx12xx_receive_complete = false;
     }
     break;
@@ -1097,6 +1447,7 @@ static void sx12xx_rx_func (osjob_t* job) {
     if (crc16 == pkt_crc16) {
       sx12xx_receive_complete = true;
     } else {
+      RF_STATS(LMIC.protocol->type).crc_fail++;
       sx12xx_receive_complete = false;
     }
     break;
@@ -1353,8 +1704,12 @@ static bool uatm_receive()
       int frame_type = correct_adsb_frame(uatradio_frame.data, &rs_errors);
 
       if (frame_type == -1) {
+        RF_stats[RF_PROTOCOL_ADSB_UAT].fec_fail++;
         continue;
       }
+      if (rs_errors > 0) {
+        RF_stats[RF_PROTOCOL_ADSB_UAT].fec_corrected++;
+      }
 
       u1_t size = 0;
 
@@ -1537,6 +1892,8 @@ void cc13xx_Receive_callback(EasyLink_RxPacket *rxPacket_ptr, EasyLink_Status st
           if (LDPC_Check((uint8_t  *) &RxBuffer[0]) == 0) {
 
             success = true;
+          } else {
+            RF_STATS(cc13xx_protocol->type).fec_fail++;
           }
           break;
         case RF_CHECKSUM_TYPE_CCITT_FFFF:
@@ -1547,6 +1904,8 @@ void cc13xx_Receive_callback(EasyLink_RxPacket *rxPacket_ptr, EasyLink_Status st
             if (crc16 == pkt_crc16) {
 
               success = true;
+            } else {
+              RF_STATS(cc13xx_protocol->type).crc_fail++;
             }
           }
           break;
@@ -1562,7 +1921,12 @@ void cc13xx_Receive_callback(EasyLink_RxPacket *rxPacket_ptr, EasyLink_Status st
       int frame_type;
       frame_type = correct_adsb_frame(rxPacket_ptr->payload, &rs_errors);
 
-      if (frame_type != -1) {
+      if (frame_type == -1) {
+        RF_stats[RF_PROTOCOL_ADSB_UAT].fec_fail++;
+      } else {
+        if (rs_errors > 0) {
+          RF_stats[RF_PROTOCOL_ADSB_UAT].fec_corrected++;
+        }
 
         if (frame_type == 1) {
           size = SHORT_FRAME_DATA_BYTES;
@@ -2068,6 +2432,8 @@ static bool ognrf_receive()
     TRX.ReadPacket(RxBuffer, Err);
     if (LDPC_Check((uint8_t  *) RxBuffer) == 0) {
       success = true;
+    } else {
+      RF_stats[RF_PROTOCOL_OGNTP].fec_fail++;
     }
   }
 
@@ -2126,3 +2492,215 @@ static void ognrf_shutdown()
 }
 
 #endif /* USE_OGN_RF_DRIVER */
+
+#if defined(RASPBERRY_PI)
+/*
+ * Virtual radio specific code
+ *
+ * Frames go out as UDP datagrams to a multicast group on the loopback
+ * interface - the "air" that every SoftRF process on the host listens to.
+ * A frame is heard on the same protocol and channel only, as over the air.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define VIRTUAL_MAGIC     0x5F
+
+typedef struct virtual_frame_struct {
+  uint8_t   magic;
+  uint8_t   protocol;
+  uint8_t   channel;
+  uint8_t   size;
+  uint32_t  sender;   /* multicast loops own frames back */
+  byte      payload[MAX_PKT_SIZE];
+} __attribute__((packed)) virtual_frame_t;
+
+#define VIRTUAL_HEADER_SIZE offsetof(virtual_frame_t, payload)
+
+static struct sockaddr_in virtual_air;
+static bool     virtual_enabled = false;
+static uint32_t virtual_sender;
+static uint8_t  virtual_chan = 0;
+
+/* "group:port", "group" or "OFF" */
+bool RF_virtual_configure(const char *air)
+{
+  char group[INET_ADDRSTRLEN];
+  const char *colon = strchr(air, ':');
+  size_t len = colon ? colon - air : strlen(air);
+  int port = colon ? atoi(colon + 1) : VIRTUAL_AIR_PORT;
+
+  if (!strcmp(air, "OFF")) {
+    virtual_enabled = false;
+    return true;
+  }
+
+  if (len >= sizeof(group) || port <= 0 || port > 65535) {
+    return false;
+  }
+  memcpy(group, air, len);
+  group[len] = 0;
+
+  memset(&virtual_air, 0, sizeof(virtual_air));
+  virtual_air.sin_family = AF_INET;
+  virtual_air.sin_port   = htons(port);
+  if (inet_pton(AF_INET, group, &virtual_air.sin_addr) != 1 ||
+      !IN_MULTICAST(ntohl(virtual_air.sin_addr.s_addr))) {
+    return false;
+  }
+
+  virtual_enabled = true;
+
+  return true;
+}
+
+static bool virtual_probe()
+{
+  struct sockaddr_in local;
+  struct ip_mreq mreq;
+  struct in_addr lo;
+  unsigned char loop = 1;
+  int one = 1;
+
+  if (!virtual_enabled) {
+    return false;
+  }
+
+  virtual_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (virtual_fd < 0) {
+    perror("socket");
+    return false;
+  }
+
+  /* every process on the host binds the same port */
+  setsockopt(virtual_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(virtual_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+  memset(&local, 0, sizeof(local));
+  local.sin_family      = AF_INET;
+  local.sin_port        = virtual_air.sin_port;
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  lo.s_addr = htonl(INADDR_LOOPBACK);
+  mreq.imr_multiaddr = virtual_air.sin_addr;
+  mreq.imr_interface = lo;
+
+  if (bind(virtual_fd, (struct sockaddr *) &local, sizeof(local)) < 0 ||
+      setsockopt(virtual_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0 ||
+      setsockopt(virtual_fd, IPPROTO_IP, IP_MULTICAST_IF,   &lo,   sizeof(lo))   < 0 ||
+      setsockopt(virtual_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+    perror("virtual radio");
+    close(virtual_fd);
+    virtual_fd = -1;
+    return false;
+  }
+
+  virtual_sender = ((uint32_t) getpid() << 16) ^ (uint32_t) Time_us();
+
+  return true;
+}
+
+static void virtual_setup()
+{
+  switch (settings->rf_protocol)
+  {
+  case RF_PROTOCOL_OGNTP:
+    protocol_encode = &ogntp_encode;
+    protocol_decode = &ogntp_decode;
+    break;
+  case RF_PROTOCOL_P3I:
+    protocol_encode = &p3i_encode;
+    protocol_decode = &p3i_decode;
+    break;
+  case RF_PROTOCOL_FANET:
+    protocol_encode = &fanet_encode;
+    protocol_decode = &fanet_decode;
+    break;
+  case RF_PROTOCOL_LEGACY:
+  default:
+    protocol_encode = &legacy_encode;
+    protocol_decode = &legacy_decode;
+    settings->rf_protocol = RF_PROTOCOL_LEGACY;
+    break;
+  }
+
+#if !defined(EXCLUDE_SX12XX)
+  /* same transmit intervals as an SX12XX would keep */
+  switch (settings->rf_protocol)
+  {
+  case RF_PROTOCOL_OGNTP: LMIC.protocol = &ogntp_proto_desc;  break;
+  case RF_PROTOCOL_P3I:   LMIC.protocol = &p3i_proto_desc;    break;
+  case RF_PROTOCOL_FANET: LMIC.protocol = &fanet_proto_desc;  break;
+  default:                LMIC.protocol = &legacy_proto_desc; break;
+  }
+#endif /* EXCLUDE_SX12XX */
+}
+
+static void virtual_channel(uint8_t channel)
+{
+  virtual_chan = channel;
+}
+
+static bool virtual_receive()
+{
+  virtual_frame_t frame;
+  ssize_t n;
+
+  while (true) {
+    n = recv(virtual_fd, &frame, sizeof(frame), 0);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+
+    if (n < (ssize_t) VIRTUAL_HEADER_SIZE         ||
+        frame.magic    != VIRTUAL_MAGIC             ||
+        frame.size     >  sizeof(frame.payload)     ||
+        n < (ssize_t) (VIRTUAL_HEADER_SIZE + frame.size) ||
+        frame.sender   == virtual_sender            ||
+        frame.protocol != settings->rf_protocol     ||
+        frame.channel  != virtual_chan) {
+      continue;
+    }
+
+    memset(RxBuffer, 0, sizeof(RxBuffer));
+    memcpy(RxBuffer, frame.payload, frame.size);
+
+    RF_last_rssi = VIRTUAL_RSSI;
+    rx_packets_counter++;
+
+    return true;
+  }
+}
+
+static void virtual_transmit()
+{
+  virtual_frame_t frame;
+
+  frame.magic    = VIRTUAL_MAGIC;
+  frame.protocol = settings->rf_protocol;
+  frame.channel  = virtual_chan;
+  frame.size     = RF_Payload_Size(settings->rf_protocol);
+  frame.sender   = virtual_sender;
+  memcpy(frame.payload, TxBuffer, frame.size);
+
+  sendto(virtual_fd, &frame, VIRTUAL_HEADER_SIZE + frame.size, MSG_DONTWAIT,
+         (struct sockaddr *) &virtual_air, sizeof(virtual_air));
+}
+
+static void virtual_shutdown()
+{
+  if (virtual_fd >= 0) {
+    close(virtual_fd);
+    virtual_fd = -1;
+  }
+}
+
+#endif /* RASPBERRY_PI */
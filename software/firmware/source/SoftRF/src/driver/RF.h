@@ -51,6 +51,11 @@
                              P3I_PAYLOAD_SIZE, FANET_PAYLOAD_SIZE, \
                              UAT978_PAYLOAD_SIZE)
 
+/* Virtual radio "air": a multicast group on the loopback interface */
+#define VIRTUAL_AIR_GROUP "239.255.41.1"
+#define VIRTUAL_AIR_PORT  41110
+#define VIRTUAL_RSSI      -70
+
 #define RXADDR {0x31, 0xfa , 0xb6} // Address of this device (4 bytes)
 #define TXADDR {0x31, 0xfa , 0xb6} // Address of device to send to (4 bytes)
 
@@ -62,7 +67,8 @@ enum
   RF_IC_UATM,
   RF_IC_CC13XX,
   RF_DRV_OGN,
-  RF_IC_SX1262
+  RF_IC_SX1262,
+  RF_IC_VIRTUAL
 };
 
 enum
@@ -72,6 +78,43 @@ enum
   RF_TX_POWER_OFF
 };
 
+/*
+ * Link statistics are kept for the protocols up to FANET; the events of
+ * any other go to RF_stats_void, which is never reported.
+ */
+#define RF_STATS_PROTOCOLS  (RF_PROTOCOL_FANET + 1)
+#define RF_STATS(protocol)  (*((protocol) < RF_STATS_PROTOCOLS ? \
+                               &RF_stats[(protocol)] : &RF_stats_void))
+
+/* RSSI histogram: RF_RSSI_BUCKETS steps of RF_RSSI_STEP dBm from RF_RSSI_FLOOR up */
+#define RF_RSSI_FLOOR       -130
+#define RF_RSSI_STEP        10
+#define RF_RSSI_BUCKETS     11
+
+#define RF_STATS_JSON_SIZE  2560
+
+/* Why a decoder has turned a frame down */
+enum
+{
+	RF_REJECT_DECODE,   /* anything not given below */
+	RF_REJECT_PARITY,   /* parity or checksum of the payload */
+	RF_REJECT_SELF,     /* own packet, relayed back */
+	RF_REJECT_TYPE,     /* message type not handled */
+	RF_REJECT_REASONS
+};
+
+typedef struct RF_stats_struct {
+  uint32_t  rx_ok;          /* frames the radio driver has passed on */
+  uint32_t  crc_fail;
+  uint32_t  fec_corrected;  /* frames with errors that the FEC has repaired */
+  uint32_t  fec_fail;
+  uint32_t  reject[RF_REJECT_REASONS];
+  uint32_t  duplicates;     /* same payload from the same aircraft again */
+  uint32_t  tx_sent;
+  uint32_t  tx_deferred;    /* packets held back by the duty cycle rule */
+  uint32_t  rssi[RF_RSSI_BUCKETS];
+} RF_stats_t;
+
 typedef struct rfchip_ops_struct {
   byte type;
   const char name[8];
@@ -83,20 +126,44 @@ typedef struct rfchip_ops_struct {
   void (*shutdown)();
 } rfchip_ops_t;
 
+/*
+ * Inputs of the channel selection that belong to the main loop: a slot
+ * clock from the GNSS sentences, for when the UTC model is not good
+ * enough, and own ship position for the automatic band plan
+ */
+typedef struct RF_sync_struct {
+  time_t    second;
+  uint64_t  local;          /* Time_us() the slot second began at */
+  bool      model;          /* the UTC model comes first (normal mode) */
+  float     latitude;
+  float     longitude;
+} RF_sync_t;
+
 String Bin2Hex(byte *, size_t);
 uint8_t parity(uint32_t);
 
 byte    RF_setup(void);
-void    RF_SetChannel(void);
+void    RF_Sync(RF_sync_t *);
+void    RF_SetChannel(const RF_sync_t *);
+void    RF_Hop(const RF_sync_t *);
 void    RF_loop(void);
 size_t  RF_Encode(ufo_t *);
 bool    RF_Transmit(size_t, bool);
+uint64_t RF_Transmit_deadline(void);
 bool    RF_Receive(void);
+#if defined(RASPBERRY_PI)
+int     RF_irq_fd(void);
+bool    RF_virtual_configure(const char *);
+#endif /* RASPBERRY_PI */
 void    RF_Shutdown(void);
 uint8_t RF_Payload_Size(uint8_t);
+void    RF_PrintFrame(bool, const byte *, size_t, uint64_t, time_t, int8_t);
+void    RF_Stats_NMEA(uint8_t);
+size_t  RF_Stats_JSON(char *, size_t);
+void    RF_Stats_reset(void);
 
 extern byte TxBuffer[MAX_PKT_SIZE], RxBuffer[MAX_PKT_SIZE];
-extern unsigned long TxTimeMarker;
+extern uint64_t TxTimeMarker;
 
 extern const rfchip_ops_t *rf_chip;
 extern bool RF_SX12XX_RST_is_connected;
@@ -104,5 +171,12 @@ extern size_t (*protocol_encode)(void *, ufo_t *);
 extern bool (*protocol_decode)(void *, ufo_t *, ufo_t *);
 
 extern int8_t RF_last_rssi;
+extern unsigned int RF_last_stamp;  /* micros() at the end of the last frame */
+extern uint64_t RF_last_utc;        /* UTC in us of the same, or 0 */
+extern uint64_t RF_last_tx_utc;     /* UTC in us of the last frame sent, or 0 */
+extern RF_stats_t RF_stats[RF_STATS_PROTOCOLS];
+extern RF_stats_t RF_stats_void;
+extern uint8_t RF_reject;           /* set by a decoder that returns false */
+extern uint32_t RF_frequency;       /* Hz, of the channel set last */
 
 #endif /* RFHELPER_H */
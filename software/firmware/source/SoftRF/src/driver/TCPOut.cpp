@@ -0,0 +1,511 @@
+/*
+ * TCPOutHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TCPOut.h"
+#include "EEPROM.h"
+#include "../protocol/data/NMEA.h"
+#include "../protocol/data/GDL90.h"
+#include "../protocol/data/D1090.h"
+
+#if defined(USE_TCP_OUTPUT)
+
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define TCPOUT_MAX_EVENTS     16
+#define TCPOUT_LISTEN_SLOT    0xFF
+#define TCPOUT_TAG(ch, slot)  (((uint32_t) (ch) << 8) | (slot))
+
+typedef struct TCPOut_channel_struct {
+  const char      *name;
+  int             port;
+  int             listen_fd;
+  int             clients;
+  TCPOut_chunk_t  *pending;
+  TCPOut_client_t client[MAX_TCPOUT_CLIENTS];
+} TCPOut_channel_t;
+
+static TCPOut_channel_t TCPOut_channel[TCPOUT_CHANNELS] = {
+  [TCPOUT_NMEA]  = { "NMEA",  NMEA_TCP_PORT,  -1 },
+  [TCPOUT_GDL90] = { "GDL90", GDL90_TCP_PORT, -1 },
+  [TCPOUT_D1090] = { "D1090", D1090_TCP_PORT, -1 },
+};
+
+TCPOut_stats_t TCPOut_stats[TCPOUT_CHANNELS];
+
+static int TCPOut_epoll_fd = -1;
+
+static bool TCPOut_is_enabled(uint8_t ch)
+{
+  switch (ch)
+  {
+  case TCPOUT_NMEA:   return settings->nmea_out == NMEA_TCP;
+  case TCPOUT_GDL90:  return settings->gdl90    == GDL90_TCP;
+  case TCPOUT_D1090:  return settings->d1090    == D1090_TCP;
+  default:            return false;
+  }
+}
+
+static void TCPOut_release(TCPOut_chunk_t *chunk)
+{
+  if (--chunk->refs == 0) {
+    free(chunk);
+  }
+}
+
+static void TCPOut_watch(uint8_t ch, uint8_t slot, int fd, int op, uint32_t events)
+{
+  struct epoll_event ev;
+
+  ev.events   = events;
+  ev.data.u64 = TCPOUT_TAG(ch, slot);
+
+  epoll_ctl(TCPOut_epoll_fd, op, fd, &ev);
+}
+
+static void TCPOut_disconnect(uint8_t ch, uint8_t slot)
+{
+  TCPOut_channel_t *chan = &TCPOut_channel[ch];
+  TCPOut_client_t  *cl   = &chan->client[slot];
+
+  if (cl->fd < 0) {
+    return;
+  }
+
+  epoll_ctl(TCPOut_epoll_fd, EPOLL_CTL_DEL, cl->fd, NULL);
+  close(cl->fd);
+
+  while (cl->count > 0) {
+    TCPOut_release(cl->queue[cl->head]);
+    cl->head = (cl->head + 1) % TCPOUT_QUEUE_DEPTH;
+    cl->count--;
+  }
+
+  cl->fd      = -1;
+  cl->head    = 0;
+  cl->offset  = 0;
+  cl->bytes   = 0;
+  cl->pollout = false;
+
+  chan->clients--;
+}
+
+static void TCPOut_accept(uint8_t ch)
+{
+  TCPOut_channel_t *chan = &TCPOut_channel[ch];
+
+  for (;;) {
+    int fd = accept4(chan->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break; /* EAGAIN or a transient error */
+    }
+
+    uint8_t slot;
+    for (slot = 0; slot < MAX_TCPOUT_CLIENTS; slot++) {
+      if (chan->client[slot].fd < 0) {
+        break;
+      }
+    }
+
+    if (slot >= MAX_TCPOUT_CLIENTS) {
+      /* no free spot so reject */
+      close(fd);
+      TCPOut_stats[ch].rejected++;
+      continue;
+    }
+
+    /* every write is already a whole batch - do not let Nagle delay it */
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    TCPOut_client_t *cl = &chan->client[slot];
+
+    cl->fd      = fd;
+    cl->head    = 0;
+    cl->count   = 0;
+    cl->offset  = 0;
+    cl->bytes   = 0;
+    cl->pollout = false;
+
+    TCPOut_watch(ch, slot, fd, EPOLL_CTL_ADD, EPOLLIN | EPOLLRDHUP);
+
+    chan->clients++;
+    TCPOut_stats[ch].accepted++;
+  }
+}
+
+/* Client input (e.g. $PFLAC queries from an EFB) is not used - drain it */
+static void TCPOut_drain(uint8_t ch, uint8_t slot)
+{
+  TCPOut_client_t *cl = &TCPOut_channel[ch].client[slot];
+  char buf[256];
+
+  for (;;) {
+    ssize_t n = recv(cl->fd, buf, sizeof(buf), MSG_DONTWAIT);
+
+    if (n > 0) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    TCPOut_disconnect(ch, slot);
+    return;
+  }
+}
+
+/*
+ * Send as much of the client's queue as the socket accepts,
+ * all the queued chunks at once with a single gather write.
+ */
+static void TCPOut_flush(uint8_t ch, uint8_t slot)
+{
+  TCPOut_client_t *cl = &TCPOut_channel[ch].client[slot];
+
+  while (cl->count > 0) {
+    struct iovec  iov[TCPOUT_QUEUE_DEPTH];
+    struct msghdr msg;
+
+    for (uint8_t i = 0; i < cl->count; i++) {
+      TCPOut_chunk_t *chunk = cl->queue[(cl->head + i) % TCPOUT_QUEUE_DEPTH];
+      size_t skip = (i == 0 ? cl->offset : 0);
+
+      iov[i].iov_base = chunk->data + skip;
+      iov[i].iov_len  = chunk->size - skip;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = cl->count;
+
+    ssize_t sent = sendmsg(cl->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    TCPOut_stats[ch].syscalls++;
+
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        if (!cl->pollout) {
+          TCPOut_watch(ch, slot, cl->fd, EPOLL_CTL_MOD,
+                       EPOLLIN | EPOLLRDHUP | EPOLLOUT);
+          cl->pollout = true;
+        }
+        return;
+      }
+      TCPOut_disconnect(ch, slot);
+      return;
+    }
+
+    TCPOut_stats[ch].bytes += sent;
+    cl->bytes -= sent;
+
+    while (sent > 0) {
+      TCPOut_chunk_t *chunk = cl->queue[cl->head];
+      size_t remain = chunk->size - cl->offset;
+
+      if ((size_t) sent >= remain) {
+        sent -= remain;
+        TCPOut_release(chunk);
+        cl->head = (cl->head + 1) % TCPOUT_QUEUE_DEPTH;
+        cl->count--;
+        cl->offset = 0;
+      } else {
+        cl->offset += sent;
+        sent = 0;
+      }
+    }
+  }
+
+  if (cl->pollout) {
+    TCPOut_watch(ch, slot, cl->fd, EPOLL_CTL_MOD, EPOLLIN | EPOLLRDHUP);
+    cl->pollout = false;
+  }
+}
+
+/*
+ * Hand the data collected during this cycle over to every client
+ * of the channel. Clients that could not keep up are dropped.
+ */
+static void TCPOut_commit(uint8_t ch)
+{
+  TCPOut_channel_t *chan  = &TCPOut_channel[ch];
+  TCPOut_chunk_t   *chunk = chan->pending;
+
+  if (chunk == NULL || chunk->size == 0) {
+    return;
+  }
+
+  chan->pending = NULL;
+  chunk->refs = 1; /* hold it until fan-out is over */
+
+  for (uint8_t slot = 0; slot < MAX_TCPOUT_CLIENTS; slot++) {
+    TCPOut_client_t *cl = &chan->client[slot];
+
+    if (cl->fd < 0) {
+      continue;
+    }
+
+    if (cl->count >= TCPOUT_QUEUE_DEPTH ||
+        cl->bytes + chunk->size > TCPOUT_QUEUE_BYTES) {
+      fprintf(stderr, "%s TCP client #%d is too slow - dropped.\n",
+              chan->name, slot);
+      TCPOut_disconnect(ch, slot);
+      TCPOut_stats[ch].dropped++;
+      continue;
+    }
+
+    cl->queue[(cl->head + cl->count) % TCPOUT_QUEUE_DEPTH] = chunk;
+    cl->count++;
+    cl->bytes += chunk->size;
+    chunk->refs++;
+  }
+
+  TCPOut_stats[ch].chunks++;
+  TCPOut_release(chunk);
+}
+
+static void TCPOut_open(uint8_t ch)
+{
+  TCPOut_channel_t *chan = &TCPOut_channel[ch];
+  struct sockaddr_in addr;
+  int one = 1;
+
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("socket");
+    return;
+  }
+
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port        = htons(chan->port);
+
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+      listen(fd, MAX_TCPOUT_CLIENTS) < 0) {
+    fprintf(stderr, "Unable to start %s TCP server at port %d: %s\n",
+            chan->name, chan->port, strerror(errno));
+    close(fd);
+    return;
+  }
+
+  chan->listen_fd = fd;
+  for (uint8_t slot = 0; slot < MAX_TCPOUT_CLIENTS; slot++) {
+    chan->client[slot].fd = -1;
+  }
+  chan->clients = 0;
+
+  TCPOut_watch(ch, TCPOUT_LISTEN_SLOT, fd, EPOLL_CTL_ADD, EPOLLIN);
+
+  Serial.print(chan->name);
+  Serial.print(F(" TCP server has started at port: "));
+  Serial.println((unsigned long) chan->port);
+}
+
+static void TCPOut_close(uint8_t ch)
+{
+  TCPOut_channel_t *chan = &TCPOut_channel[ch];
+
+  if (chan->listen_fd < 0) {
+    return;
+  }
+
+  for (uint8_t slot = 0; slot < MAX_TCPOUT_CLIENTS; slot++) {
+    TCPOut_disconnect(ch, slot);
+  }
+
+  epoll_ctl(TCPOut_epoll_fd, EPOLL_CTL_DEL, chan->listen_fd, NULL);
+  close(chan->listen_fd);
+  chan->listen_fd = -1;
+
+  if (chan->pending) {
+    free(chan->pending);
+    chan->pending = NULL;
+  }
+}
+
+/*
+ * Can be called again whenever settings are changed:
+ * servers are started or stopped to match the output selection.
+ */
+void TCPOut_setup()
+{
+  if (TCPOut_epoll_fd < 0) {
+    TCPOut_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (TCPOut_epoll_fd < 0) {
+      perror("epoll_create1");
+      return;
+    }
+  }
+
+  for (uint8_t ch = 0; ch < TCPOUT_CHANNELS; ch++) {
+    bool enabled = TCPOut_is_enabled(ch);
+
+    if (enabled && TCPOut_channel[ch].listen_fd < 0) {
+      TCPOut_open(ch);
+    } else if (!enabled && TCPOut_channel[ch].listen_fd >= 0) {
+      TCPOut_close(ch);
+    }
+  }
+}
+
+void TCPOut_loop()
+{
+  struct epoll_event events[TCPOUT_MAX_EVENTS];
+
+  if (TCPOut_epoll_fd < 0) {
+    return;
+  }
+
+  int n = epoll_wait(TCPOut_epoll_fd, events, TCPOUT_MAX_EVENTS, 0);
+
+  for (int i = 0; i < n; i++) {
+    uint8_t ch   = (events[i].data.u64 >> 8) & 0xFF;
+    uint8_t slot = events[i].data.u64 & 0xFF;
+
+    if (ch >= TCPOUT_CHANNELS) {
+      continue;
+    }
+
+    if (slot == TCPOUT_LISTEN_SLOT) {
+      TCPOut_accept(ch);
+      continue;
+    }
+
+    if (TCPOut_channel[ch].client[slot].fd < 0) {
+      continue;
+    }
+
+    if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+      TCPOut_disconnect(ch, slot);
+      continue;
+    }
+    if (events[i].events & EPOLLIN) {
+      TCPOut_drain(ch, slot);
+    }
+    if ((events[i].events & EPOLLOUT) && TCPOut_channel[ch].client[slot].fd >= 0) {
+      TCPOut_flush(ch, slot);
+    }
+  }
+
+  for (uint8_t ch = 0; ch < TCPOUT_CHANNELS; ch++) {
+    TCPOut_channel_t *chan = &TCPOut_channel[ch];
+
+    if (chan->listen_fd < 0) {
+      continue;
+    }
+
+    TCPOut_commit(ch);
+
+    for (uint8_t slot = 0; slot < MAX_TCPOUT_CLIENTS; slot++) {
+      TCPOut_client_t *cl = &chan->client[slot];
+
+      /* sockets waiting for EPOLLOUT are flushed by the event above */
+      if (cl->fd >= 0 && cl->count > 0 && !cl->pollout) {
+        TCPOut_flush(ch, slot);
+      }
+    }
+  }
+}
+
+void TCPOut_fini()
+{
+  for (uint8_t ch = 0; ch < TCPOUT_CHANNELS; ch++) {
+    TCPOut_close(ch);
+  }
+
+  if (TCPOut_epoll_fd >= 0) {
+    close(TCPOut_epoll_fd);
+    TCPOut_epoll_fd = -1;
+  }
+}
+
+/*
+ * Append data to the current cycle of the channel.
+ * Nothing is sent until the next TCPOut_loop().
+ */
+void TCPOut_write(uint8_t ch, const byte *buf, size_t size)
+{
+  if (ch >= TCPOUT_CHANNELS || size == 0) {
+    return;
+  }
+
+  TCPOut_channel_t *chan  = &TCPOut_channel[ch];
+  TCPOut_chunk_t   *chunk = chan->pending;
+
+  if (chan->listen_fd < 0 || chan->clients == 0) {
+    return;
+  }
+
+  size_t used = chunk ? chunk->size : 0;
+
+  if (chunk == NULL || used + size > chunk->capacity) {
+    size_t capacity = chunk ? chunk->capacity * 2 : TCPOUT_CHUNK_MIN;
+
+    while (capacity < used + size) {
+      capacity *= 2;
+    }
+
+    chunk = (TCPOut_chunk_t *) realloc(chunk,
+              offsetof(TCPOut_chunk_t, data) + capacity);
+    if (chunk == NULL) {
+      free(chan->pending);
+      chan->pending = NULL;
+      return;
+    }
+
+    chunk->refs     = 0;
+    chunk->size     = used;
+    chunk->capacity = capacity;
+    chan->pending   = chunk;
+  }
+
+  memcpy(chunk->data + chunk->size, buf, size);
+  chunk->size += size;
+}
+
+/* To be used by an outer event loop: readable when there is work to do */
+int TCPOut_fd()
+{
+  return TCPOut_epoll_fd;
+}
+
+int TCPOut_clients_count(uint8_t ch)
+{
+  return ch < TCPOUT_CHANNELS ? TCPOut_channel[ch].clients : 0;
+}
+
+#endif /* USE_TCP_OUTPUT */
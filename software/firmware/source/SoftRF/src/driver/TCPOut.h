@@ -0,0 +1,81 @@
+/*
+ * TCPOutHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TCPOUTHELPER_H
+#define TCPOUTHELPER_H
+
+#include "../system/SoC.h"
+
+#if defined(USE_TCP_OUTPUT)
+
+#define MAX_TCPOUT_CLIENTS    8
+#define TCPOUT_QUEUE_DEPTH    16          /* chunks (export cycles) per client */
+#define TCPOUT_QUEUE_BYTES    (64 * 1024) /* slow client drop threshold */
+#define TCPOUT_CHUNK_MIN      1024
+
+enum
+{
+	TCPOUT_NMEA,
+	TCPOUT_GDL90,
+	TCPOUT_D1090,
+	TCPOUT_CHANNELS
+};
+
+/*
+ * One chunk carries everything that has been written into a channel
+ * during one pass of the main loop. It is shared by reference between
+ * all the clients of the channel and is released by the last one.
+ */
+typedef struct TCPOut_chunk_struct {
+  uint32_t  refs;
+  size_t    size;
+  size_t    capacity;
+  byte      data[1];
+} TCPOut_chunk_t;
+
+typedef struct TCPOut_client_struct {
+  int             fd;
+  TCPOut_chunk_t  *queue[TCPOUT_QUEUE_DEPTH];
+  uint8_t         head;
+  uint8_t         count;
+  size_t          offset;   /* bytes of the head chunk already sent */
+  size_t          bytes;    /* total bytes still queued */
+  bool            pollout;
+} TCPOut_client_t;
+
+typedef struct TCPOut_stats_struct {
+  uint32_t  accepted;
+  uint32_t  rejected;
+  uint32_t  dropped;        /* slow clients */
+  uint32_t  chunks;
+  uint32_t  syscalls;
+  uint64_t  bytes;
+} TCPOut_stats_t;
+
+void TCPOut_setup(void);
+void TCPOut_loop(void);
+void TCPOut_fini(void);
+void TCPOut_write(uint8_t, const byte *, size_t);
+int  TCPOut_fd(void);
+int  TCPOut_clients_count(uint8_t);
+
+extern TCPOut_stats_t TCPOut_stats[TCPOUT_CHANNELS];
+
+#endif /* USE_TCP_OUTPUT */
+
+#endif /* TCPOUTHELPER_H */
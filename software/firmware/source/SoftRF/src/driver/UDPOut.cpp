@@ -0,0 +1,254 @@
+/*
+ * UDPOutHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UDPOut.h"
+
+UDPOut_stats_t UDPOut_stats;
+
+#if defined(EXCLUDE_WIFI) && !defined(RASPBERRY_PI)
+void UDPOut_write(uint8_t ch, const byte *buf, size_t size, bool nl) {}
+void UDPOut_loop()  {}
+#else
+
+/*
+ * Messages of one channel (NMEA sentences, GDL90 frames) are packed
+ * back-to-back into datagrams of up to UDPOUT_PAYLOAD_SIZE bytes.
+ * A message never spans two datagrams.
+ */
+typedef struct UDPOut_channel_struct {
+  uint8_t   count;
+  uint16_t  size[UDPOUT_DATAGRAMS];
+  byte      data[UDPOUT_DATAGRAMS][UDPOUT_PAYLOAD_SIZE];
+} UDPOut_channel_t;
+
+static UDPOut_channel_t UDPOut_channel[UDPOUT_CHANNELS];
+
+static const uint16_t UDPOut_port[UDPOUT_CHANNELS] = {
+  [UDPOUT_NMEA]  = NMEA_UDP_PORT,
+  [UDPOUT_GDL90] = GDL90_DST_PORT,
+};
+
+#if defined(RASPBERRY_PI)
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define UDPOUT_MAX_MSGS (UDPOUT_CHANNELS * UDPOUT_DATAGRAMS * UDPOUT_MAX_DESTINATIONS)
+
+static int UDPOut_sock = -1;
+static struct in_addr UDPOut_dst[UDPOUT_MAX_DESTINATIONS];
+static uint8_t UDPOut_dst_count = 0;
+
+static struct mmsghdr     UDPOut_msgs [UDPOUT_MAX_MSGS];
+static struct iovec       UDPOut_iovs [UDPOUT_MAX_MSGS];
+static struct sockaddr_in UDPOut_addrs[UDPOUT_MAX_MSGS];
+
+static bool UDPOut_open()
+{
+  if (UDPOut_sock < 0) {
+    int one = 1;
+
+    UDPOut_sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (UDPOut_sock < 0) {
+      perror("socket");
+      return false;
+    }
+    setsockopt(UDPOut_sock, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+  }
+
+  return true;
+}
+
+void UDPOut_clear_destinations()
+{
+  UDPOut_dst_count = 0;
+}
+
+bool UDPOut_add_destination(const char *host)
+{
+  struct in_addr addr;
+
+  if (UDPOut_dst_count >= UDPOUT_MAX_DESTINATIONS ||
+      inet_pton(AF_INET, host, &addr) != 1) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < UDPOut_dst_count; i++) {
+    if (UDPOut_dst[i].s_addr == addr.s_addr) {
+      return true;
+    }
+  }
+
+  UDPOut_dst[UDPOut_dst_count++] = addr;
+
+  return true;
+}
+
+/* Broadcast on the local segment unless destinations are given */
+static uint8_t UDPOut_destinations(const struct in_addr **dst)
+{
+  static const struct in_addr broadcast = { htonl(INADDR_BROADCAST) };
+
+  if (UDPOut_dst_count == 0) {
+    *dst = &broadcast;
+    return 1;
+  }
+
+  *dst = UDPOut_dst;
+  return UDPOut_dst_count;
+}
+
+static unsigned int UDPOut_queue(unsigned int n, int port, byte *buf, size_t size)
+{
+  const struct in_addr *dst;
+  uint8_t dst_count = UDPOut_destinations(&dst);
+
+  for (uint8_t i = 0; i < dst_count && n < UDPOUT_MAX_MSGS; i++, n++) {
+    memset(&UDPOut_addrs[n], 0, sizeof(UDPOut_addrs[n]));
+    UDPOut_addrs[n].sin_family = AF_INET;
+    UDPOut_addrs[n].sin_port   = htons(port);
+    UDPOut_addrs[n].sin_addr   = dst[i];
+
+    UDPOut_iovs[n].iov_base = buf;
+    UDPOut_iovs[n].iov_len  = size;
+
+    memset(&UDPOut_msgs[n], 0, sizeof(UDPOut_msgs[n]));
+    UDPOut_msgs[n].msg_hdr.msg_name    = &UDPOut_addrs[n];
+    UDPOut_msgs[n].msg_hdr.msg_namelen = sizeof(UDPOut_addrs[n]);
+    UDPOut_msgs[n].msg_hdr.msg_iov     = &UDPOut_iovs[n];
+    UDPOut_msgs[n].msg_hdr.msg_iovlen  = 1;
+  }
+
+  return n;
+}
+
+static void UDPOut_sendmmsg(unsigned int vlen)
+{
+  unsigned int done = 0;
+
+  if (!UDPOut_open()) {
+    return;
+  }
+
+  while (done < vlen) {
+    int n = sendmmsg(UDPOut_sock, &UDPOut_msgs[done], vlen - done, MSG_DONTWAIT);
+    UDPOut_stats.syscalls++;
+
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      /* socket buffer is full - the rest of this cycle is lost, as with any UDP */
+      break;
+    }
+    done += n;
+  }
+}
+
+/* Single datagram to every destination */
+void UDPOut_transmit(int port, byte *buf, size_t size)
+{
+  UDPOut_sendmmsg(UDPOut_queue(0, port, buf, size));
+}
+
+/* All the datagrams of the channels given, to all destinations, in one go */
+static void UDPOut_send(uint8_t first, uint8_t last)
+{
+  unsigned int n = 0;
+
+  for (uint8_t ch = first; ch <= last; ch++) {
+    UDPOut_channel_t *chan = &UDPOut_channel[ch];
+
+    for (uint8_t i = 0; i < chan->count; i++) {
+      n = UDPOut_queue(n, UDPOut_port[ch], chan->data[i], chan->size[i]);
+    }
+    UDPOut_stats.datagrams += chan->count;
+    chan->count = 0;
+  }
+
+  if (n > 0) {
+    UDPOut_sendmmsg(n);
+  }
+}
+
+#else
+
+static void UDPOut_send(uint8_t first, uint8_t last)
+{
+  for (uint8_t ch = first; ch <= last; ch++) {
+    UDPOut_channel_t *chan = &UDPOut_channel[ch];
+
+    if (SoC->WiFi_transmit_UDP) {
+      for (uint8_t i = 0; i < chan->count; i++) {
+        SoC->WiFi_transmit_UDP(UDPOut_port[ch], chan->data[i], chan->size[i]);
+        UDPOut_stats.syscalls++;
+      }
+    }
+    UDPOut_stats.datagrams += chan->count;
+    chan->count = 0;
+  }
+}
+
+#endif /* RASPBERRY_PI */
+
+void UDPOut_write(uint8_t ch, const byte *buf, size_t size, bool nl)
+{
+  if (ch >= UDPOUT_CHANNELS || size == 0) {
+    return;
+  }
+
+  UDPOut_channel_t *chan = &UDPOut_channel[ch];
+  size_t need = size + (nl ? 1 : 0);
+
+  if (need > UDPOUT_PAYLOAD_SIZE) {
+    need = UDPOUT_PAYLOAD_SIZE;
+    size = need - (nl ? 1 : 0);
+    UDPOut_stats.truncated++;
+  }
+
+  if (chan->count == 0 || chan->size[chan->count - 1] + need > UDPOUT_PAYLOAD_SIZE) {
+    if (chan->count >= UDPOUT_DATAGRAMS) {
+      UDPOut_send(ch, ch);
+    }
+    chan->size[chan->count++] = 0;
+  }
+
+  byte *ptr = chan->data[chan->count - 1] + chan->size[chan->count - 1];
+
+  memcpy(ptr, buf, size);
+  if (nl) {
+    ptr[size] = '\n';
+  }
+  chan->size[chan->count - 1] += need;
+
+  UDPOut_stats.messages++;
+}
+
+/*
+ * To be called once per pass of the main loop,
+ * after the exporters are done with their cycle.
+ */
+void UDPOut_loop()
+{
+  UDPOut_send(0, UDPOUT_CHANNELS - 1);
+}
+
+#endif /* EXCLUDE_WIFI && !RASPBERRY_PI */
@@ -0,0 +1,61 @@
+/*
+ * UDPOutHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UDPOUTHELPER_H
+#define UDPOUTHELPER_H
+
+#include "../system/SoC.h"
+
+/* Ethernet/WiFi MTU less IPv4 and UDP headers */
+#if !defined(UDPOUT_PAYLOAD_SIZE)
+#define UDPOUT_PAYLOAD_SIZE     (1500 - 20 - 8)
+#endif
+
+/* Datagrams kept per channel before they have to go out */
+#if !defined(UDPOUT_DATAGRAMS)
+#define UDPOUT_DATAGRAMS        1
+#endif
+
+#define UDPOUT_MAX_DESTINATIONS 8
+
+enum
+{
+	UDPOUT_NMEA,
+	UDPOUT_GDL90,
+	UDPOUT_CHANNELS
+};
+
+typedef struct UDPOut_stats_struct {
+  uint32_t  messages;
+  uint32_t  datagrams;
+  uint32_t  syscalls;
+  uint32_t  truncated;
+} UDPOut_stats_t;
+
+void UDPOut_write(uint8_t, const byte *, size_t, bool);
+void UDPOut_loop(void);
+
+#if defined(RASPBERRY_PI)
+void UDPOut_clear_destinations(void);
+bool UDPOut_add_destination(const char *);
+void UDPOut_transmit(int, byte *, size_t);
+#endif /* RASPBERRY_PI */
+
+extern UDPOut_stats_t UDPOut_stats;
+
+#endif /* UDPOUTHELPER_H */
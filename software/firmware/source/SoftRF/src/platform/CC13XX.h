@@ -90,12 +90,16 @@ struct rst_info {
 //#define EXCLUDE_EEPROM
 #define EXCLUDE_LED_RING
 #define EXCLUDE_EGM96
+#define EXCLUDE_COVERAGE
 #define EXCLUDE_NRF905
 #define EXCLUDE_UATM
 
 /* SoftRF/CC13XX PFLAU NMEA sentence extension(s) */
-#define PFLAU_EXT1_FMT  ",%06X,%d,%d,%d,%d"
-#define PFLAU_EXT1_ARGS ,ThisAircraft.addr,settings->rf_protocol,rx_packets_counter,tx_packets_counter,(int)(Battery_voltage()*100)
+#define PFLAU_EXT1(w)   { NMEA_field(w); NMEA_put_hex(w, ThisAircraft.addr, 6);              \
+                          NMEA_field(w); NMEA_put_int(w, settings->rf_protocol);             \
+                          NMEA_field(w); NMEA_put_int(w, rx_packets_counter);                \
+                          NMEA_field(w); NMEA_put_int(w, tx_packets_counter);                \
+                          NMEA_field(w); NMEA_put_int(w, (int) (Battery_voltage() * 100)); }
 
 #include "../../hal_conf_extra.h"   // Sketch-specific definitions are located there
 
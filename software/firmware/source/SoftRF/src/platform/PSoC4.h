@@ -139,6 +139,7 @@ struct rst_info {
 #define EXCLUDE_TEST_MODE
 #define EXCLUDE_WATCHOUT_MODE
 #define EXCLUDE_TRAFFIC_FILTER_EXTENSION
+#define EXCLUDE_COVERAGE
 
 #define EXCLUDE_GNSS_UBLOX
 #define EXCLUDE_GNSS_SONY
@@ -40,11 +40,56 @@
  *
  *  pi@raspberrypi $ wget -q -O - http://localhost:8080/data/aircraft.json | nc -N localhost 30007
  *
+ *  NMEA, GDL90 and D1090 output to multiple TCP clients (ports 2000, 4000 and 30002):
+ *
+ *  pi@raspberrypi $ { echo "{class:SOFTRF,nmea:{output:TCP},gdl90:TCP,d1090:TCP}" ; cat /dev/ttyUSB0 ; } | sudo ./SoftRF
+ *
+ *  Own-ship position comes from a local gpsd (127.0.0.1:2947) by default.
+ *  The client is on unless turned off, and tries to connect every 5 seconds
+ *  for as long as there is no gpsd. NMEA on stdin is parsed either way.
+ *  Another instance, or none at all:
+ *
+ *  pi@raspberrypi $ { echo "{class:SOFTRF,gpsd:\"10.0.0.2:2947\"}" ; cat /dev/ttyUSB0 ; } | sudo ./SoftRF
+ *  pi@raspberrypi $ { echo "{class:SOFTRF,gpsd:OFF}" ; gpspipe -w ; } | sudo ./SoftRF
+ *
+ *  Stage timing histograms and radio link statistics,
+ *  as $PSRFS sentences on the NMEA output or as JSON:
+ *
+ *  pi@raspberrypi $ { echo '$PSRFS,?' ; cat /dev/ttyUSB0 ; } | sudo ./SoftRF
+ *  pi@raspberrypi $ echo "{class:STATS}" | nc -q 1 localhost 30007
+ *
+ *  Receiver coverage map (bearing sectors by range rings), kept across
+ *  restarts in /var/tmp/SoftRF-coverage.dat:
+ *
+ *  pi@raspberrypi $ echo "{class:COVERAGE}" | nc -q 1 localhost 30007
+ *
+ *  Binary capture of all frames received and sent, and its conversion into pcap:
+ *
+ *  pi@raspberrypi $ cat /dev/ttyUSB0 | sudo ./SoftRF --capture /var/tmp/SoftRF.srfc
+ *  pi@raspberrypi $ ./SoftRF --pcap /var/tmp/SoftRF.srfc SoftRF.pcap
+ *
+ *  Host side benchmarks (no hardware access, no root privileges required):
+ *
+ *  $ ./SoftRF --bench nmea d1090 json queue
+ *
+ *  The gpsd client against a scripted gpsd on a loopback port, with
+ *  a non-zero exit status when any of its checks fails:
+ *
+ *  $ ./SoftRF --bench gpsd
+ *
+ *  The host build draws the e-paper views into memory, and into a file
+ *  (PBM, or PNG by the name) on every refresh. "%u" numbers the frames:
+ *
+ *  $ make host
+ *  $ ./SoftRF-host --screen /tmp/radar-%u.png --view radar
+ *  $ ./SoftRF-host --bench views:200 --frames=/tmp/views
+ *
  */
 
 #if defined(RASPBERRY_PI)
 
 #include "../system/SoC.h"
+#include "../system/Time.h"
 #include "../driver/EEPROM.h"
 #include <TinyGPS++.h>
 #if !defined(EXCLUDE_MAVLINK)
@@ -63,11 +108,22 @@
 #include "../driver/EPD.h"
 #include "../driver/Battery.h"
 #include "../driver/Bluetooth.h"
+#include "../driver/TCPOut.h"
+#include "../driver/UDPOut.h"
+#include "../driver/LineIn.h"
+#include "../driver/GPSD.h"
+#include "../system/Bench.h"
+#include "../system/Replay.h"
+#include "../system/Event.h"
+#include "../system/Pipeline.h"
+#include "../system/Profile.h"
+#include "../system/Coverage.h"
+#include "../system/Capture.h"
 
 #include "TCPServer.h"
 
 #include <stdio.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 
 #include <iostream>
 
@@ -137,17 +193,36 @@ hardware_info_t hw_info = {
   .display  = DISPLAY_NONE
 };
 
-#define isTimeToExport() (millis() - ExportTimeMarker > 1000)
-unsigned long ExportTimeMarker = 0;
+#define isTimeToExport() (Time_since(ExportTimeMarker) > 1000)
+uint64_t ExportTimeMarker = 0;
+
+static LineIn_t RPi_StdIn;
+
+/*
+ * With no DIO line to wake the loop up, RX is polled this often.
+ * Otherwise the radio is still looked at every RPI_RADIO_GUARD_MS
+ * in case an edge has been missed.
+ */
+#define RPI_RADIO_POLL_MS     2
+#define RPI_RADIO_GUARD_MS    100
+#define RPI_IDLE_MS           1000  /* the radio has got a thread of its own */
 
-std::string input_line;
+static bool RPi_radio_irq = false;
 
 TCPServer Traffic_TCP_Server;
 
 #if defined(USE_EPAPER)
-GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> __attribute__ ((common)) epd_waveshare(GxEPD2_270(/*CS=5*/ 8,
+#if defined(USE_EPD_CANVAS)
+EPD_display_t epd_canvas((EPD_Canvas()));
+static const char *RPi_screen = NULL;
+
+/* --view names, in VIEW_MODE_* order */
+static const char *RPi_views[] = { "status", "radar", "text", "time" };
+#else
+EPD_display_t __attribute__ ((common)) epd_waveshare(GxEPD2_270(/*CS=5*/ 8,
                                        /*DC=*/ 25, /*RST=*/ 17, /*BUSY=*/ 24));
-GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> *display;
+#endif /* USE_EPD_CANVAS */
+EPD_display_t *display;
 #endif /* USE_EPAPER */
 
 ui_settings_t ui_settings = {
@@ -249,7 +324,8 @@ void RPi_SerialNumber(void)
 
 //----- end of MIT License ------------------------------------------------
 
-static void RPi_setup()
+/* Settings as they are until the first reconfiguration */
+void RPi_defaults()
 {
   eeprom_block.field.magic                  = SOFTRF_EEPROM_MAGIC;
   eeprom_block.field.version                = SOFTRF_EEPROM_VERSION;
@@ -277,8 +353,15 @@ static void RPi_setup()
   eeprom_block.field.settings.freq_corr     = 0;
 
   ui = &ui_settings;
+}
 
+static void RPi_setup()
+{
+  RPi_defaults();
+
+#if !defined(USE_VIRTUAL_RADIO)
   RPi_SerialNumber();
+#endif /* USE_VIRTUAL_RADIO */
 }
 
 static void RPi_post_init()
@@ -329,6 +412,11 @@ static uint32_t RPi_getChipId()
 {
   uint32_t id = SerialNumber ? SerialNumber : gethostid();
 
+#if defined(USE_VIRTUAL_RADIO)
+  /* processes sharing the air of one host need addresses of their own */
+  id ^= (uint32_t) getpid();
+#endif /* USE_VIRTUAL_RADIO */
+
   /* remap address to avoid overlapping with congested FLARM range */
   if (((id & 0x00FFFFFF) >= 0xDD0000) && ((id & 0x00FFFFFF) <= 0xDFFFFF)) {
     id += 0x100000;
@@ -349,7 +437,7 @@ static long RPi_random(long howsmall, long howBig)
 
 static void RPi_WiFi_transmit_UDP(int port, byte *buf, size_t size)
 {
-  /* TBD */
+  UDPOut_transmit(port, buf, size);
 }
 
 static void RPi_SPI_begin()
@@ -368,7 +456,26 @@ static byte RPi_Display_setup()
 {
   byte rval = DISPLAY_NONE;
 
-#if defined(USE_EPAPER)
+#if defined(USE_EPAPER) && defined(USE_EPD_CANVAS)
+  /* the views drawn into memory, and into files when asked for */
+  if (RPi_screen == NULL) {
+    return rval;
+  }
+
+  display = &epd_canvas;
+  display->epd2.dump = RPi_screen;
+
+  if (EPD_setup(true)) {
+    display->epd2.rotation = display->getRotation();
+
+    if ( pthread_create(&RPi_EPD_update_thread, NULL, &EPD_Task, (void *)0) != 0) {
+      fprintf( stderr, "pthread_create(EPD_Task) Failed\n\n" );
+      exit(EXIT_FAILURE);
+    }
+
+    rval = DISPLAY_EPD_1_54;
+  }
+#elif defined(USE_EPAPER) && !defined(USE_VIRTUAL_RADIO)
 // GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> *epd_waveshare = new GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT>(GxEPD2_270(/*CS=5*/ 8,
 //                                       /*DC=*/ 25, /*RST=*/ 17, /*BUSY=*/ 24));
 
@@ -397,7 +504,8 @@ static byte RPi_Display_setup()
 static void RPi_Display_loop()
 {
 #if defined(USE_EPAPER)
-  if (hw_info.display == DISPLAY_EPD_2_7) {
+  if (hw_info.display != DISPLAY_NONE) {
+    PROFILE(PROFILE_DISPLAY);
     EPD_loop();
   }
 #endif /* USE_EPAPER */
@@ -407,6 +515,10 @@ static void RPi_Display_fini(int reason)
 {
 #if defined(USE_EPAPER)
 
+  if (display == NULL) {
+    return;
+  }
+
   EPD_Clear_Screen();
   EPD_fini(reason);
 
@@ -431,7 +543,15 @@ void RPi_GNSS_PPS_Interrupt_handler() {
   PPS_TimeMarker = millis();
 }
 
+/* millis() at the latest PPS edge, as the disciplined clock has it */
 static unsigned long RPi_get_PPS_TimeMarker() {
+  Time_model_t m;
+
+  Time_model(&m);
+  if (m.source == TIME_SOURCE_PPS) {
+    return millis() - (unsigned long) ((Time_us() - m.local) / 1000);
+  }
+
   return PPS_TimeMarker;
 }
 
@@ -533,24 +653,14 @@ const SoC_ops_t RPi_ops = {
   RPi_Button_fini
 };
 
-static bool inputAvailable()
-{
-  struct timeval tv;
-  fd_set fds;
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
-  FD_ZERO(&fds);
-  FD_SET(STDIN_FILENO, &fds);
-  select(STDIN_FILENO+1, &fds, NULL, NULL, &tv);
-  return (FD_ISSET(0, &fds));
-}
-
 static void parseNMEA(const char *str, int len)
 {
   // NMEA input
   for (int i=0; i < len; i++) {
     gnss.encode(str[i]);
   }
+  /* LineIn strips the line ending, which is what closes a sentence */
+  gnss.encode('\n');
   if (settings->nmea_g) {
     NMEA_Out(settings->nmea_out, (byte *) str, len, true);
   }
@@ -558,78 +668,137 @@ static void parseNMEA(const char *str, int len)
   GNSSTimeSync();
 
   if (isValidGNSSFix()) {
-    ThisAircraft.latitude = gnss.location.lat();
-    ThisAircraft.longitude = gnss.location.lng();
-    ThisAircraft.altitude = gnss.altitude.meters();
-    ThisAircraft.course = gnss.course.deg();
-    ThisAircraft.speed = gnss.speed.knots();
-    ThisAircraft.hdop = (uint16_t) gnss.hdop.value();
-    ThisAircraft.geoid_separation = gnss.separation.meters();
-
-    /*
-     * When geoidal separation is zero or not available - use approx. EGM96 value
-     */
-    if (ThisAircraft.geoid_separation == 0.0) {
-      ThisAircraft.geoid_separation = (float) LookupSeparation(
-                                                ThisAircraft.latitude,
-                                                ThisAircraft.longitude
-                                              );
-      /* we can assume the GPS unit is giving ellipsoid height */
-      ThisAircraft.altitude -= ThisAircraft.geoid_separation;
-    }
+    GNSS_Ownship(&ThisAircraft);
   }
 }
 
-static void RPi_PickGNSSFix()
+/* Wake up on the radio IRQ line, edges of which also date the frames */
+static bool RPi_radio_irq_setup()
 {
-  if (inputAvailable()) {
-    std::getline(std::cin, input_line);
-    const char *str = input_line.c_str();
-    int len = input_line.length();
+  int fd = RF_irq_fd();
 
-    if (str[0] == '$' && str[1] == 'G') {
-      // NMEA input
-      parseNMEA(str, len);
+  if (fd < 0) {
+    return false;
+  }
+  Event_watch(EVENT_RADIO, fd, EPOLLIN);
 
-    } else if (str[0] == '{') {
-      // JSON input
+  return true;
+}
 
-      JsonObject& root = jsonBuffer.parseObject(str);
+static void RPi_Reconfigure(JsonObject& root)
+{
+  /* settings and hardware are shared with the radio and export stages */
+  Pipeline_pause();
 
-      JsonVariant msg_class = root["class"];
+  parseSettings(root);
 
-      if (msg_class.success()) {
-        const char *msg_class_s = msg_class.as<char*>();
+  RF_setup();
+  Traffic_setup();
+  TCPOut_setup();
 
-        if (!strcmp(msg_class_s,"TPV")) { // "TPV"
-          parseTPV(root);
-        } else if (!strcmp(msg_class_s,"SOFTRF")) {
-          parseSettings(root);
+  Pipeline_resume();
 
-          RF_setup();
-          Traffic_setup();
-        }
-      }
+  if (settings->mode != SOFTRF_MODE_NORMAL) {
+    Pipeline_fini();
+  }
+  if (!Pipeline_active() && !RPi_radio_irq) {
+    RPi_radio_irq = RPi_radio_irq_setup();
+  }
+}
 
-      if (root.containsKey("now") &&
-          root.containsKey("messages") &&
-          root.containsKey("aircraft")) {
-        /* 'aircraft.json' output from 'dump1090' application */
-        parseD1090(root);
-      } else if (root.containsKey("aircraft")) {
-        /* uAvionix PingStation */
-        parsePING(root);
-      }
+static void RPi_ParseInput(char *str, size_t len, uint8_t kind)
+{
+  if (kind == LINEIN_NMEA && str[1] == 'G') {
+    // NMEA input
+    parseNMEA(str, len);
 
-      jsonBuffer.clear();
+  } else if (kind == LINEIN_NMEA && !strncmp(str, "$PSRFS,?", 8)) {
+    Profile_NMEA(settings->nmea_out);
+    RF_Stats_NMEA(settings->nmea_out);
+
+  } else if (kind == LINEIN_JSON) {
+    // JSON input, parsed in place
+
+    JsonObject& root = jsonBuffer.parseObject(str);
+
+    JsonVariant msg_class = root["class"];
 
-      if ((time(NULL) - now()) > 3) {
-        hasValidGPSDFix = false;
+    if (msg_class.success()) {
+      const char *msg_class_s = msg_class.as<char*>();
+
+      if (!strcmp(msg_class_s,"TPV")) { // "TPV"
+        parseTPV(root);
+      } else if (!strcmp(msg_class_s,"SOFTRF")) {
+        RPi_Reconfigure(root);
       }
     }
+
+    if (root.containsKey("now") &&
+        root.containsKey("messages") &&
+        root.containsKey("aircraft")) {
+      /* 'aircraft.json' output from 'dump1090' application */
+      parseD1090(root);
+    } else if (root.containsKey("aircraft")) {
+      /* uAvionix PingStation */
+      parsePING(root);
+    }
+
+    jsonBuffer.clear();
+
+    if ((time(NULL) - now()) > 3) {
+      hasValidGPSDFix = false;
+    }
   }
 }
 
+/* Every complete line that has arrived since the previous pass */
+static void RPi_PickGNSSFix()
+{
+  LineIn_poll(&RPi_StdIn, RPi_ParseInput);
+
+  GPSD_loop();
+
+  Time_pps_loop();
+}
+
+/* Reply to the client of the JSON server */
+static void RPi_SendStats()
+{
+  static char profile[PROFILE_JSON_SIZE];
+  static char link[RF_STATS_JSON_SIZE];
+  string reply;
+
+  if (Profile_JSON(profile, sizeof(profile)) == 0 ||
+      RF_Stats_JSON(link, sizeof(link)) == 0) {
+    return;
+  }
+
+  reply  = "{\"class\":\"STATS\",\"profile\":";
+  reply += profile;
+  reply += ",\"link\":";
+  reply += link;
+  reply += "}\n";
+
+  Traffic_TCP_Server.Send(reply);
+}
+
+/* Polar receiver coverage map, to the client of the JSON server */
+static void RPi_SendCoverage()
+{
+  static char coverage[COVERAGE_JSON_SIZE];
+  string reply;
+
+  if (Coverage_JSON(coverage, sizeof(coverage)) == 0) {
+    return;
+  }
+
+  reply  = "{\"class\":\"COVERAGE\",\"coverage\":";
+  reply += coverage;
+  reply += "}\n";
+
+  Traffic_TCP_Server.Send(reply);
+}
+
 static void RPi_ReadTraffic()
 {
   string traffic_input = Traffic_TCP_Server.getMessage();
@@ -650,10 +819,11 @@ static void RPi_ReadTraffic()
         const char *msg_class_s = msg_class.as<char*>();
 
         if (!strcmp(msg_class_s,"SOFTRF")) {
-          parseSettings(root);
-
-          RF_setup();
-          Traffic_setup();
+          RPi_Reconfigure(root);
+        } else if (!strcmp(msg_class_s,"STATS")) {
+          RPi_SendStats();
+        } else if (!strcmp(msg_class_s,"COVERAGE")) {
+          RPi_SendCoverage();
         }
       }
 
@@ -709,7 +879,7 @@ void normal_loop()
 
     bool success = RF_Receive();
 
-    if (success && isValidFix()) ParseData();
+    if (success) ParseData(isValidFix());
 
     if (isValidFix()) {
       Traffic_loop();
@@ -723,7 +893,40 @@ void normal_loop()
         D1090_Export();
         JSON_Export();
       }
-      ExportTimeMarker = millis();
+      ExportTimeMarker = Time_ms();
+    }
+
+    // Handle Air Connect
+    NMEA_loop();
+
+    SoC->Display_loop();
+
+    ClearExpired();
+}
+
+/* Normal mode with the radio and the exporters in threads of their own */
+void pipeline_loop()
+{
+    bool fix;
+
+    RPi_PickGNSSFix();
+
+    RPi_ReadTraffic();
+
+    ThisAircraft.timestamp = now();
+    fix = isValidFix();
+
+    Pipeline_transmit(&ThisAircraft, fix);
+
+    Pipeline_receive(fix);
+
+    if (fix) {
+      Traffic_loop();
+    }
+
+    if (isTimeToExport()) {
+      Pipeline_publish(fix);
+      ExportTimeMarker = Time_ms();
     }
 
     // Handle Air Connect
@@ -799,13 +1002,6 @@ unsigned long TxPosUpdMarker = 0;
 void txrx_test_loop()
 {
   bool success = false;
-#if DEBUG_TIMING
-  unsigned long baro_start_ms, baro_end_ms;
-  unsigned long tx_start_ms, tx_end_ms, rx_start_ms, rx_end_ms;
-  unsigned long parse_start_ms, parse_end_ms, led_start_ms, led_end_ms;
-  unsigned long export_start_ms, export_end_ms;
-  unsigned long oled_start_ms, oled_end_ms;
-#endif
 
   setTime(time(NULL));
 
@@ -827,73 +1023,22 @@ void txrx_test_loop()
   ThisAircraft.speed = TXRX_TEST_SPEED;
   ThisAircraft.vs = TXRX_TEST_VS;
 
-#if DEBUG_TIMING
-  tx_start_ms = millis();
-#endif
-
   RF_Transmit(RF_Encode(&ThisAircraft), true);
 
-#if DEBUG_TIMING
-  tx_end_ms = millis();
-  rx_start_ms = millis();
-#endif
   success = RF_Receive();
-#if DEBUG_TIMING
-  rx_end_ms = millis();
-#endif
 
-#if DEBUG_TIMING
-  parse_start_ms = millis();
-#endif
-  if (success) ParseData();
-#if DEBUG_TIMING
-  parse_end_ms = millis();
-#endif
+  if (success) ParseData(true);
 
   Traffic_loop();
 
-#if DEBUG_TIMING
-  export_start_ms = millis();
-#endif
   if (isTimeToExport()) {
     NMEA_Position();
     NMEA_Export();
     GDL90_Export();
     D1090_Export();
-    ExportTimeMarker = millis();
-  }
-#if DEBUG_TIMING
-  export_end_ms = millis();
-#endif
-
-#if DEBUG_TIMING
-  if (tx_end_ms - tx_start_ms) {
-    Serial.print(F("TX start: "));
-    Serial.print(tx_start_ms);
-    Serial.print(F(" TX stop: "));
-    Serial.println(tx_end_ms);
-  }
-  if (rx_end_ms - rx_start_ms) {
-    Serial.print(F("RX start: "));
-    Serial.print(rx_start_ms);
-    Serial.print(F(" RX stop: "));
-    Serial.println(rx_end_ms);
-  }
-  if (parse_end_ms - parse_start_ms) {
-    Serial.print(F("Parse start: "));
-    Serial.print(parse_start_ms);
-    Serial.print(F(" Parse stop: "));
-    Serial.println(parse_end_ms);
+    ExportTimeMarker = Time_ms();
   }
 
-  if (export_end_ms - export_start_ms) {
-    Serial.print(F("Export start: "));
-    Serial.print(export_start_ms);
-    Serial.print(F(" Export stop: "));
-    Serial.println(export_end_ms);
-  }
-#endif
-
   // Handle Air Connect
   NMEA_loop();
 
@@ -901,19 +1046,77 @@ void txrx_test_loop()
 }
 
 
+/* Sleep until there is something to read, to send or to time out */
+static void RPi_WaitForEvents()
+{
+  bool pipelined = Pipeline_active();
+  int timeout;
+
+  Event_watch(EVENT_STDIN,    RPi_StdIn.eof ? -1 : RPi_StdIn.fd, EPOLLIN);
+  Event_watch(EVENT_GPSD,     GPSD_fd(), GPSD_connecting() ? EPOLLOUT : EPOLLIN);
+  Event_watch(EVENT_TCPOUT,   pipelined ? -1 : TCPOut_fd(), EPOLLIN);
+  Event_watch(EVENT_PIPELINE, pipelined ? Pipeline_fd() : -1, EPOLLIN);
+
+  Event_timer(EVENT_TIMER_EXPORT,  ExportTimeMarker + 1000 + 1);
+  Event_timer(EVENT_TIMER_TRAFFIC, UpdateTrafficTimeMarker + TRAFFIC_UPDATE_INTERVAL_MS + 1);
+  /* the radio stage keeps its own TX timing */
+  Event_timer(EVENT_TIMER_TX,      pipelined ? 0 : RF_Transmit_deadline());
+
+  if (pipelined) {
+    timeout = RPI_IDLE_MS;
+  } else {
+    timeout = RPi_radio_irq ? RPI_RADIO_GUARD_MS : RPI_RADIO_POLL_MS;
+  }
+
+  Event_wait(timeout);
+}
+
 void * traffic_tcpserv_loop(void * m)
 {
   pthread_detach(pthread_self());
   Traffic_TCP_Server.receive();
 }
 
-int main()
+/* Value of a "--name value" pair of the command line, or NULL */
+static const char *RPi_option(int argc, char *argv[], const char *name)
 {
+  for (int i = 1; i + 1 < argc; i++) {
+    if (!strcmp(argv[i], name)) {
+      return argv[i + 1];
+    }
+  }
+
+  return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc > 1 && !strcmp(argv[1], "--bench")) {
+    return Bench_main(argc - 2, argv + 2);
+  }
+  if (argc > 1 && !strcmp(argv[1], "--replay")) {
+    return Replay_main(argc - 2, argv + 2);
+  }
+  if (argc > 1 && !strcmp(argv[1], "--pcap")) {
+    return Capture_pcap_main(argc - 2, argv + 2);
+  }
+
+#if defined(USE_VIRTUAL_RADIO)
+  /* no hardware to bring up - the radio is a multicast group */
+  const char *air = RPi_option(argc, argv, "--air");
+
+  if (!RF_virtual_configure(air ? air : VIRTUAL_AIR_GROUP)) {
+      fprintf( stderr, "Usage: %s [--air group[:port]] [--capture FILE]"
+                       " [--screen FILE [--view NAME]]\n\n", argv[0] );
+      exit(EXIT_FAILURE);
+  }
+#else
   // Init GPIO bcm
   if (!bcm2835_init()) {
       fprintf( stderr, "bcm2835_init() Failed\n\n" );
       exit(EXIT_FAILURE);
   }
+#endif /* USE_VIRTUAL_RADIO */
 
   Serial.begin(SERIAL_OUT_BR);
 
@@ -933,6 +1136,18 @@ int main()
       exit(EXIT_FAILURE);
   }
 
+#if defined(USE_EPAPER) && defined(USE_EPD_CANVAS)
+  RPi_screen = RPi_option(argc, argv, "--screen");
+
+  const char *view = RPi_option(argc, argv, "--view");
+
+  for (uint8_t i = 0; view && i < sizeof(RPi_views) / sizeof(RPi_views[0]); i++) {
+    if (!strcmp(view, RPi_views[i])) {
+      ui->vmode = i;
+    }
+  }
+#endif /* USE_EPD_CANVAS */
+
   Serial.print("Intializing E-ink display module (may take up to 10 seconds)... ");
   Serial.flush();
   hw_info.display = SoC->Display_setup();
@@ -951,9 +1166,23 @@ int main()
 //  hw_info.gnss = GNSS_setup();
 
   Traffic_setup();
+  Coverage_setup();
+  Capture_setup(RPi_option(argc, argv, "--capture"));
   NMEA_setup();
+  TCPOut_setup();
+
+  LineIn_init(&RPi_StdIn, "stdin", STDIN_FILENO);
+  GPSD_setup();
+  Time_pps_setup();
+
+  Event_setup();
+
+  if (!Pipeline_setup()) {
+    RPi_radio_irq = RPi_radio_irq_setup();
+  }
 
   Traffic_TCP_Server.setup(JSON_SRV_TCP_PORT);
+  Traffic_TCP_Server.notify(Event_notifier());
 
   pthread_t traffic_tcpserv_thread;
   if ( pthread_create(&traffic_tcpserv_thread, NULL, traffic_tcpserv_loop, (void *)0) != 0) {
@@ -966,6 +1195,8 @@ int main()
   SoC->WDT_setup();
 
   while (true) {
+    RPi_WaitForEvents();
+
     switch (settings->mode)
     {
     case SOFTRF_MODE_TXRX_TEST:
@@ -976,29 +1207,26 @@ int main()
       break;
     case SOFTRF_MODE_NORMAL:
     default:
-      normal_loop();
+      if (Pipeline_active()) {
+        pipeline_loop();
+      } else {
+        normal_loop();
+      }
       break;
     }
 
-    /* take care of millis() rollover on a long term run */
-    if (millis() > (47 * 24 * 3600 * 1000UL)) {
-      time_t current_time = time(NULL);
-      struct tm timebuf;
-
-      if (current_time == ((time_t)-1) ||
-          localtime_r(&current_time, &timebuf) == NULL) {
-        Traffic_TCP_Server.detach();
-        fprintf(stderr, "Failure to obtain the current time.\n");
-        exit(EXIT_FAILURE);
-      }
+    /* The views draw from a snapshot in every mode. The pipeline publishes its own */
+    if (!Pipeline_active()) {
+      Traffic_publish_loop();
+    }
 
-      /* shut SoftRF down at night time only */
-      if (timebuf.tm_hour >= 2 && timebuf.tm_hour <= 5) {
-        Traffic_TCP_Server.detach();
-        fprintf( stderr, "Program termination: millis() rollover prevention.\n" );
-        exit(EXIT_SUCCESS);
-      }
+    /* Send out whatever the exporters have produced on this pass */
+    if (!Pipeline_active()) {
+      TCPOut_loop();
+      UDPOut_loop();
     }
+
+    Coverage_loop();
   }
 
   Traffic_TCP_Server.detach();
@@ -1013,7 +1241,24 @@ void shutdown(int reason)
     SoC->Display_fini(reason);
   }
 
+  Pipeline_fini();
+  TCPOut_fini();
+  GPSD_fini();
+  Time_pps_fini();
   Traffic_TCP_Server.detach();
+  Event_fini();
+  Coverage_fini();
+  Capture_fini();
+
+  LineIn_stats_t *stats = &RPi_StdIn.stats;
+  fprintf( stderr, "%s: %u NMEA, %u JSON, %u other lines, %u bytes dropped\n",
+           RPi_StdIn.name, stats->lines[LINEIN_NMEA], stats->lines[LINEIN_JSON],
+           stats->lines[LINEIN_OTHER], stats->dropped );
+  fprintf( stderr, "loop: %u wakeups, %u idle timeouts\n",
+           Event_stats.wakeups, Event_stats.timeouts );
+  Pipeline_report();
+  Profile_report();
+
   fprintf( stderr, "Program termination. Reason code: %d.\n", reason );
   exit(EXIT_SUCCESS);
 }
@@ -104,6 +104,11 @@ extern TTYSerial Serial2;
 
 #define USE_NMEALIB
 #define USE_EPAPER
+#define USE_TCP_OUTPUT
+#define USE_TRAFFIC_SNAPSHOT
+
+/* Datagrams of an export cycle are sent with a single sendmmsg() */
+#define UDPOUT_DATAGRAMS      16
 
 //#define EXCLUDE_GNSS_UBLOX
 #define EXCLUDE_GNSS_SONY
@@ -163,11 +168,21 @@ typedef struct UI_Settings {
 
 typedef void* EPD_Task_t;
 
-extern GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> *display;
+#if defined(USE_EPD_CANVAS)
+#include "../driver/Canvas.h"
+
+typedef GxEPD2_BW<EPD_Canvas, EPD_Canvas::HEIGHT> EPD_display_t;
+#else
+typedef GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> EPD_display_t;
+#endif /* USE_EPD_CANVAS */
+
+extern EPD_display_t *display;
 #endif /* USE_EPAPER */
 
 extern ui_settings_t *ui;
 
+void RPi_defaults(void);
+
 #endif /* PLATFORM_RPI_H */
 
 #endif /* RASPBERRY_PI */
@@ -184,6 +184,7 @@ typedef struct stm32_backup_struct {
 #define EXCLUDE_WIFI
 #define EXCLUDE_CC13XX
 #define EXCLUDE_TEST_MODE
+#define EXCLUDE_COVERAGE
 
 #define EXCLUDE_GNSS_UBLOX
 //#define EXCLUDE_GNSS_SONY
@@ -201,8 +202,10 @@ typedef struct stm32_backup_struct {
 //#define USE_GNSS_PSM
 
 /* SoftRF/S7xG PFLAU NMEA sentence extension(s) */
-#define PFLAU_EXT1_FMT  ",%06X,%d,%d,%d"
-#define PFLAU_EXT1_ARGS ,ThisAircraft.addr,settings->rf_protocol,rx_packets_counter,tx_packets_counter
+#define PFLAU_EXT1(w)   { NMEA_field(w); NMEA_put_hex(w, ThisAircraft.addr, 6);  \
+                          NMEA_field(w); NMEA_put_int(w, settings->rf_protocol); \
+                          NMEA_field(w); NMEA_put_int(w, rx_packets_counter);    \
+                          NMEA_field(w); NMEA_put_int(w, tx_packets_counter); }
 
 /* Secondary target ("Blue pill") */
 #elif defined(ARDUINO_BLUEPILL_F103CB)
@@ -260,6 +263,7 @@ typedef struct stm32_backup_struct {
 #define EXCLUDE_WIFI
 #define EXCLUDE_CC13XX
 #define EXCLUDE_TEST_MODE
+#define EXCLUDE_COVERAGE
 
 //#define EXCLUDE_GNSS_UBLOX
 #define EXCLUDE_GNSS_SONY
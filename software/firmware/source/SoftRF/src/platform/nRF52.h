@@ -174,10 +174,14 @@ struct rst_info {
 
 //#define USE_OLED                 //  +    kb
 #define USE_EPAPER                 //  +    kb
+#define USE_TRAFFIC_SNAPSHOT       //  +  6 kb
 
 /* SoftRF/nRF52 PFLAU NMEA sentence extension(s) */
-#define PFLAU_EXT1_FMT  ",%06X,%d,%d,%d,%d"
-#define PFLAU_EXT1_ARGS ,ThisAircraft.addr,settings->rf_protocol,rx_packets_counter,tx_packets_counter,(int)(Battery_voltage()*100)
+#define PFLAU_EXT1(w)   { NMEA_field(w); NMEA_put_hex(w, ThisAircraft.addr, 6);              \
+                          NMEA_field(w); NMEA_put_int(w, settings->rf_protocol);             \
+                          NMEA_field(w); NMEA_put_int(w, rx_packets_counter);                \
+                          NMEA_field(w); NMEA_put_int(w, tx_packets_counter);                \
+                          NMEA_field(w); NMEA_put_int(w, (int) (Battery_voltage() * 100)); }
 
 #if !defined(EXCLUDE_LED_RING)
 #include <Adafruit_NeoPixel.h>
@@ -21,20 +21,34 @@
 
 #include "../../system/SoC.h"
 #include "D1090.h"
+#include "../../system/Profile.h"
 #include "../../driver/GNSS.h"
 #include "GDL90.h"
 #include "../../driver/EEPROM.h"
+#include "../../driver/TCPOut.h"
 #include "../../TrafficHelper.h"
 
-#define ADDR_TO_HEX_STR(s, c) (s += ((c) < 0x10 ? "0" : "") + String((c), HEX))
+static const char D1090_hex_digits[] = "0123456789ABCDEF";
 
-#define DF17_FRAME_TO_HEX_STR(s)                        \
-      ({                                                \
-        for (int i=0; i < sizeof(frame_data_t); i++) {  \
-          byte c = df17.msg[i];                         \
-          s += (c < 0x10 ? "0" : "") + String(c, HEX);  \
-        }                                               \
-      })
+/* One cache entry per slot of the traffic table */
+static D1090_cache_t D1090_Cache[MAX_TRACKING_OBJECTS];
+
+static byte D1090_Batch[D1090_BATCH_SIZE];
+static size_t D1090_Batch_size = 0;
+
+/* "*8D4840D6202CC371C32CE0576098;\r\n" */
+static void D1090_Frame_Text(char *buf, frame_data_t *df17)
+{
+  *buf++ = '*';
+  for (int i=0; i < sizeof(frame_data_t); i++) {
+    byte c = df17->msg[i];
+    *buf++ = D1090_hex_digits[c >> 4];
+    *buf++ = D1090_hex_digits[c & 0xF];
+  }
+  *buf++ = ';';
+  *buf++ = '\r';
+  *buf   = '\n';
+}
 
 static void D1090_Out(byte *buf, size_t size)
 {
@@ -61,88 +75,145 @@ static void D1090_Out(byte *buf, size_t size)
       }
     }
     break;
-  case D1090_UDP:
   case D1090_TCP:
+#if defined(USE_TCP_OUTPUT)
+    TCPOut_write(TCPOUT_D1090, buf, size);
+#endif /* USE_TCP_OUTPUT */
+    break;
+  case D1090_UDP:
   case D1090_OFF:
   default:
     break;
   }
 }
 
-void D1090_Export()
+static void D1090_Flush()
+{
+  if (D1090_Batch_size > 0) {
+    D1090_Out(D1090_Batch, D1090_Batch_size);
+    D1090_Batch_size = 0;
+  }
+}
+
+static void D1090_Write(const char *buf, size_t size)
+{
+  if (D1090_Batch_size + size > sizeof(D1090_Batch)) {
+    D1090_Flush();
+  }
+  memcpy(D1090_Batch + D1090_Batch_size, buf, size);
+  D1090_Batch_size += size;
+}
+
+/*
+ * Frames are made again only for the inputs that have changed
+ * since the previous export cycle.
+ */
+static void D1090_Update(D1090_cache_t *cache, ufo_t *fop, double altitude)
 {
   frame_data_t df17;
+  bool is_new = (cache->addr != fop->addr || cache->protocol != fop->protocol);
+
+  if (is_new ||
+      cache->latitude  != fop->latitude  ||
+      cache->longitude != fop->longitude ||
+      cache->altitude  != altitude) {
+
+    df17 = make_air_position_frame(11, fop->addr,
+      fop->latitude, fop->longitude, altitude, CPR_EVEN, DF17);
+    D1090_Frame_Text(&cache->text[D1090_FRAME_EVEN * D1090_FRAME_TEXT_SIZE], &df17);
+
+    df17 = make_air_position_frame(11, fop->addr,
+      fop->latitude, fop->longitude, altitude, CPR_ODD, DF17);
+    D1090_Frame_Text(&cache->text[D1090_FRAME_ODD * D1090_FRAME_TEXT_SIZE], &df17);
+
+    cache->latitude  = fop->latitude;
+    cache->longitude = fop->longitude;
+    cache->altitude  = altitude;
+  }
+
+  if (is_new || cache->aircraft_type != fop->aircraft_type) {
+    const char *prefix = GDL90_CallSign_Prefix[fop->protocol];
+    unsigned char callsign[8 + 1];
+    unsigned char *ptr = callsign;
+
+    memset(callsign, 0, sizeof(callsign));
+    while (*prefix) {
+      *ptr++ = *prefix++;
+    }
+    for (int8_t shift = 20; shift >= 0; shift -= 4) {
+      *ptr++ = D1090_hex_digits[(fop->addr >> shift) & 0xF];
+    }
+
+    df17 = make_aircraft_identification_frame(fop->addr, callsign,
+      Category_Set_D, AT_TO_GDL90(fop->aircraft_type), DF17);
+    D1090_Frame_Text(&cache->text[D1090_FRAME_IDENT * D1090_FRAME_TEXT_SIZE], &df17);
+
+    cache->aircraft_type = fop->aircraft_type;
+  }
+
+  if (is_new ||
+      cache->speed  != fop->speed  ||
+      cache->course != fop->course ||
+      cache->vs     != fop->vs) {
+
+    df17 = make_velocity_frame(fop->addr,
+      fop->speed * cos(fop->course * PI / 180),
+      fop->speed * sin(fop->course * PI / 180),
+      fop->vs, DF17);
+    D1090_Frame_Text(&cache->text[D1090_FRAME_VELOCITY * D1090_FRAME_TEXT_SIZE], &df17);
+
+    cache->speed  = fop->speed;
+    cache->course = fop->course;
+    cache->vs     = fop->vs;
+  }
+
+  cache->addr     = fop->addr;
+  cache->protocol = fop->protocol;
+}
+
+void D1090_Export()
+{
+  traffic_view_t view = Traffic_live();
+
+  D1090_Export_view(&view);
+}
+
+void D1090_Export_view(const traffic_view_t *view)
+{
   float distance;
-  String str;
   time_t this_moment = now();
 
   if (settings->d1090 != D1090_OFF) {
+    PROFILE(PROFILE_D1090);
+
     for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (Container[i].addr && (this_moment - Container[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
+      if (view->traffic[i].addr && (this_moment - view->traffic[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
 
-        distance = Container[i].distance;
+        distance = view->traffic[i].distance;
 
         if (distance < ALARM_ZONE_NONE) {
 
           double altitude;
           /* If the aircraft's data has standard pressure altitude - make use it */
-          if (Container[i].pressure_altitude != 0.0) {
-            altitude = (double) Container[i].pressure_altitude;
-          } else if (ThisAircraft.pressure_altitude != 0.0) {
+          if (view->traffic[i].pressure_altitude != 0.0) {
+            altitude = (double) view->traffic[i].pressure_altitude;
+          } else if (view->own->pressure_altitude != 0.0) {
             /* If this SoftRF unit is equiped with baro sensor - try to make an adjustment */
-            float altDiff = ThisAircraft.pressure_altitude - ThisAircraft.altitude;
-            altitude = (double)(Container[i].altitude + altDiff);
+            float altDiff = view->own->pressure_altitude - view->own->altitude;
+            altitude = (double)(view->traffic[i].altitude + altDiff);
           } else {
             /* If no other choice - report GNSS altitude as pressure altitude */
-            altitude = (double) Container[i].altitude;
+            altitude = (double) view->traffic[i].altitude;
           }
           altitude *= _GPS_FEET_PER_METER;
 
-          df17 = make_air_position_frame(11, Container[i].addr,
-            Container[i].latitude, Container[i].longitude,
-            altitude, CPR_EVEN, DF17);
-
-          str = "*";
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
-
-          df17 = make_air_position_frame(11, Container[i].addr,
-            Container[i].latitude, Container[i].longitude,
-            altitude, CPR_ODD, DF17);
-
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
-
-          String callsign = String(GDL90_CallSign_Prefix[Container[i].protocol]);
-        
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr >> 16) & 0xFF);
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr >>  8) & 0xFF);
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr      ) & 0xFF);
+          D1090_Update(&D1090_Cache[i], &view->traffic[i], altitude);
 
-          callsign.toUpperCase();
-
-          df17 = make_aircraft_identification_frame(Container[i].addr,
-            (unsigned char*) callsign.c_str(),
-            Category_Set_D,
-            AT_TO_GDL90(Container[i].aircraft_type),
-            DF17);
-
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
-
-          df17 = make_velocity_frame(Container[i].addr,
-            Container[i].speed * cos(Container[i].course * PI / 180),
-            Container[i].speed * sin(Container[i].course * PI / 180),
-            Container[i].vs,
-            DF17);
-
-          DF17_FRAME_TO_HEX_STR(str);
-          str.toUpperCase();
-          str += ";\r\n";
-
-          D1090_Out((byte *) str.c_str(), str.length());
+          D1090_Write(D1090_Cache[i].text, sizeof(D1090_Cache[i].text));
         }
       }
     }
+
+    D1090_Flush();
   }
 }
@@ -29,6 +29,37 @@ enum
 	D1090_BLUETOOTH
 };
 
+/* "*" + 14 bytes in hex + ";\r\n" */
+#define D1090_FRAME_TEXT_SIZE   (1 + 2 * 14 + 3)
+
+enum
+{
+	D1090_FRAME_EVEN,
+	D1090_FRAME_ODD,
+	D1090_FRAME_IDENT,
+	D1090_FRAME_VELOCITY,
+	D1090_FRAMES
+};
+
+/* Frames of one target, formatted and ready to go */
+typedef struct D1090_cache_struct {
+  uint32_t  addr;
+  uint8_t   protocol;
+  uint8_t   aircraft_type;
+  float     latitude;
+  float     longitude;
+  double    altitude;       /* feet */
+  float     speed;
+  float     course;
+  float     vs;
+  char      text[D1090_FRAMES * D1090_FRAME_TEXT_SIZE];
+} D1090_cache_t;
+
+#if !defined(D1090_BATCH_SIZE)
+#define D1090_BATCH_SIZE        (4 * sizeof(((D1090_cache_t *) 0)->text))
+#endif
+
 void D1090_Export(void);
+void D1090_Export_view(const traffic_view_t *);
 
 #endif /* D1090HELPER_H */
\ No newline at end of file
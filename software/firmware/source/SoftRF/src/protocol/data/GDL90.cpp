@@ -28,7 +28,10 @@
 #include "../../driver/GNSS.h"
 #include "../../driver/EEPROM.h"
 #include "../../driver/WiFi.h"
+#include "../../driver/TCPOut.h"
+#include "../../driver/UDPOut.h"
 #include "../../TrafficHelper.h"
+#include "../../system/Profile.h"
 #include "../radio/Legacy.h"
 #include "NMEA.h"
 
@@ -183,12 +186,12 @@ uint8_t *GDL90_EscapeFilter(uint8_t *buf, uint8_t *p, int size)
   return (buf);
 }
 
-static void *msgHeartbeat()
+static void *msgHeartbeat(bool fix)
 {
   time_t ts = elapsedSecsToday(now());
 
   /* Status Byte 1 */
-  HeartBeat.gnss_pos_valid  = isValidFix() ;
+  HeartBeat.gnss_pos_valid  = fix ;
   HeartBeat.maint_reqd      = 0;
   HeartBeat.ident           = 0;
   HeartBeat.addr_type       = 0;
@@ -213,7 +216,7 @@ static void *msgHeartbeat()
   return (&HeartBeat);
 }
 
-static void *msgType10and20(ufo_t *aircraft)
+static void *msgType10and20(ufo_t *aircraft, ufo_t *own)
 {
   int altitude;
 
@@ -229,9 +232,9 @@ static void *msgType10and20(ufo_t *aircraft)
   /* If the aircraft's data has standard pressure altitude - make use it */
   if (aircraft->pressure_altitude != 0.0) {
     altitude = (int)(aircraft->pressure_altitude * _GPS_FEET_PER_METER);
-  } else if (ThisAircraft.pressure_altitude != 0.0) {
+  } else if (own->pressure_altitude != 0.0) {
     /* If this SoftRF unit is equiped with baro sensor - try to make an adjustment */
-    float altDiff = ThisAircraft.pressure_altitude - ThisAircraft.altitude;
+    float altDiff = own->pressure_altitude - own->altitude;
     altitude = (int)((aircraft->altitude + altDiff) * _GPS_FEET_PER_METER);
   } else {
     /* If there are no any choice - report GNSS AMSL altitude as pressure altitude */
@@ -337,10 +340,10 @@ static void *msgOwnershipGeometricAltitude(ufo_t *aircraft)
   return (&GeometricAltitude);
 }
 
-static size_t makeHeartbeat(uint8_t *buf)
+static size_t makeHeartbeat(uint8_t *buf, bool fix)
 {
   uint8_t *ptr = buf;
-  uint8_t *msg = (uint8_t *) msgHeartbeat();
+  uint8_t *msg = (uint8_t *) msgHeartbeat(fix);
   uint16_t fcs = GDL90_calcFCS(GDL90_HEARTBEAT_MSG_ID, msg,
                                sizeof(GDL90_Msg_HeartBeat_t));
   uint8_t fcs_lsb, fcs_msb;
@@ -358,10 +361,10 @@ static size_t makeHeartbeat(uint8_t *buf)
   return(ptr-buf);
 }
 
-static size_t makeType10and20(uint8_t *buf, uint8_t id, ufo_t *aircraft)
+static size_t makeType10and20(uint8_t *buf, uint8_t id, ufo_t *aircraft, ufo_t *own)
 {
   uint8_t *ptr = buf;
-  uint8_t *msg = (uint8_t *) msgType10and20(aircraft);
+  uint8_t *msg = (uint8_t *) msgType10and20(aircraft, own);
   uint16_t fcs = GDL90_calcFCS(id, msg, sizeof(GDL90_Msg_Traffic_t));
   uint8_t fcs_lsb, fcs_msb;
   
@@ -422,8 +425,8 @@ static size_t makeFFid(uint8_t *buf)
 }
 #endif
 
-#define makeOwnershipReport(b,a)  makeType10and20(b, GDL90_OWNSHIP_MSG_ID, a)
-#define makeTrafficReport(b,a)    makeType10and20(b, GDL90_TRAFFIC_MSG_ID, a)
+#define makeOwnershipReport(b,a)    makeType10and20(b, GDL90_OWNSHIP_MSG_ID, a, a)
+#define makeTrafficReport(b,a,o)    makeType10and20(b, GDL90_TRAFFIC_MSG_ID, a, o)
 
 static void GDL90_Out(byte *buf, size_t size)
 {
@@ -439,7 +442,8 @@ static void GDL90_Out(byte *buf, size_t size)
       break;
     case GDL90_UDP:
       {
-        SoC->WiFi_transmit_UDP(GDL90_DST_PORT, buf, size);
+        /* frames of one export cycle share a datagram */
+        UDPOut_write(UDPOUT_GDL90, buf, size, false);
       }
       break;
     case GDL90_USB:
@@ -457,6 +461,10 @@ static void GDL90_Out(byte *buf, size_t size)
       }
       break;
     case GDL90_TCP:
+#if defined(USE_TCP_OUTPUT)
+      TCPOut_write(TCPOUT_GDL90, buf, size);
+#endif /* USE_TCP_OUTPUT */
+      break;
     case GDL90_OFF:
     default:
       break;
@@ -465,6 +473,13 @@ static void GDL90_Out(byte *buf, size_t size)
 }
 
 void GDL90_Export()
+{
+  traffic_view_t view = Traffic_live();
+
+  GDL90_Export_view(&view);
+}
+
+void GDL90_Export_view(const traffic_view_t *view)
 {
   size_t size;
   float distance;
@@ -473,7 +488,9 @@ void GDL90_Export()
                               NMEABuffer : UDPpacketBuffer);
 
   if (settings->gdl90 != GDL90_OFF) {
-    size = makeHeartbeat(buf);
+    PROFILE(PROFILE_GDL90);
+
+    size = makeHeartbeat(buf, view->fix);
     GDL90_Out(buf, size);
 
 #if defined(DO_GDL90_FF_EXT)
@@ -486,21 +503,21 @@ void GDL90_Export()
     GDL90_Out(buf, size);
 #endif /* ENABLE_AHRS */
 
-    if (isValidFix()) {
-      size = makeOwnershipReport(buf, &ThisAircraft);
+    if (view->fix) {
+      size = makeOwnershipReport(buf, view->own);
       GDL90_Out(buf, size);
 
-      size = makeGeometricAltitude(buf, &ThisAircraft);
+      size = makeGeometricAltitude(buf, view->own);
       GDL90_Out(buf, size);
 
       for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (Container[i].addr &&
-           (this_moment - Container[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
+        if (view->traffic[i].addr &&
+           (this_moment - view->traffic[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
 
-          distance = Container[i].distance;
+          distance = view->traffic[i].distance;
 
           if (distance < ALARM_ZONE_NONE) {
-            size = makeTrafficReport(buf, &Container[i]);
+            size = makeTrafficReport(buf, &view->traffic[i], view->own);
             GDL90_Out(buf, size);
           }
         }
@@ -27,6 +27,10 @@
 #include "../../driver/LED.h"
 #include "../../driver/Sound.h"
 #include "../../driver/Baro.h"
+#include "../../driver/UDPOut.h"
+#include "../../driver/GPSD.h"
+#include "../../system/Time.h"
+#include "../../system/Profile.h"
 #include "../../TrafficHelper.h"
 #include "NMEA.h"
 #include "GDL90.h"
@@ -54,60 +58,188 @@ byte getVal(char c)
      return (byte)(toupper(c)-'A'+10);
 }
 
+static const char JSON_hex_digits[] = "0123456789ABCDEF";
+
+static const uint32_t JSON_pow10[] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static JsonWriter_t JSON_Writer;
+
+static void JSON_flush(JsonWriter_t *w)
+{
+  if (w->len > 0) {
+    w->sink(w->buf, w->len);
+    w->len = 0;
+  }
+}
+
+/* make sure that 'size' more bytes fit into the chunk */
+static void JSON_reserve(JsonWriter_t *w, size_t size)
+{
+  if (w->len + size > sizeof(w->buf)) {
+    JSON_flush(w);
+  }
+}
+
+static void JSON_put(JsonWriter_t *w, const char *s, size_t size)
+{
+  JSON_reserve(w, size);
+  memcpy(w->buf + w->len, s, size);
+  w->len += size;
+}
+
+#define JSON_put_literal(w, s)  JSON_put((w), (s), sizeof(s) - 1)
+
+static void JSON_put_uint(JsonWriter_t *w, uint32_t value, uint8_t width)
+{
+  char digits[10];
+  uint8_t n = 0;
+
+  do {
+    digits[n++] = '0' + (value % 10);
+    value /= 10;
+  } while (value && n < sizeof(digits));
+
+  JSON_reserve(w, (width > n ? width : n) + 1);
+  while (width > n) {
+    w->buf[w->len++] = '0';
+    width--;
+  }
+  while (n > 0) {
+    w->buf[w->len++] = digits[--n];
+  }
+}
+
+static void JSON_put_int(JsonWriter_t *w, int32_t value)
+{
+  if (value < 0) {
+    JSON_put_literal(w, "-");
+    JSON_put_uint(w, (uint32_t) -(int64_t) value, 0);
+  } else {
+    JSON_put_uint(w, (uint32_t) value, 0);
+  }
+}
+
+/* 'value' is scaled by 10^decimals */
+static void JSON_put_fixed(JsonWriter_t *w, int32_t value, uint8_t decimals)
+{
+  uint32_t abs_value = value < 0 ? (uint32_t) -(int64_t) value : (uint32_t) value;
+
+  if (value < 0) {
+    JSON_put_literal(w, "-");
+  }
+  JSON_put_uint(w, abs_value / JSON_pow10[decimals], 0);
+  if (decimals > 0) {
+    JSON_put_literal(w, ".");
+    JSON_put_uint(w, abs_value % JSON_pow10[decimals], decimals);
+  }
+}
+
+static void JSON_put_hex(JsonWriter_t *w, uint32_t value, uint8_t digits)
+{
+  JSON_reserve(w, digits);
+  while (digits-- > 0) {
+    w->buf[w->len++] = JSON_hex_digits[(value >> (digits * 4)) & 0xF];
+  }
+}
+
+static void JSON_Serial_sink(const char *buf, size_t size)
+{
+  Serial.write((unsigned char *) buf, size);
+}
+
 void JSON_Export()
+{
+  traffic_view_t view = Traffic_live();
+
+  JSON_Export_view(&view);
+}
+
+void JSON_Export_view(const traffic_view_t *view)
 {
   if (settings->json != JSON_PING) {
     return;
   }
 
+  PROFILE(PROFILE_JSON);
+
+  JSON_Export_to(JSON_Serial_sink, view);
+}
+
+/*
+ * PingStation traffic report, written out field by field:
+ * {"aircraft":[{"icaoAddress":"XXXXXX",...},...]}
+ */
+void JSON_Export_to(json_sink_t sink, const traffic_view_t *view)
+{
   float distance;
   time_t this_moment = now();
-  char buffer[3 * 80 * MAX_TRACKING_OBJECTS];
   bool has_aircraft = false;
+  JsonWriter_t *w = &JSON_Writer;
+
+  /* Time packet was received at the pingStation ISO 8601 format: YYYY-MM-DDTHH:mm:ss:ffffffffZ */
+  char timebuf[32];
+  size_t timebuf_len;
+  time_t timestamp = now(); /* GNSS date&time */
 
-  JsonObject& root = jsonBuffer.createObject();
-  JsonArray& aircraft_array = root.createNestedArray("aircraft");
+  timebuf_len = strftime(timebuf, sizeof(timebuf), "%FT%T:00000000Z", gmtime(&timestamp));
+
+  long squawk = (settings->band == RF_BAND_US ? 1200 : 7000); // VFR Squawk code
+
+  w->len  = 0;
+  w->sink = sink;
 
   for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-    if (Container[i].addr && (this_moment - Container[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
+    if (view->traffic[i].addr && (this_moment - view->traffic[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
 
-      distance = Container[i].distance;
+      distance = view->traffic[i].distance;
 
       if (distance < ALARM_ZONE_NONE) {
 
-        char hexbuf[8];
-        char callsign[8+1];
-        char timebuf[32];
-        time_t timestamp = now(); /* GNSS date&time */
+        ufo_t *fop = &view->traffic[i];
+        const char *prefix = GDL90_CallSign_Prefix[fop->protocol];
 
-        snprintf(hexbuf, sizeof(hexbuf), "%06X", Container[i].addr);
+        /* an aircraft object is never split between two chunks */
+        JSON_reserve(w, JSON_AIRCRAFT_MAX);
 
-        JsonObject& aircraft = aircraft_array.createNestedObject();
+        if (has_aircraft) {
+          JSON_put_literal(w, ",");
+        } else {
+          JSON_put_literal(w, "{\"aircraft\":[");
+        }
 
-        aircraft["icaoAddress"] = hexbuf; // ICAO of the aircraft
-        aircraft["trafficSource"] = 2; // 0 = 1090ES , 1 = UAT
-        aircraft["latDD"] = Container[i].latitude;  // Latitude expressed as decimal degrees
-        aircraft["lonDD"] = Container[i].longitude; // Longitude expressed as decimal degrees
+        JSON_put_literal(w, "{\"icaoAddress\":\""); // ICAO of the aircraft
+        JSON_put_hex(w, fop->addr, 6);
+        JSON_put_literal(w, "\",\"trafficSource\":2"); // 0 = 1090ES , 1 = UAT
+        JSON_put_literal(w, ",\"latDD\":");   // Latitude expressed as decimal degrees
+        JSON_put_fixed(w, (int32_t) lround(fop->latitude * 1e6), 6);
+        JSON_put_literal(w, ",\"lonDD\":");   // Longitude expressed as decimal degrees
+        JSON_put_fixed(w, (int32_t) lround(fop->longitude * 1e6), 6);
         /* Geometric altitude or barometric pressure altitude in millimeters */
-        aircraft["altitudeMM"] = (long) (Container[i].altitude * 1000);
+        JSON_put_literal(w, ",\"altitudeMM\":");
+        JSON_put_int(w, (long) (fop->altitude * 1000));
         /* Course over ground in centi-degrees */
-        aircraft["headingDE2"] = (int) (Container[i].course * 100);
+        JSON_put_literal(w, ",\"headingDE2\":");
+        JSON_put_int(w, (int) (fop->course * 100));
         /* Horizontal velocity in centimeters/sec */
-        aircraft["horVelocityCMS"] = (unsigned long) (Container[i].speed * _GPS_MPS_PER_KNOT * 100);
+        JSON_put_literal(w, ",\"horVelocityCMS\":");
+        JSON_put_uint(w, (unsigned long) (fop->speed * _GPS_MPS_PER_KNOT * 100), 0);
         /* Vertical velocity in centimeters/sec with positive being up */
-        aircraft["verVelocityCMS"] = (long) (Container[i].vs * 100 / (_GPS_FEET_PER_METER * 60.0));
-        aircraft["squawk"] = (settings->band == RF_BAND_US ? 1200 : 7000); // VFR Squawk code
-        aircraft["altitudeType"] = 1; // Altitude Source: 0 = Pressure 1 = Geometric
-        memcpy(callsign, GDL90_CallSign_Prefix[Container[i].protocol],
-          strlen(GDL90_CallSign_Prefix[Container[i].protocol]));
-        memcpy(callsign + strlen(GDL90_CallSign_Prefix[Container[i].protocol]),
-          hexbuf, strlen(hexbuf) + 1);
-        aircraft["Callsign"] = callsign; // Callsign
-        aircraft["emitterType"] = AT_TO_GDL90(Container[i].aircraft_type); // Category type of the emitter
-        aircraft["utcSync"] = 1; // UTC time flag
-        /* Time packet was received at the pingStation ISO 8601 format: YYYY-MM-DDTHH:mm:ss:ffffffffZ */
-        strftime(timebuf, sizeof(timebuf), "%FT%T:00000000Z", gmtime(&timestamp));
-        aircraft["timeStamp"] = timebuf;
+        JSON_put_literal(w, ",\"verVelocityCMS\":");
+        JSON_put_int(w, (long) (fop->vs * 100 / (_GPS_FEET_PER_METER * 60.0)));
+        JSON_put_literal(w, ",\"squawk\":");
+        JSON_put_int(w, squawk);
+        JSON_put_literal(w, ",\"altitudeType\":1"); // Altitude Source: 0 = Pressure 1 = Geometric
+        JSON_put_literal(w, ",\"Callsign\":\"");
+        JSON_put(w, prefix, strlen(prefix));
+        JSON_put_hex(w, fop->addr, 6);
+        JSON_put_literal(w, "\",\"emitterType\":"); // Category type of the emitter
+        JSON_put_int(w, AT_TO_GDL90(fop->aircraft_type));
+        JSON_put_literal(w, ",\"utcSync\":1"); // UTC time flag
+        JSON_put_literal(w, ",\"timeStamp\":\"");
+        JSON_put(w, timebuf, timebuf_len);
+        JSON_put_literal(w, "\"}");
 
         has_aircraft = true;
       }
@@ -115,11 +247,9 @@ void JSON_Export()
   }
 
   if (has_aircraft) {
-    root.printTo(buffer);
-    Serial.println(buffer);
+    JSON_put_literal(w, "]}\n");
+    JSON_flush(w);
   }
-
-  jsonBuffer.clear();
 }
 
 void parsePING(JsonObject& root)
@@ -490,6 +620,38 @@ void parseSettings(JsonObject& root)
       eeprom_block.field.settings.nmea_out = NMEA_UART;
     } else if (!strcmp(nmea_out_s,"UDP")) {
       eeprom_block.field.settings.nmea_out = NMEA_UDP;
+    } else if (!strcmp(nmea_out_s,"TCP")) {
+      eeprom_block.field.settings.nmea_out = NMEA_TCP;
+    }
+  }
+
+  JsonVariant udp = root["udp"];
+  if (udp.success()) {
+    /* the new list replaces whatever was set before */
+    UDPOut_clear_destinations();
+    if (udp.is<JsonArray&>()) {
+      JsonArray& udp_a = udp.as<JsonArray&>();
+      for (size_t i=0; i < udp_a.size(); i++) {
+        UDPOut_add_destination(udp_a[i].as<char*>());
+      }
+    } else {
+      UDPOut_add_destination(udp.as<char*>());
+    }
+  }
+
+  JsonVariant gpsd = root["gpsd"];
+  if (gpsd.success()) {
+    const char * gpsd_s = gpsd.as<char*>();
+    if (gpsd_s) {
+      GPSD_configure(gpsd_s);
+    }
+  }
+
+  JsonVariant pps = root["pps"];
+  if (pps.success()) {
+    const char * pps_s = pps.as<char*>();
+    if (pps_s) {
+      Time_pps_configure(pps_s);
     }
   }
 
@@ -502,6 +664,8 @@ void parseSettings(JsonObject& root)
       eeprom_block.field.settings.gdl90 = GDL90_UART;
     } else if (!strcmp(gdl90_s,"UDP")) {
       eeprom_block.field.settings.gdl90 = GDL90_UDP;
+    } else if (!strcmp(gdl90_s,"TCP")) {
+      eeprom_block.field.settings.gdl90 = GDL90_TCP;
     }
   }
 
@@ -512,6 +676,8 @@ void parseSettings(JsonObject& root)
       eeprom_block.field.settings.d1090 = D1090_OFF;
     } else if (!strcmp(d1090_s,"UART")) {
       eeprom_block.field.settings.d1090 = D1090_UART;
+    } else if (!strcmp(d1090_s,"TCP")) {
+      eeprom_block.field.settings.d1090 = D1090_TCP;
     }
   }
 
@@ -30,6 +30,8 @@
 #endif /* RASPBERRY_PI */
 
 #define JSON_BUFFER_SIZE  65536
+#define JSON_CHUNK_SIZE   1024
+#define JSON_AIRCRAFT_MAX 384   /* longest PingStation aircraft object */
 #define isValidGPSDFix() (hasValidGPSDFix)
 
 enum
@@ -75,10 +77,21 @@ struct ping_aircraft_struct {
 typedef  struct dump1090_aircraft_struct dump1090_aircraft_t;
 typedef  struct ping_aircraft_struct ping_aircraft_t;
 
+typedef void (*json_sink_t)(const char *, size_t);
+
+/* Output is accumulated in chunks and handed to the sink chunk by chunk */
+typedef struct JsonWriter_struct {
+  char        buf[JSON_CHUNK_SIZE];
+  size_t      len;
+  json_sink_t sink;
+} JsonWriter_t;
+
 extern StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
 extern bool hasValidGPSDFix;
 
 extern void JSON_Export();
+extern void JSON_Export_view(const traffic_view_t *);
+extern void JSON_Export_to(json_sink_t, const traffic_view_t *);
 extern void parseTPV(JsonObject&);
 extern void parseSettings(JsonObject&);
 extern void parseD1090(JsonObject&);
@@ -25,9 +25,11 @@
 #include "../../driver/WiFi.h"
 #include "../../driver/EEPROM.h"
 #include "../../driver/Battery.h"
+#include "../../driver/TCPOut.h"
+#include "../../driver/UDPOut.h"
 #include "../../TrafficHelper.h"
-
-#define ADDR_TO_HEX_STR(s, c) (s += ((c) < 0x10 ? "0" : "") + String((c), HEX))
+#include "../../system/Pipeline.h"
+#include "../../system/Profile.h"
 
 #define PGRMZ_INTERVAL 200
 
@@ -38,13 +40,22 @@ NmeaTCP_t NmeaTCP[MAX_NMEATCP_CLIENTS];
 
 char NMEABuffer[NMEA_BUFFER_SIZE]; //buffer for NMEA data
 
-static char NMEA_Callsign[NMEA_CALLSIGN_SIZE];
+static char NMEA_Batch[NMEA_BATCH_SIZE];
+
+/* Callsign substitutes, direct mapped by address */
+typedef struct NmeaCallsign_struct {
+  uint32_t  addr;
+  uint8_t   protocol;
+  char      callsign[NMEA_CALLSIGN_SIZE];
+} NmeaCallsign_t;
 
-#if defined(USE_NMEALIB)
-#include <nmealib.h>
+static NmeaCallsign_t NMEA_Callsign_Cache[NMEA_CALLSIGN_CACHE];
 
-NmeaMallocedBuffer nmealib_buf;
-#endif /* USE_NMEALIB */
+static const char NMEA_hex_digits[] = "0123456789ABCDEF";
+
+static const uint32_t NMEA_pow10[] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
 
 const char *NMEA_CallSign_Prefix[] = {
   [RF_PROTOCOL_LEGACY]    = "FLR",
@@ -67,16 +78,6 @@ extern uint32_t tx_packets_counter, rx_packets_counter;
 unsigned long RPYL_TimeMarker = 0;
 #endif /* ENABLE_AHRS */
 
-static char *ltrim(char *s)
-{
-  if(s) {
-    while(*s && isspace(*s))
-      ++s;
-  }
-
-  return s;
-}
-
 void NMEA_add_checksum(char *buf, size_t limit)
 {
   size_t sentence_size = strlen(buf);
@@ -91,6 +92,213 @@ void NMEA_add_checksum(char *buf, size_t limit)
   snprintf_P(csum_ptr, limit, PSTR("%02X\r\n"), cs);
 }
 
+void NMEA_writer_init(NmeaWriter_t *w, char *buf, size_t size, uint8_t dest)
+{
+  w->buf      = buf;
+  w->size     = size;
+  w->len      = 0;
+  w->mark     = 0;
+  w->cs       = 0;
+  w->overflow = false;
+  w->dest     = dest;
+}
+
+/* Starts a new sentence. Talker and type go without the leading '$' */
+void NMEA_begin(NmeaWriter_t *w, const char *type)
+{
+  /* make sure that a sentence of any kind fits */
+  if (w->len > 0 && w->size - w->len < NMEA_BUFFER_SIZE) {
+    NMEA_flush(w);
+  }
+
+  w->mark     = w->len;
+  w->overflow = false;
+
+  if (w->len < w->size) {
+    w->buf[w->len++] = '$';
+  }
+  w->cs = 0;
+
+  NMEA_put_str(w, type);
+}
+
+void NMEA_put_char(NmeaWriter_t *w, char c)
+{
+  /* leave room for the "*XX\r\n" trailer */
+  if (w->len + 5 >= w->size) {
+    w->overflow = true;
+    return;
+  }
+
+  w->buf[w->len++] = c;
+  w->cs ^= (uint8_t) c;
+}
+
+void NMEA_put_str(NmeaWriter_t *w, const char *s)
+{
+  while (*s) {
+    NMEA_put_char(w, *s++);
+  }
+}
+
+void NMEA_put_strn(NmeaWriter_t *w, const char *s, size_t n)
+{
+  while (n-- > 0 && *s) {
+    NMEA_put_char(w, *s++);
+  }
+}
+
+/* Decimal, zero padded up to 'width' digits */
+void NMEA_put_uint(NmeaWriter_t *w, uint32_t value, uint8_t width)
+{
+  char digits[10];
+  uint8_t n = 0;
+
+  do {
+    digits[n++] = '0' + (value % 10);
+    value /= 10;
+  } while (value && n < sizeof(digits));
+
+  while (width > n) {
+    NMEA_put_char(w, '0');
+    width--;
+  }
+  while (n > 0) {
+    NMEA_put_char(w, digits[--n]);
+  }
+}
+
+void NMEA_put_int(NmeaWriter_t *w, int32_t value)
+{
+  if (value < 0) {
+    NMEA_put_char(w, '-');
+    NMEA_put_uint(w, (uint32_t) -(int64_t) value, 0);
+  } else {
+    NMEA_put_uint(w, (uint32_t) value, 0);
+  }
+}
+
+/* Upper case hex, exactly 'digits' wide */
+void NMEA_put_hex(NmeaWriter_t *w, uint32_t value, uint8_t digits)
+{
+  while (digits-- > 0) {
+    NMEA_put_char(w, NMEA_hex_digits[(value >> (digits * 4)) & 0xF]);
+  }
+}
+
+/* 'value' is scaled by 10^decimals, i.e. 123 with 1 decimal is "12.3" */
+void NMEA_put_fixed(NmeaWriter_t *w, int32_t value, uint8_t decimals)
+{
+  uint32_t abs_value;
+
+  if (decimals > 9) {
+    decimals = 9;
+  }
+
+  if (value < 0) {
+    NMEA_put_char(w, '-');
+    abs_value = (uint32_t) -(int64_t) value;
+  } else {
+    abs_value = (uint32_t) value;
+  }
+
+  NMEA_put_uint(w, abs_value / NMEA_pow10[decimals], 0);
+  if (decimals > 0) {
+    NMEA_put_char(w, '.');
+    NMEA_put_uint(w, abs_value % NMEA_pow10[decimals], decimals);
+  }
+}
+
+/* Completes the sentence with "*XX\r\n" or drops it if it did not fit */
+void NMEA_end(NmeaWriter_t *w)
+{
+  if (w->overflow || w->len + 5 > w->size) {
+    w->len = w->mark;
+    return;
+  }
+
+  uint8_t cs = w->cs;
+
+  w->buf[w->len++] = '*';
+  w->buf[w->len++] = NMEA_hex_digits[cs >> 4];
+  w->buf[w->len++] = NMEA_hex_digits[cs & 0xF];
+  w->buf[w->len++] = '\r';
+  w->buf[w->len++] = '\n';
+
+  w->mark = w->len;
+}
+
+void NMEA_flush(NmeaWriter_t *w)
+{
+  if (w->mark > 0) {
+    NMEA_Out(w->dest, (byte *) w->buf, w->mark, false);
+  }
+  w->len  = 0;
+  w->mark = 0;
+}
+
+/* Degrees into [d]ddmm.mmmm,H */
+static void NMEA_put_coord(NmeaWriter_t *w, double degrees, uint8_t width,
+                           char pos, char neg)
+{
+  /* 1/10000 of a minute, up to 1.08e8 - more than a float mantissa holds */
+  uint32_t total = (uint32_t) llround(fabs(degrees) * 600000.0);
+
+  NMEA_field(w);
+  NMEA_put_uint(w, total / 600000, width);
+  NMEA_put_uint(w, (total % 600000) / 10000, 2);
+  NMEA_put_char(w, '.');
+  NMEA_put_uint(w, total % 10000, 4);
+  NMEA_field(w);
+  NMEA_put_char(w, degrees < 0 ? neg : pos);
+}
+
+static void NMEA_put_time(NmeaWriter_t *w, int hh, int mm, int ss, int cs)
+{
+  NMEA_field(w);
+  NMEA_put_uint(w, hh, 2);
+  NMEA_put_uint(w, mm, 2);
+  NMEA_put_uint(w, ss, 2);
+  NMEA_put_char(w, '.');
+  NMEA_put_uint(w, cs, 2);
+}
+
+/*
+ * When callsign is available - send it to a NMEA client.
+ * If it is not - use a callsign substitute,
+ * based upon a protocol ID and the ICAO address
+ */
+static void NMEA_put_callsign(NmeaWriter_t *w, ufo_t *fop)
+{
+  if (fop->callsign[0]) {
+    NMEA_put_strn(w, (char *) fop->callsign, sizeof(fop->callsign));
+    return;
+  }
+
+  uint32_t addr = fop->addr;
+  NmeaCallsign_t *entry =
+    &NMEA_Callsign_Cache[(addr ^ (addr >> 12) ^ fop->protocol) % NMEA_CALLSIGN_CACHE];
+
+  if (entry->addr != addr || entry->protocol != fop->protocol) {
+    const char *prefix = NMEA_CallSign_Prefix[fop->protocol];
+    char *ptr = entry->callsign;
+
+    while (*prefix) {
+      *ptr++ = *prefix++;
+    }
+    *ptr++ = '_';
+    for (int8_t shift = 20; shift >= 0; shift -= 4) {
+      *ptr++ = NMEA_hex_digits[(addr >> shift) & 0xF];
+    }
+    *ptr = 0;
+
+    entry->addr     = addr;
+    entry->protocol = fop->protocol;
+  }
+
+  NMEA_put_str(w, entry->callsign);
+}
+
 void NMEA_setup()
 {
 #if defined(NMEA_TCP_SERVICE)
@@ -103,9 +311,7 @@ void NMEA_setup()
   }
 #endif /* NMEA_TCP_SERVICE */
 
-#if defined(USE_NMEALIB)
-  memset(&nmealib_buf, 0, sizeof(nmealib_buf));
-#endif /* USE_NMEALIB */
+  memset(NMEA_Callsign_Cache, 0, sizeof(NMEA_Callsign_Cache));
 
   PGRMZ_TimeMarker = millis();
 
@@ -131,16 +337,20 @@ void NMEA_loop()
     //         (int) (ThisAircraft.vs * 0.009875 * 10.0 + 200), //to knots*10+200
     //         0, 400);
 
-    snprintf_P(NMEABuffer, sizeof(NMEABuffer), PSTR("$PGRMZ,%.2f,f,3*"),
-            altitude ); /* feet , 3D fix */
+    NmeaWriter_t w;
 
+    NMEA_writer_init(&w, NMEABuffer, sizeof(NMEABuffer), settings->nmea_out);
+
+    NMEA_begin(&w, "PGRMZ");
+    NMEA_field(&w);
+    NMEA_put_fixed(&w, (int32_t) lroundf(altitude * 100), 2);
+    NMEA_put_str(&w, ",f,3");  /* feet , 3D fix */
+    NMEA_end(&w);
 
     // snprintf_P(NMEABuffer, sizeof(NMEABuffer), PSTR("$PTAS1,%d,%d,%d,xxx*"),
     //         vario, vario, altitudePTAS1 ); /* feet , 3D fix */
 
-    NMEA_add_checksum(NMEABuffer, sizeof(NMEABuffer) - strlen(NMEABuffer));
-
-    NMEA_Out(settings->nmea_out, (byte *) NMEABuffer, strlen(NMEABuffer), false);
+    NMEA_flush(&w);
 
     PGRMZ_TimeMarker = millis();
   }
@@ -210,6 +420,12 @@ void NMEA_fini()
 
 void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
 {
+#if defined(RASPBERRY_PI)
+  if (Pipeline_defer(dest, buf, size, nl)) {
+    return;
+  }
+#endif /* RASPBERRY_PI */
+
   switch (dest)
   {
   case NMEA_UART:
@@ -227,17 +443,8 @@ void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
     break;
   case NMEA_UDP:
     {
-      size_t udp_size = size;
-
-      if (size >= sizeof(UDPpacketBuffer))
-        udp_size = sizeof(UDPpacketBuffer) - 1;
-      memcpy(UDPpacketBuffer, buf, udp_size);
-
-      if (nl)
-        UDPpacketBuffer[udp_size] = '\n';
-
-      SoC->WiFi_transmit_UDP(NMEA_UDP_PORT, (byte *) UDPpacketBuffer,
-                              nl ? udp_size + 1 : udp_size);
+      /* sentences of one loop pass share a datagram */
+      UDPOut_write(UDPOUT_NMEA, buf, size, nl);
     }
     break;
   case NMEA_TCP:
@@ -252,6 +459,10 @@ void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
           }
         }
       }
+#elif defined(USE_TCP_OUTPUT)
+      TCPOut_write(TCPOUT_NMEA, buf, size);
+      if (nl)
+        TCPOut_write(TCPOUT_NMEA, (byte *) "\n", 1);
 #endif
     }
     break;
@@ -280,6 +491,13 @@ void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
 }
 
 void NMEA_Export()
+{
+  traffic_view_t view = Traffic_live();
+
+  NMEA_Export_view(&view);
+}
+
+void NMEA_Export_view(const traffic_view_t *view)
 {
     int bearing;
     int alt_diff;
@@ -299,11 +517,18 @@ void NMEA_Export()
     uint32_t HP_addr = 0;
     float HP_speed = 0.1; 
 
-    bool has_Fix = isValidFix() || (settings->mode == SOFTRF_MODE_TXRX_TEST);
+    bool has_Fix = view->fix || (settings->mode == SOFTRF_MODE_TXRX_TEST);
+
+    PROFILE(PROFILE_NMEA);
+
+    /* All the sentences of this cycle leave in one NMEA_Out() call */
+    NmeaWriter_t w;
+
+    NMEA_writer_init(&w, NMEA_Batch, sizeof(NMEA_Batch), settings->nmea_out);
 
     if (has_Fix) {
       for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (Container[i].addr && (this_moment - Container[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
+        if (view->traffic[i].addr && (this_moment - view->traffic[i].timestamp) <= EXPORT_EXPIRATION_TIME) {
 
 #if 0
           Serial.println(fo.addr);
@@ -317,60 +542,39 @@ void NMEA_Export()
           Serial.println(fo.no_track);
 #endif
           if (settings->nmea_l) {
-            distance = Container[i].distance;
+            distance = view->traffic[i].distance;
 
             if (distance < ALARM_ZONE_NONE) {
 
               total_objects++;
 
-              char str_climb_rate[8] = "";
-              uint8_t addr_type = Container[i].addr_type > ADDR_TYPE_ANONYMOUS ?
-                                  ADDR_TYPE_ANONYMOUS : Container[i].addr_type;
-
-              bearing = Container[i].bearing;
-              alarm_level = Container[i].alarm_level;
-              alt_diff = (int) (Container[i].altitude - ThisAircraft.altitude);
-
-              if (!Container[i].stealth && !ThisAircraft.stealth) {
-                dtostrf(
-                  constrain(Container[i].vs / (_GPS_FEET_PER_METER * 60.0), -32.7, 32.7),
-                  5, 1, str_climb_rate);
-              }
-
-              /*
-               * When callsign is available - send it to a NMEA client.
-               * If it is not - generate a callsign substitute,
-               * based upon a protocol ID and the ICAO address
-               */
-              memset((void *) NMEA_Callsign, 0, sizeof(NMEA_Callsign));
-
-              if (strnlen((char *) Container[i].callsign, sizeof(Container[i].callsign)) > 0) {
-                memcpy(NMEA_Callsign, Container[i].callsign, sizeof(Container[i].callsign));
-              } else {
-                memcpy(NMEA_Callsign, NMEA_CallSign_Prefix[Container[i].protocol],
-                  strlen(NMEA_CallSign_Prefix[Container[i].protocol]));
-
-                String str = "_";
-
-                ADDR_TO_HEX_STR(str, (Container[i].addr >> 16) & 0xFF);
-                ADDR_TO_HEX_STR(str, (Container[i].addr >>  8) & 0xFF);
-                ADDR_TO_HEX_STR(str, (Container[i].addr      ) & 0xFF);
-
-                str.toUpperCase();
-                memcpy(NMEA_Callsign + strlen(NMEA_CallSign_Prefix[Container[i].protocol]),
-                  str.c_str(), str.length());
+              uint8_t addr_type = view->traffic[i].addr_type > ADDR_TYPE_ANONYMOUS ?
+                                  ADDR_TYPE_ANONYMOUS : view->traffic[i].addr_type;
+
+              bearing = view->traffic[i].bearing;
+              alarm_level = view->traffic[i].alarm_level;
+              alt_diff = (int) (view->traffic[i].altitude - view->own->altitude);
+
+              NMEA_begin(&w, "PFLAA");
+              NMEA_field(&w); NMEA_put_int(&w, alarm_level);
+              NMEA_field(&w); NMEA_put_int(&w, (int) (distance * cos(radians(bearing))));
+              NMEA_field(&w); NMEA_put_int(&w, (int) (distance * sin(radians(bearing))));
+              NMEA_field(&w); NMEA_put_int(&w, alt_diff);
+              NMEA_field(&w); NMEA_put_int(&w, addr_type);
+              NMEA_field(&w); NMEA_put_hex(&w, view->traffic[i].addr, 6);
+              NMEA_put_char(&w, '!');
+              NMEA_put_callsign(&w, &view->traffic[i]);
+              NMEA_field(&w); NMEA_put_int(&w, (int) view->traffic[i].course);
+              NMEA_field(&w);
+              NMEA_field(&w); NMEA_put_int(&w, (int) (view->traffic[i].speed * _GPS_MPS_PER_KNOT));
+              NMEA_field(&w);
+              if (!view->traffic[i].stealth && !view->own->stealth) {
+                float climb_rate = constrain(view->traffic[i].vs / (_GPS_FEET_PER_METER * 60.0),
+                                             -32.7, 32.7);
+                NMEA_put_fixed(&w, (int32_t) lroundf(climb_rate * 10), 1);
               }
-
-              snprintf_P(NMEABuffer, sizeof(NMEABuffer), PSTR("$PFLAA,%d,%d,%d,%d,%d,%06X!%s,%d,,%d,%s,%d*"),
-                      alarm_level,
-                      (int) (distance * cos(radians(bearing))), (int) (distance * sin(radians(bearing))),
-                      alt_diff, addr_type, Container[i].addr, NMEA_Callsign,
-                      (int) Container[i].course, (int) (Container[i].speed * _GPS_MPS_PER_KNOT),
-                      ltrim(str_climb_rate), Container[i].aircraft_type);
-
-              NMEA_add_checksum(NMEABuffer, sizeof(NMEABuffer) - strlen(NMEABuffer));
-
-              NMEA_Out(settings->nmea_out, (byte *) NMEABuffer, strlen(NMEABuffer), false);
+              NMEA_field(&w); NMEA_put_int(&w, view->traffic[i].aircraft_type);
+              NMEA_end(&w);
 
               distance_absolut = sqrtf(distance * distance + alt_diff * alt_diff);
 
@@ -382,8 +586,8 @@ void NMEA_Export()
                 HP_alarm_level = alarm_level;
                 HP_distance = distance;
                 HP_distance_absolut = distance_absolut;
-                HP_addr = Container[i].addr;
-                HP_speed = Container[i].speed;  /* ground speed in knots */
+                HP_addr = view->traffic[i].addr;
+                HP_speed = view->traffic[i].speed;  /* ground speed in knots */
               }
             }
           }
@@ -394,165 +598,119 @@ void NMEA_Export()
     /* One PFLAU NMEA sentence is mandatory regardless of traffic reception status */
     if (settings->nmea_l) {
 
+      NMEA_begin(&w, "PFLAU");
+
       if (total_objects > 0) {
-        int rel_bearing = HP_bearing - ThisAircraft.course;
+        int rel_bearing = HP_bearing - view->own->course;
         rel_bearing += (rel_bearing < -180 ? 360 : (rel_bearing > 180 ? -360 : 0));
 
-        snprintf_P(NMEABuffer, sizeof(NMEABuffer),
-                PSTR("$PFLAU,%d,%d,%d,%d,%d,%d,%d,%d,%u,%06X" PFLAU_EXT1_FMT "*"),
-                total_objects,
-                settings->txpower == RF_TX_POWER_OFF ? TX_STATUS_OFF : TX_STATUS_ON,
-                GNSS_STATUS_3D_MOVING,
-                POWER_STATUS_GOOD, HP_alarm_level, rel_bearing,
-                HP_speed > 0.0 ? ALARM_TYPE_AIRCRAFT : ALARM_TYPE_TRAFFIC,
-                HP_alt_diff, (int) HP_distance, HP_addr
-                PFLAU_EXT1_ARGS );
+        NMEA_field(&w); NMEA_put_int(&w, total_objects);
+        NMEA_field(&w); NMEA_put_int(&w, settings->txpower == RF_TX_POWER_OFF ?
+                                         TX_STATUS_OFF : TX_STATUS_ON);
+        NMEA_field(&w); NMEA_put_int(&w, GNSS_STATUS_3D_MOVING);
+        NMEA_field(&w); NMEA_put_int(&w, POWER_STATUS_GOOD);
+        NMEA_field(&w); NMEA_put_int(&w, HP_alarm_level);
+        NMEA_field(&w); NMEA_put_int(&w, rel_bearing);
+        NMEA_field(&w); NMEA_put_int(&w, HP_speed > 0.0 ? ALARM_TYPE_AIRCRAFT :
+                                                          ALARM_TYPE_TRAFFIC);
+        NMEA_field(&w); NMEA_put_int(&w, HP_alt_diff);
+        NMEA_field(&w); NMEA_put_uint(&w, (unsigned int) HP_distance, 0);
+        NMEA_field(&w); NMEA_put_hex(&w, HP_addr, 6);
       } else {
-        snprintf_P(NMEABuffer, sizeof(NMEABuffer),
-                PSTR("$PFLAU,0,%d,%d,%d,%d,,0,,," PFLAU_EXT1_FMT "*"),
-                has_Fix && (settings->txpower != RF_TX_POWER_OFF) ?
-                  TX_STATUS_ON : TX_STATUS_OFF,
-                has_Fix ? GNSS_STATUS_3D_MOVING : GNSS_STATUS_NONE,
-                POWER_STATUS_GOOD, HP_alarm_level
-                PFLAU_EXT1_ARGS );
+        NMEA_put_str(&w, ",0");
+        NMEA_field(&w); NMEA_put_int(&w, has_Fix && (settings->txpower != RF_TX_POWER_OFF) ?
+                                         TX_STATUS_ON : TX_STATUS_OFF);
+        NMEA_field(&w); NMEA_put_int(&w, has_Fix ? GNSS_STATUS_3D_MOVING : GNSS_STATUS_NONE);
+        NMEA_field(&w); NMEA_put_int(&w, POWER_STATUS_GOOD);
+        NMEA_field(&w); NMEA_put_int(&w, HP_alarm_level);
+        NMEA_put_str(&w, ",,0,,,");
       }
 
-      NMEA_add_checksum(NMEABuffer, sizeof(NMEABuffer) - strlen(NMEABuffer));
+      PFLAU_EXT1(&w);
 
-      NMEA_Out(settings->nmea_out, (byte *) NMEABuffer, strlen(NMEABuffer), false);
+      NMEA_end(&w);
     }
-}
 
-#if defined(USE_NMEALIB)
+    NMEA_flush(&w);
+}
 
 void NMEA_Position()
 {
-  NmeaInfo info;
-  size_t i;
-  struct timeval tv;
-
   if (settings->nmea_g) {
-
-    nmeaInfoClear(&info);
-
-    info.sig = NMEALIB_SIG_SENSITIVE;
-    info.fix = NMEALIB_FIX_3D;
-
-    tv.tv_sec  = ThisAircraft.timestamp;
-    tv.tv_usec = 0;
-
-    nmeaTimeSet(&info.utc, &info.present, &tv);
-
-    info.latitude = ((int) ThisAircraft.latitude) * 100.0;
-    info.latitude += (ThisAircraft.latitude - (int) ThisAircraft.latitude) * 60.0;
-    info.longitude = ((int) ThisAircraft.longitude) * 100.0;
-    info.longitude += (ThisAircraft.longitude - (int) ThisAircraft.longitude) * 60.0;
-    info.speed = ThisAircraft.speed * _GPS_KMPH_PER_KNOT;
-    info.elevation = ThisAircraft.altitude; /* above MSL */
-    info.height = LookupSeparation(ThisAircraft.latitude, ThisAircraft.longitude);
-    info.track = ThisAircraft.course;
-
-#if 0
-    info.mtrack = 55;
-    info.magvar = 55;
-#endif
-    info.hdop = 2.3;
-    info.vdop = 1.2;
-    info.pdop = 2.594224354;
-
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_SIG);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_FIX);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_LAT);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_LON);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_SPEED);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_ELV);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_HEIGHT);
-
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_TRACK);
-#if 0
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_MTRACK);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_MAGVAR);
-#endif
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_HDOP);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_VDOP);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_PDOP);
-
-#if 0
-    info.satellites.inUseCount = NMEALIB_MAX_SATELLITES;
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_SATINUSECOUNT);
-    for (i = 0; i < NMEALIB_MAX_SATELLITES; i++) {
-      info.satellites.inUse[i] = (unsigned int) (i + 1);
-    }
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_SATINUSE);
-
-    info.satellites.inViewCount = NMEALIB_MAX_SATELLITES;
-    for (i = 0; i < NMEALIB_MAX_SATELLITES; i++) {
-      info.satellites.inView[i].prn = (unsigned int) i + 1;
-      info.satellites.inView[i].elevation = (int) ((i * 10) % 90);
-      info.satellites.inView[i].azimuth = (unsigned int) (i + 1);
-      info.satellites.inView[i].snr = 99 - (unsigned int) i;
-    }
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_SATINVIEWCOUNT);
-    nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_SATINVIEW);
-#endif
-
-    size_t gen_sz = nmeaSentenceFromInfo(&nmealib_buf, &info, (NmeaSentence)
-      (NMEALIB_SENTENCE_GPGGA | NMEALIB_SENTENCE_GPGSA | NMEALIB_SENTENCE_GPRMC));
-
-    if (gen_sz) {
-      NMEA_Out(settings->nmea_out, (byte *) nmealib_buf.buffer, gen_sz, false);
-    }
+    NmeaWriter_t w;
+    time_t t = ThisAircraft.timestamp;
+
+    NMEA_writer_init(&w, NMEA_Batch, sizeof(NMEA_Batch), settings->nmea_out);
+
+    NMEA_begin(&w, "GPGGA");
+    NMEA_put_time(&w, hour(t), minute(t), second(t), 0);
+    NMEA_put_coord(&w, ThisAircraft.latitude,  2, 'N', 'S');
+    NMEA_put_coord(&w, ThisAircraft.longitude, 3, 'E', 'W');
+    NMEA_put_str(&w, ",3,");    /* PPS fix, no satellites data */
+    NMEA_put_str(&w, ",2.3");   /* HDOP */
+    NMEA_field(&w);
+    NMEA_put_fixed(&w, (int32_t) lroundf(ThisAircraft.altitude * 10), 1); /* above MSL */
+    NMEA_put_str(&w, ",M,");
+    NMEA_put_fixed(&w, (int32_t) lroundf(
+      LookupSeparation(ThisAircraft.latitude, ThisAircraft.longitude) * 10), 1);
+    NMEA_put_str(&w, ",M,,");
+    NMEA_end(&w);
+
+    NMEA_begin(&w, "GPGSA");
+    NMEA_put_str(&w, ",A,3,,,,,,,,,,,,,2.6,2.3,1.2");
+    NMEA_end(&w);
+
+    NMEA_begin(&w, "GPRMC");
+    NMEA_put_time(&w, hour(t), minute(t), second(t), 0);
+    NMEA_put_str(&w, ",A");
+    NMEA_put_coord(&w, ThisAircraft.latitude,  2, 'N', 'S');
+    NMEA_put_coord(&w, ThisAircraft.longitude, 3, 'E', 'W');
+    NMEA_field(&w);
+    NMEA_put_fixed(&w, (int32_t) lroundf(ThisAircraft.speed * 10), 1); /* knots */
+    NMEA_field(&w);
+    NMEA_put_fixed(&w, (int32_t) lroundf(ThisAircraft.course * 10), 1);
+    NMEA_field(&w);
+    NMEA_put_uint(&w, day(t), 2);
+    NMEA_put_uint(&w, month(t), 2);
+    NMEA_put_uint(&w, year(t) % 100, 2);
+    NMEA_put_str(&w, ",,,P");
+    NMEA_end(&w);
+
+    NMEA_flush(&w);
   }
 }
 
 void NMEA_GGA()
 {
-  NmeaInfo info;
+  NmeaWriter_t w;
 
   float latitude = gnss.location.lat();
   float longitude = gnss.location.lng();
+  int sig = gnss.location.Quality();
 
-  nmeaInfoClear(&info);
-
-  info.utc.hour = gnss.time.hour();
-  info.utc.min = gnss.time.minute();
-  info.utc.sec = gnss.time.second();
-  info.utc.hsec = gnss.time.centisecond();
-
-  info.latitude = ((int) latitude) * 100.0;
-  info.latitude += (latitude - (int) latitude) * 60.0;
-  info.longitude = ((int) longitude) * 100.0;
-  info.longitude += (longitude - (int) longitude) * 60.0;
-
-  info.sig = (NmeaSignal) gnss.location.Quality();
-  info.satellites.inViewCount = gnss.satellites.value();
+  float elevation = gnss.altitude.meters(); /* above MSL */
+  float height = gnss.separation.meters();
 
-  info.hdop = gnss.hdop.hdop();
-
-  info.elevation = gnss.altitude.meters(); /* above MSL */
-  info.height = gnss.separation.meters();
-
-  if (info.height == 0.0 && info.sig != (NmeaSignal) Invalid) {
-    info.height = LookupSeparation(latitude, longitude);
-    info.elevation -= info.height;
+  if (height == 0.0 && sig != Invalid) {
+    height = LookupSeparation(latitude, longitude);
+    elevation -= height;
   }
 
-  nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_UTCTIME);
-  nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_LAT);
-  nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_LON);
-  nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_SIG);
-  /* Should be SATINUSECOUNT, but it seems to be a bug in NMEALib */
-  nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_SATINVIEWCOUNT);
-  nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_HDOP);
-  nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_ELV);
-  nmeaInfoSetPresent(&info.present, NMEALIB_PRESENT_HEIGHT);
-
-  size_t gen_sz = nmeaSentenceFromInfo(&nmealib_buf, &info, (NmeaSentence)
-                                        NMEALIB_SENTENCE_GPGGA );
-
-  if (gen_sz) {
-    NMEA_Out(settings->nmea_out, (byte *) nmealib_buf.buffer, gen_sz, false);
-  }
+  NMEA_writer_init(&w, NMEA_Batch, sizeof(NMEA_Batch), settings->nmea_out);
+
+  NMEA_begin(&w, "GPGGA");
+  NMEA_put_time(&w, gnss.time.hour(), gnss.time.minute(),
+                    gnss.time.second(), gnss.time.centisecond());
+  NMEA_put_coord(&w, latitude,  2, 'N', 'S');
+  NMEA_put_coord(&w, longitude, 3, 'E', 'W');
+  NMEA_field(&w); NMEA_put_int(&w, sig);
+  NMEA_field(&w); NMEA_put_uint(&w, gnss.satellites.value(), 2);
+  NMEA_field(&w); NMEA_put_fixed(&w, gnss.hdop.value() / 10, 1);
+  NMEA_field(&w); NMEA_put_fixed(&w, (int32_t) lroundf(elevation * 10), 1);
+  NMEA_put_str(&w, ",M,");
+  NMEA_put_fixed(&w, (int32_t) lroundf(height * 10), 1);
+  NMEA_put_str(&w, ",M,,");
+  NMEA_end(&w);
+
+  NMEA_flush(&w);
 }
-
-#endif /* USE_NMEALIB */
@@ -37,15 +37,51 @@ enum
 #define PSRFC_VERSION       1
 #define MAX_PSRFC_LEN       64
 
+/* Sentences of one export cycle are gathered into a buffer of this size */
+#if !defined(NMEA_BATCH_SIZE)
+#define NMEA_BATCH_SIZE     (4 * NMEA_BUFFER_SIZE)
+#endif
+
+#define NMEA_CALLSIGN_CACHE (2 * MAX_TRACKING_OBJECTS)
+
+/*
+ * Sentences are formatted in place, without any heap or printf use.
+ * The checksum is accumulated while the fields are being written.
+ */
+typedef struct NmeaWriter_struct {
+  char      *buf;
+  size_t    size;
+  size_t    len;
+  size_t    mark;       /* start of the sentence under way */
+  uint8_t   cs;
+  bool      overflow;
+  uint8_t   dest;
+} NmeaWriter_t;
+
 void NMEA_setup(void);
 void NMEA_loop(void);
 void NMEA_fini();
 void NMEA_Export(void);
+void NMEA_Export_view(const traffic_view_t *);
 void NMEA_Position(void);
 void NMEA_Out(uint8_t, byte *, size_t, bool);
 void NMEA_GGA(void);
 void NMEA_add_checksum(char *, size_t);
 
+void NMEA_writer_init(NmeaWriter_t *, char *, size_t, uint8_t);
+void NMEA_begin(NmeaWriter_t *, const char *);
+void NMEA_put_char(NmeaWriter_t *, char);
+void NMEA_put_str(NmeaWriter_t *, const char *);
+void NMEA_put_strn(NmeaWriter_t *, const char *, size_t);
+void NMEA_put_uint(NmeaWriter_t *, uint32_t, uint8_t);
+void NMEA_put_int(NmeaWriter_t *, int32_t);
+void NMEA_put_hex(NmeaWriter_t *, uint32_t, uint8_t);
+void NMEA_put_fixed(NmeaWriter_t *, int32_t, uint8_t);
+void NMEA_end(NmeaWriter_t *);
+void NMEA_flush(NmeaWriter_t *);
+
+#define NMEA_field(w)       NMEA_put_char((w), ',')
+
 extern char NMEABuffer[NMEA_BUFFER_SIZE];
 
 #if defined(NMEA_TCP_SERVICE)
@@ -61,12 +97,8 @@ typedef struct NmeaTCP_struct {
 
 #endif
 
-#if !defined(PFLAU_EXT1_FMT)
-#define PFLAU_EXT1_FMT  ""
-#endif /* PFLAU_EXT1_FMT */
-
-#if !defined(PFLAU_EXT1_ARGS)
-#define PFLAU_EXT1_ARGS
-#endif /* PFLAU_EXT1_ARGS */
+#if !defined(PFLAU_EXT1)
+#define PFLAU_EXT1(w)
+#endif /* PFLAU_EXT1 */
 
 #endif /* NMEAHELPER_H */
\ No newline at end of file
@@ -215,6 +215,7 @@ bool fanet_decode(void *fanet_pkt, ufo_t *this_aircraft, ufo_t *fop) {
     if (pkt->vendor  == SOFRF_FANET_VENDOR_ID &&
         pkt->address == (this_aircraft->addr & 0xFFFF) /* && */
         /* pkt->forward == 1 */) {
+      RF_reject = RF_REJECT_SELF;
       return rval;
     }
 
@@ -293,6 +294,8 @@ bool fanet_decode(void *fanet_pkt, ufo_t *this_aircraft, ufo_t *fop) {
     Serial.flush();
 #endif
     rval = true;
+  } else {
+    RF_reject = RF_REJECT_TYPE;
   }
 
   return rval;
@@ -137,6 +137,7 @@ bool legacy_decode(void *legacy_pkt, ufo_t *this_aircraft, ufo_t *fop) {
           StdOut.print(F("$PSRFE,bad parity of decoded packet: "));
           StdOut.println(pkt_parity % 2, HEX);
         }
+        RF_reject = RF_REJECT_PARITY;
         return false;
     }
 
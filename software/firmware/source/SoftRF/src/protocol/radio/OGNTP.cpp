@@ -75,6 +75,7 @@ bool ogntp_decode(void *pkt, ufo_t *this_aircraft, ufo_t *fop) {
 //  }
 
   if ( ogn_rx_pkt.Packet.Header.Other || ogn_rx_pkt.Packet.Header.Encrypted ) {
+    RF_reject = RF_REJECT_TYPE;
     return false;
   }
 
@@ -89,6 +90,7 @@ bool ogntp_decode(void *pkt, ufo_t *this_aircraft, ufo_t *fop) {
   if ((ogn_rx_pkt.Packet.Header.Address    == this_aircraft->addr) &&
       (ogn_rx_pkt.Packet.Header.AddrType   == addr_type          ) &&
       (ogn_rx_pkt.Packet.Header.RelayCount > 0 )) {
+    RF_reject = RF_REJECT_SELF;
     return false;
   }
 
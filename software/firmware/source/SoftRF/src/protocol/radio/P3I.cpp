@@ -68,8 +68,10 @@ bool p3i_decode(void *p3i_pkt, ufo_t *this_aircraft, ufo_t *fop) {
   for (int i=0; i<sizeof(p3i_packet_t); i++) {
     cs ^= *p++;
   }
-  if (cs)
+  if (cs) {
+    RF_reject = RF_REJECT_PARITY;
     return(false);
+  }
 
   fop->protocol = RF_PROTOCOL_P3I;
 
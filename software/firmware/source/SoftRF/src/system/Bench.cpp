@@ -0,0 +1,1682 @@
+/*
+ * BenchHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../../SoftRF.h"
+
+#if defined(RASPBERRY_PI)
+
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <TimeLib.h>
+
+#include "Bench.h"
+#include "Pipeline.h"
+#include "Time.h"
+#include "Corpus.h"
+#include "../TrafficHelper.h"
+#include "../driver/RF.h"
+#include "../driver/EEPROM.h"
+#include "../protocol/data/NMEA.h"
+#include "../protocol/data/D1090.h"
+#include "../protocol/data/JSON.h"
+#include "../protocol/data/GDL90.h"
+#include "../protocol/radio/Legacy.h"
+#include "../protocol/radio/OGNTP.h"
+#include "../protocol/radio/FANET.h"
+#include "../protocol/radio/P3I.h"
+#include "../protocol/radio/UAT978.h"
+#include "../driver/GNSS.h"
+#include "../driver/GPSD.h"
+#include "../driver/EPD.h"
+
+#include <adsb_encoder.h>
+
+/*
+ * Host side benchmarks. These run before any of the hardware is touched:
+ *
+ *   ./SoftRF --bench [--json=FILE] [--perf] [nmea] [d1090] [json] [queue]
+ *                    [clock] [pps] [traffic] [codec] [gpsd]
+ *   ./SoftRF-host --bench [--frames=DIR] [views] ...
+ *
+ * A count after the name, as in traffic:500, overrides the default.
+ * --json appends one JSON object per result to FILE, to be tracked
+ * across revisions. --perf adds CPU counters where the kernel allows.
+ * --frames saves the last frame of each view run into DIR.
+ */
+
+#define BENCH_PERF_EVENTS 4
+
+typedef struct Bench_perf_struct {
+  bool      valid;
+  uint64_t  cycles;
+  uint64_t  instructions;
+  uint64_t  branch_misses;
+  uint64_t  cache_misses;
+} Bench_perf_t;
+
+static FILE       *Bench_json;
+static const char *Bench_name;
+static time_t     Bench_started;
+static int        Bench_perf_fd[BENCH_PERF_EVENTS] = { -1, -1, -1, -1 };
+
+static uint64_t Bench_ns()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* A group of user space counters led by the cycle counter */
+static bool Bench_perf_open()
+{
+  static const uint64_t config[BENCH_PERF_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES,
+  };
+
+  for (int i = 0; i < BENCH_PERF_EVENTS; i++) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = config[i];
+    attr.disabled       = (i == 0);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP;
+
+    Bench_perf_fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1,
+                               i == 0 ? -1 : Bench_perf_fd[0], 0);
+    if (Bench_perf_fd[i] < 0) {
+      fprintf(stderr, "CPU counters are not available: %s\n", strerror(errno));
+      for (int j = 0; j < i; j++) {
+        close(Bench_perf_fd[j]);
+        Bench_perf_fd[j] = -1;
+      }
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void Bench_perf_start()
+{
+  if (Bench_perf_fd[0] >= 0) {
+    ioctl(Bench_perf_fd[0], PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+    ioctl(Bench_perf_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+static void Bench_perf_stop(Bench_perf_t *perf)
+{
+  uint64_t values[1 + BENCH_PERF_EVENTS];
+
+  memset(perf, 0, sizeof(*perf));
+
+  if (Bench_perf_fd[0] < 0) {
+    return;
+  }
+
+  ioctl(Bench_perf_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  if (read(Bench_perf_fd[0], values, sizeof(values)) == sizeof(values) &&
+      values[0] == BENCH_PERF_EVENTS) {
+    perf->valid         = true;
+    perf->cycles        = values[1];
+    perf->instructions  = values[2];
+    perf->branch_misses = values[3];
+    perf->cache_misses  = values[4];
+  }
+}
+
+static void Bench_record(const char *name, unsigned long items, uint64_t ns,
+                         const Bench_perf_t *perf, long mismatches)
+{
+  if (Bench_json == NULL) {
+    return;
+  }
+
+  fprintf(Bench_json,
+          "{\"bench\":\"%s\",\"name\":\"%s\",\"rev\":\"%s\",\"time\":%ld,"
+          "\"items\":%lu,\"ns\":%llu,\"ns_per_item\":%.2f",
+          Bench_name, name, SOFTRF_FIRMWARE_VERSION, (long) Bench_started,
+          items, (unsigned long long) ns, (double) ns / items);
+  if (perf && perf->valid) {
+    fprintf(Bench_json,
+            ",\"cycles_per_item\":%.2f,\"instructions_per_item\":%.2f"
+            ",\"branch_misses_per_item\":%.4f,\"cache_misses_per_item\":%.4f",
+            (double) perf->cycles / items, (double) perf->instructions / items,
+            (double) perf->branch_misses / items, (double) perf->cache_misses / items);
+  }
+  if (mismatches >= 0) {
+    fprintf(Bench_json, ",\"mismatches\":%ld", mismatches);
+  }
+  fprintf(Bench_json, "}\n");
+  fflush(Bench_json);
+}
+
+static void Bench_report(const char *name, unsigned long items, uint64_t ns)
+{
+  double secs = ns / 1e9;
+
+  printf("%-16s %10lu items %8.3f s %12.0f items/s %8.1f ns/item\n",
+         name, items, secs, items / secs, (double) ns / items);
+
+  Bench_record(name, items, ns, NULL, -1);
+}
+
+/* One line per codec operation, counters and golden check included */
+static void Bench_result(const char *name, unsigned long ops, uint64_t ns,
+                         const Bench_perf_t *perf, unsigned long mismatches)
+{
+  printf("%-16s %10lu ops %8.1f ns/op", name, ops, (double) ns / ops);
+  if (perf->valid) {
+    printf(" %8.1f cycles/op %5.2f IPC %7.3f br-miss/op",
+           (double) perf->cycles / ops,
+           perf->cycles ? (double) perf->instructions / perf->cycles : 0.0,
+           (double) perf->branch_misses / ops);
+  }
+  if (mismatches) {
+    printf("  %lu of %u MISMATCH", mismatches, (unsigned int) CORPUS_STATES);
+  }
+  printf("\n");
+
+  Bench_record(name, ops, ns, perf, mismatches);
+}
+
+/* A fully populated traffic table, half of it without callsigns */
+static void Bench_Traffic()
+{
+  time_t timestamp = now();
+
+  ThisAircraft.latitude  = 56.0;
+  ThisAircraft.longitude = 38.0;
+  ThisAircraft.altitude  = 1000.0;
+  ThisAircraft.course    = 90.0;
+  ThisAircraft.speed     = 60.0;
+  ThisAircraft.timestamp = timestamp;
+
+  for (int i = 0; i < MAX_TRACKING_OBJECTS; i++) {
+    ufo_t *fop = &Container[i];
+
+    memset(fop, 0, sizeof(ufo_t));
+
+    fop->addr          = 0xDD0000 + 0x111 * i;
+    fop->protocol      = i % 2 ? RF_PROTOCOL_LEGACY : RF_PROTOCOL_ADSB_1090;
+    fop->addr_type     = ADDR_TYPE_ICAO;
+    fop->timestamp     = timestamp;
+    fop->latitude      = ThisAircraft.latitude  + 0.01 * i;
+    fop->longitude     = ThisAircraft.longitude - 0.01 * i;
+    fop->altitude      = ThisAircraft.altitude  + 50 * i - 200;
+    fop->course        = 45 * i;
+    fop->speed         = 50 + 10 * i;
+    fop->vs            = 120 * i - 400;
+    fop->aircraft_type = AIRCRAFT_TYPE_GLIDER;
+    fop->distance      = 500 + 1000 * i;
+    fop->bearing       = 40 * i;
+    fop->alarm_level   = i == 0 ? ALARM_LEVEL_LOW : ALARM_LEVEL_NONE;
+
+    if (fop->protocol == RF_PROTOCOL_ADSB_1090) {
+      snprintf((char *) fop->callsign, sizeof(fop->callsign), "SRF%04X", i);
+    }
+  }
+}
+
+void Bench_NMEA(unsigned long cycles)
+{
+  uint64_t start;
+
+  settings->mode     = SOFTRF_MODE_TXRX_TEST;  /* bypass GNSS fix check */
+  settings->nmea_g   = true;
+  settings->nmea_l   = true;
+  settings->nmea_out = NMEA_OFF;
+  settings->txpower  = RF_TX_POWER_FULL;
+
+  NMEA_setup();
+  Bench_Traffic();
+
+  start = Bench_ns();
+  for (unsigned long i = 0; i < cycles; i++) {
+    NMEA_Export();
+  }
+  /* PFLAA for every target and one PFLAU */
+  Bench_report("NMEA_Export", cycles * (MAX_TRACKING_OBJECTS + 1),
+               Bench_ns() - start);
+
+  start = Bench_ns();
+  for (unsigned long i = 0; i < cycles; i++) {
+    NMEA_Position();
+  }
+  /* GGA, GSA and RMC */
+  Bench_report("NMEA_Position", cycles * 3, Bench_ns() - start);
+}
+
+void Bench_D1090(unsigned long cycles)
+{
+  uint64_t start;
+
+  settings->mode  = SOFTRF_MODE_TXRX_TEST;
+  settings->d1090 = D1090_UDP;  /* formatted, but not sent anywhere */
+
+  Bench_Traffic();
+
+  /* steady state: nothing has changed since the previous cycle */
+  start = Bench_ns();
+  for (unsigned long i = 0; i < cycles; i++) {
+    D1090_Export();
+  }
+  Bench_report("D1090_Export", cycles * MAX_TRACKING_OBJECTS, Bench_ns() - start);
+
+  /* every target has moved */
+  start = Bench_ns();
+  for (unsigned long i = 0; i < cycles; i++) {
+    for (int j = 0; j < MAX_TRACKING_OBJECTS; j++) {
+      Container[j].latitude += 0.0001;
+      Container[j].vs       += 1;
+    }
+    D1090_Export();
+  }
+  Bench_report("D1090_Export/mv", cycles * MAX_TRACKING_OBJECTS, Bench_ns() - start);
+}
+
+static size_t Bench_JSON_bytes;
+
+static void Bench_JSON_sink(const char *buf, size_t size)
+{
+  Bench_JSON_bytes += size;
+}
+
+void Bench_JSON(unsigned long cycles)
+{
+  traffic_view_t view = Traffic_live();
+  uint64_t start;
+
+  Bench_Traffic();
+
+  Bench_JSON_bytes = 0;
+  start = Bench_ns();
+  for (unsigned long i = 0; i < cycles; i++) {
+    JSON_Export_to(Bench_JSON_sink, &view);
+  }
+  /* CPU time per aircraft object */
+  Bench_report("JSON_Export", cycles * MAX_TRACKING_OBJECTS, Bench_ns() - start);
+  printf("%-16s %10lu bytes per cycle\n", "", (unsigned long) (Bench_JSON_bytes / cycles));
+}
+
+static Queue_t Bench_queue;
+
+static void *Bench_Queue_producer(void *arg)
+{
+  unsigned long cycles = *(unsigned long *) arg;
+  Pipeline_rx_t rx;
+
+  memset(&rx, 0, sizeof(rx));
+
+  for (unsigned long i = 0; i < cycles; i++) {
+    rx.stamp = i;
+    while (!Queue_push(&Bench_queue, &rx)) {
+      sched_yield();
+    }
+  }
+
+  return NULL;
+}
+
+/* Radio to traffic stage hand-over, one thread on each side */
+void Bench_Queue(unsigned long cycles)
+{
+  pthread_t producer;
+  Pipeline_rx_t rx;
+  unsigned long errors = 0;
+  uint64_t start;
+
+  if (!Queue_init(&Bench_queue, PIPELINE_RX_DEPTH, sizeof(Pipeline_rx_t))) {
+    return;
+  }
+
+  start = Bench_ns();
+  pthread_create(&producer, NULL, Bench_Queue_producer, &cycles);
+  for (unsigned long i = 0; i < cycles; i++) {
+    while (!Queue_pop(&Bench_queue, &rx)) {
+      sched_yield();
+    }
+    if (rx.stamp != (unsigned int) i) {
+      errors++;
+    }
+  }
+  pthread_join(producer, NULL);
+
+  Bench_report("Queue", cycles, Bench_ns() - start);
+  printf("%-16s %10lu out of order, %u full\n", "", errors, Bench_queue.dropped);
+
+  free(Bench_queue.items);
+}
+
+/*
+ * Cost of a time base reading, then a unit running for weeks, played
+ * through 32-bit counters: micros() sampled at uneven intervals and
+ * millis() driving a 1 s marker, both across a number of rollovers.
+ */
+void Bench_Clock(unsigned long cycles)
+{
+  Time_ext_t ext;
+  volatile uint64_t sink;
+  uint64_t start, truth;
+  unsigned long errors = 0;
+  unsigned long wraps;
+
+  start = Bench_ns();
+  for (unsigned long i = 0; i < cycles; i++) {
+    sink = Time_us();
+  }
+  Bench_report("Time_us", cycles, Bench_ns() - start);
+  (void) sink;
+
+  /* micros(), 0.1 to 3 s between readings */
+  truth = 0xFFFFFFFFULL - 5000000;
+  ext.last  = (uint32_t) truth;
+  ext.wraps = 0;
+  for (unsigned long i = 0; i < cycles / 10; i++) {
+    truth += 100000 + (i * 7919) % 2900000;
+    if (Time_extend(&ext, (uint32_t) truth) != truth) {
+      errors++;
+    }
+  }
+  wraps = ext.wraps;
+
+  /* millis(), one reading per ms, past a single rollover */
+  uint64_t marker = 0, fired = 0;
+
+  truth = 0xFFFFFFFFULL - 100000;
+  ext.last  = (uint32_t) truth;
+  ext.wraps = 0;
+  for (unsigned long i = 0; i < 200000; i++, truth++) {
+    uint64_t ms = Time_extend(&ext, (uint32_t) truth);
+
+    if (ms - marker > 1000) {
+      if (marker != 0 && ms - marker != 1001) {
+        errors++;
+      }
+      marker = ms;
+      fired++;
+    }
+  }
+
+  printf("%-16s %10lu micros() rollovers, %lu markers, %lu errors\n", "",
+         wraps + ext.wraps, (unsigned long) fired, errors);
+}
+
+static uint32_t Bench_seed = 2463534242UL;
+
+/* xorshift32 - the same sequence on every run */
+static uint32_t Bench_random()
+{
+  Bench_seed ^= Bench_seed << 13;
+  Bench_seed ^= Bench_seed >> 17;
+  Bench_seed ^= Bench_seed << 5;
+
+  return Bench_seed;
+}
+
+/*
+ * PPS simulator for the disciplined clock. The local time base runs
+ * 37.5 ppm fast with a 2 ppm thermal swing over half an hour. Edges carry
+ * up to 2 us of interrupt jitter, one in 97 is lost and there is a 90 s
+ * outage half way. Sentences come 150 to 650 ms into their second.
+ * The model is read four times a second, against the true UTC.
+ */
+void Bench_PPS(unsigned long seconds)
+{
+  const uint64_t epoch = 1700000000ULL;
+  double   local = 5e9, rate = 1.0;
+  double   sum = 0, worst = 0;
+  unsigned long reads = 0, beyond = 0, locked = seconds;
+  uint64_t start, spent = 0;
+  Time_model_t m;
+
+  Time_reset();
+
+  for (unsigned long s = 0; s < seconds; s++) {
+    uint64_t truth = (epoch + s) * 1000000;
+    bool outage = (s >= seconds / 2 && s < seconds / 2 + 90);
+
+    rate = 1.0 + 37.5e-6 + 2e-6 * sin(2 * M_PI * s / 1800.0);
+
+    if (!outage && s % 97 != 13) {
+      double jitter = (double) (Bench_random() % 4001) / 1000.0 - 2.0;
+
+      Time_pps((uint64_t) llround(local + jitter), 0);
+    }
+
+    double late = 150000 + Bench_random() % 500000;
+    Time_nmea((uint32_t) (epoch + s), 0, (uint64_t) llround(local + late * rate));
+
+    for (int i = 0; i < 4; i++) {
+      double   into = late + (double) (Bench_random() % 1000) * (1e6 - late) / 1000;
+      uint32_t err;
+      uint64_t utc;
+
+      start = Bench_ns();
+      utc = Time_to_utc((uint64_t) llround(local + into * rate), &err);
+      spent += Bench_ns() - start;
+
+      double e = fabs((double) (int64_t) (utc - truth) - into);
+
+      reads++;
+      if (e > err) {
+        beyond++;
+      }
+      if (err < TIME_STAMP_ERROR) {
+        if (locked > s) {
+          locked = s;
+        }
+        sum += e;
+        worst = e > worst ? e : worst;
+      }
+    }
+
+    local += 1e6 * rate;
+  }
+
+  Time_model(&m);
+
+  Bench_report("Time_to_utc", reads, spent);
+  printf("%-16s %10lu s simulated, stamp grade from %lu s, error %.2f us mean, %.2f us max\n",
+         "", seconds, locked, sum / reads, worst);
+  printf("%-16s %10lu reads beyond the error estimate, %u slips, drift %.3f ppm (%.3f ppm)\n",
+         "", beyond, m.slips, m.drift / 1000.0, (rate - 1.0) * 1e6);
+
+  Time_reset();
+}
+
+/*
+ * Synthetic traffic scenario, end to end. A mix of thermalling gaggles,
+ * crossing jets and ground traffic around the own ship sends one packet
+ * per second per aircraft, each in one of four protocols. Every packet is
+ * encoded, decoded and filed into the table with ParseData(), then once a
+ * simulated second the table is aged and all the exporters run, writing
+ * to a counting UART.
+ */
+
+enum
+{
+  BENCH_GAGGLE,
+  BENCH_JET,
+  BENCH_GROUND
+};
+
+typedef struct Bench_flight_struct {
+  uint8_t   kind;
+  uint8_t   protocol;
+  uint32_t  addr;
+  double    north, east;  /* thermal centre or track origin, m */
+  double    radius;       /* m */
+  double    phase;        /* rad, or m along the track */
+  double    heading;      /* rad */
+  double    speed;        /* m/s */
+  double    alt, climb;   /* m, m/s */
+} Bench_flight_t;
+
+enum
+{
+  BENCH_STAGE_ENCODE,
+  BENCH_STAGE_PARSE,
+  BENCH_STAGE_TRAFFIC,
+  BENCH_STAGE_NMEA,
+  BENCH_STAGE_GDL90,
+  BENCH_STAGE_D1090,
+  BENCH_STAGE_JSON,
+  BENCH_STAGE_PUBLISH,
+  BENCH_STAGES
+};
+
+static const char *Bench_stage_name[BENCH_STAGES] = {
+  [BENCH_STAGE_ENCODE]  = "encode",
+  [BENCH_STAGE_PARSE]   = "ParseData",
+  [BENCH_STAGE_TRAFFIC] = "Traffic_loop",
+  [BENCH_STAGE_NMEA]    = "NMEA_Export",
+  [BENCH_STAGE_GDL90]   = "GDL90_Export",
+  [BENCH_STAGE_D1090]   = "D1090_Export",
+  [BENCH_STAGE_JSON]    = "JSON_Export",
+  [BENCH_STAGE_PUBLISH] = "Traffic_publish",
+};
+
+typedef struct Bench_stage_struct {
+  uint32_t  *ns;
+  unsigned long count;
+  uint64_t  total;
+  uint64_t  bytes;
+} Bench_stage_t;
+
+static const struct {
+  uint8_t protocol;
+  size_t  (*encode)(void *, ufo_t *);
+  bool    (*decode)(void *, ufo_t *, ufo_t *);
+} Bench_codec[] = {
+  { RF_PROTOCOL_LEGACY, legacy_encode, legacy_decode },
+  { RF_PROTOCOL_OGNTP,  ogntp_encode,  ogntp_decode  },
+  { RF_PROTOCOL_FANET,  fanet_encode,  fanet_decode  },
+  { RF_PROTOCOL_P3I,    p3i_encode,    p3i_decode    },
+};
+
+#define BENCH_CODECS  (sizeof(Bench_codec) / sizeof(Bench_codec[0]))
+
+static uint64_t Bench_UART_bytes;
+
+static size_t Bench_UART_write(const uint8_t *buf, size_t size)
+{
+  Bench_UART_bytes += size;
+  return size;
+}
+
+static IODev_ops_t Bench_UART_ops = {
+  "Bench UART",
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Bench_UART_write
+};
+
+/* Decoder in use, wrapped to tell undecoded frames from dropped ones */
+static bool (*Bench_decoder)(void *, ufo_t *, ufo_t *);
+static bool Bench_decoded;
+
+static bool Bench_decode(void *pkt, ufo_t *this_aircraft, ufo_t *fop)
+{
+  Bench_decoded = Bench_decoder(pkt, this_aircraft, fop);
+
+  return Bench_decoded;
+}
+
+static void Bench_JSON_count(const char *buf, size_t size)
+{
+  Bench_UART_bytes += size;
+}
+
+static double Bench_uniform(double lo, double hi)
+{
+  return lo + (hi - lo) * (Bench_random() % 100001) / 100000.0;
+}
+
+static void Bench_Scenario_fleet(Bench_flight_t *fleet, unsigned long count)
+{
+  unsigned long thermals = 1 + count / 12;
+
+  for (unsigned long i = 0; i < count; i++) {
+    Bench_flight_t *f = &fleet[i];
+    unsigned long  kind = Bench_random() % 10;
+
+    memset(f, 0, sizeof(*f));
+    f->addr     = 0x3E0000 + i;
+    f->protocol = i % BENCH_CODECS;
+
+    /* FANET carries a 16 bit address under the vendor id */
+    if (Bench_codec[f->protocol].protocol == RF_PROTOCOL_FANET) {
+      f->addr = (SOFRF_FANET_VENDOR_ID << 16) | (f->addr & 0xFFFF);
+    }
+
+    if (kind < 7) {
+      /* gliders share a thermal, all turning the same way */
+      unsigned long t = Bench_random() % thermals;
+      uint32_t seed = Bench_seed;
+
+      Bench_seed = 2463534242UL + 7919 * t;
+      f->north = Bench_uniform(-3000, 3000);
+      f->east  = Bench_uniform(-3000, 3000);
+      f->climb = Bench_uniform(1.0, 3.5);
+      Bench_seed = seed;
+
+      f->kind   = BENCH_GAGGLE;
+      f->radius = Bench_uniform(70, 160);
+      f->phase  = Bench_uniform(0, 2 * M_PI);
+      f->speed  = Bench_uniform(22, 28);
+      f->alt    = Bench_uniform(700, 1600);
+    } else if (kind < 8) {
+      f->kind    = BENCH_JET;
+      f->heading = Bench_uniform(0, 2 * M_PI);
+      f->north   = Bench_uniform(-8000, 8000);  /* offset across the track */
+      f->phase   = Bench_uniform(-40000, 40000);
+      f->speed   = Bench_uniform(150, 235);
+      f->alt     = Bench_uniform(6000, 11000);
+    } else {
+      /* taxiing up and down the runway */
+      f->kind    = BENCH_GROUND;
+      f->heading = 120 * M_PI / 180;
+      f->north   = Bench_uniform(-600, -400);
+      f->east    = Bench_uniform(200, 400);
+      f->phase   = Bench_uniform(0, 1600);
+      f->speed   = Bench_uniform(0, 8);
+      f->alt     = 150;
+    }
+  }
+}
+
+/* Where the aircraft is s seconds into the scenario */
+static void Bench_Scenario_fix(Bench_flight_t *f, unsigned long s, ufo_t *fop)
+{
+  double north, east, alt, course, vs = 0;
+
+  switch (f->kind)
+  {
+  case BENCH_GAGGLE:
+    {
+      double a = f->phase + s * f->speed / f->radius;
+
+      north  = f->north + f->radius * sin(a);
+      east   = f->east  + f->radius * cos(a);
+      course = atan2(-sin(a), cos(a));
+      /* climb through a 600 m band, then start over at the bottom */
+      alt    = f->alt + fmod(s * f->climb, 600);
+      vs     = f->climb;
+    }
+    break;
+  case BENCH_JET:
+    {
+      double along = fmod(f->phase + 40000 + s * f->speed, 80000) - 40000;
+
+      north  = along * cos(f->heading) - f->north * sin(f->heading);
+      east   = along * sin(f->heading) + f->north * cos(f->heading);
+      course = f->heading;
+      alt    = f->alt;
+    }
+    break;
+  case BENCH_GROUND:
+  default:
+    {
+      double along = fmod(f->phase + s * f->speed, 3200);
+      double dir   = f->heading;
+
+      if (along > 1600) {
+        along = 3200 - along;
+        dir  += M_PI;
+      }
+      north  = f->north + along * cos(f->heading);
+      east   = f->east  + along * sin(f->heading);
+      course = dir;
+      alt    = f->alt;
+    }
+    break;
+  }
+
+  memset(fop, 0, sizeof(ufo_t));
+
+  fop->addr          = f->addr;
+  fop->addr_type     = ADDR_TYPE_FLARM;
+  fop->protocol      = Bench_codec[f->protocol].protocol;
+  fop->timestamp     = now();
+  fop->latitude      = ThisAircraft.latitude + north / 111320.0;
+  fop->longitude     = ThisAircraft.longitude +
+                       east / (111320.0 * cos(ThisAircraft.latitude * M_PI / 180));
+  fop->altitude      = alt;
+  fop->course        = fmod(course * 180 / M_PI + 360, 360);
+  fop->speed         = f->speed / _GPS_MPS_PER_KNOT;
+  fop->vs            = vs * _GPS_FEET_PER_METER * 60.0;
+  fop->aircraft_type = f->kind == BENCH_JET    ? AIRCRAFT_TYPE_JET :
+                       f->kind == BENCH_GROUND ? AIRCRAFT_TYPE_TOWPLANE :
+                                                 AIRCRAFT_TYPE_GLIDER;
+}
+
+static int Bench_cmp_ns(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a;
+  uint32_t y = *(const uint32_t *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void Bench_stage_time(Bench_stage_t *stage, uint64_t start)
+{
+  uint64_t ns = Bench_ns() - start;
+
+  stage->ns[stage->count++] = ns > UINT32_MAX ? UINT32_MAX : (uint32_t) ns;
+  stage->total += ns;
+}
+
+static int Bench_addr_slot(uint32_t addr)
+{
+  for (int i = 0; i < MAX_TRACKING_OBJECTS; i++) {
+    if (Container[i].addr == addr) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+void Bench_Scenario(unsigned long aircraft)
+{
+  const unsigned long seconds = BENCH_TRAFFIC_SECONDS;
+  const time_t epoch = 1700000000;
+  const SoC_ops_t *soc = SoC;
+  SoC_ops_t bench_soc = RPi_ops;  /* SoC_setup() has not run yet */
+  settings_t saved = *settings;
+  Bench_stage_t stage[BENCH_STAGES];
+  Bench_flight_t *fleet;
+  unsigned long decoded = 0, updates = 0, admitted = 0, evicted = 0, dropped = 0;
+  unsigned long undecoded = 0;
+  bool fix = hasValidGPSDFix;
+  unsigned long occupancy = 0, occupancy_max = 0;
+  uint64_t total = 0;
+
+  if (aircraft == 0) {
+    return;
+  }
+
+  fleet = (Bench_flight_t *) calloc(aircraft, sizeof(Bench_flight_t));
+  memset(stage, 0, sizeof(stage));
+  for (int k = 0; k < BENCH_STAGES; k++) {
+    stage[k].ns = (uint32_t *) calloc(k <= BENCH_STAGE_PARSE ? aircraft * seconds : seconds,
+                                      sizeof(uint32_t));
+  }
+
+  bench_soc.UART_ops = &Bench_UART_ops;
+  SoC = &bench_soc;
+
+  settings->mode     = SOFTRF_MODE_TXRX_TEST;  /* bypass GNSS fix check */
+  settings->nmea_p   = false;
+  settings->nmea_g   = true;
+  settings->nmea_s   = false;
+  settings->nmea_l   = true;
+  settings->nmea_out = NMEA_UART;
+  settings->gdl90    = GDL90_UART;
+  settings->d1090    = D1090_UART;
+  settings->alarm    = TRAFFIC_ALARM_DISTANCE;
+
+  hasValidGPSDFix    = true;
+
+  NMEA_setup();
+  Traffic_setup();
+
+  memset(Container, 0, sizeof(ufo_t) * MAX_TRACKING_OBJECTS);
+  ThisAircraft.addr      = 0xABCDEF;
+  ThisAircraft.latitude  = 56.0;
+  ThisAircraft.longitude = 38.0;
+  ThisAircraft.altitude  = 1000.0;
+  ThisAircraft.course    = 90.0;
+  ThisAircraft.speed     = 0.0;
+
+  Bench_Scenario_fleet(fleet, aircraft);
+
+  for (unsigned long s = 0; s < seconds; s++) {
+    uint64_t start, bytes;
+
+    setTime(epoch + s);
+    ThisAircraft.timestamp = now();
+
+    for (unsigned long i = 0; i < aircraft; i++) {
+      Bench_flight_t *f = &fleet[i];
+      ufo_t tx;
+      int was, slot, busy = 0;
+
+      Bench_Scenario_fix(f, s, &tx);
+
+      start = Bench_ns();
+      Bench_codec[f->protocol].encode((void *) RxBuffer, &tx);
+      Bench_stage_time(&stage[BENCH_STAGE_ENCODE], start);
+
+      settings->rf_protocol = Bench_codec[f->protocol].protocol;
+      protocol_decode       = Bench_decode;
+      Bench_decoder         = Bench_codec[f->protocol].decode;
+      RF_last_rssi          = VIRTUAL_RSSI;
+      RF_last_utc           = (uint64_t) (epoch + s) * 1000000;
+
+      was = Bench_addr_slot(f->addr);
+      for (int j = 0; j < MAX_TRACKING_OBJECTS; j++) {
+        if (Container[j].addr && now() - Container[j].timestamp <= ENTRY_EXPIRATION_TIME) {
+          busy++;
+        }
+      }
+
+      start = Bench_ns();
+      ParseData(true);
+      Bench_stage_time(&stage[BENCH_STAGE_PARSE], start);
+
+      if (!Bench_decoded) {
+        undecoded++;
+        continue;
+      }
+
+      decoded++;
+      slot = Bench_addr_slot(f->addr);
+      if (slot < 0) {
+        dropped++;
+      } else if (was >= 0) {
+        updates++;
+      } else if (busy == MAX_TRACKING_OBJECTS) {
+        evicted++;
+      } else {
+        admitted++;
+      }
+    }
+
+    UpdateTrafficTimeMarker = 0;
+    start = Bench_ns();
+    Traffic_loop();
+    Bench_stage_time(&stage[BENCH_STAGE_TRAFFIC], start);
+
+    int count = Traffic_Count();
+    occupancy += count;
+    occupancy_max = count > (int) occupancy_max ? count : occupancy_max;
+
+    bytes = Bench_UART_bytes;
+    start = Bench_ns();
+    NMEA_Export();
+    Bench_stage_time(&stage[BENCH_STAGE_NMEA], start);
+    stage[BENCH_STAGE_NMEA].bytes += Bench_UART_bytes - bytes;
+
+    bytes = Bench_UART_bytes;
+    start = Bench_ns();
+    GDL90_Export();
+    Bench_stage_time(&stage[BENCH_STAGE_GDL90], start);
+    stage[BENCH_STAGE_GDL90].bytes += Bench_UART_bytes - bytes;
+
+    bytes = Bench_UART_bytes;
+    start = Bench_ns();
+    D1090_Export();
+    Bench_stage_time(&stage[BENCH_STAGE_D1090], start);
+    stage[BENCH_STAGE_D1090].bytes += Bench_UART_bytes - bytes;
+
+    bytes = Bench_UART_bytes;
+    start = Bench_ns();
+    traffic_view_t view = Traffic_live();
+    JSON_Export_to(Bench_JSON_count, &view);
+    Bench_stage_time(&stage[BENCH_STAGE_JSON], start);
+    stage[BENCH_STAGE_JSON].bytes += Bench_UART_bytes - bytes;
+
+    start = Bench_ns();
+    Traffic_publish(true);
+    Bench_stage_time(&stage[BENCH_STAGE_PUBLISH], start);
+
+    ClearExpired();
+  }
+
+  for (int k = 0; k < BENCH_STAGES; k++) {
+    total += stage[k].total;
+  }
+
+  char name[24];
+  snprintf(name, sizeof(name), "traffic/%lu", aircraft);
+  Bench_report(name, aircraft * seconds, total);
+  printf("%-16s %10lu s simulated, %.0f packets/s through encode and ParseData\n",
+         "", seconds, aircraft * seconds /
+         ((stage[BENCH_STAGE_ENCODE].total + stage[BENCH_STAGE_PARSE].total) / 1e9));
+  printf("%-16s %10lu decoded, %lu undecoded, %lu updates, %lu admitted, %lu evicted, %lu dropped\n",
+         "", decoded, undecoded, updates, admitted, evicted, dropped);
+  printf("%-16s %10.2f mean table occupancy, %lu max, of %d slots\n",
+         "", (double) occupancy / seconds, occupancy_max, MAX_TRACKING_OBJECTS);
+
+  for (int k = 0; k < BENCH_STAGES; k++) {
+    Bench_stage_t *st = &stage[k];
+
+    qsort(st->ns, st->count, sizeof(uint32_t), Bench_cmp_ns);
+    printf("%-16s %10lu calls p50 %7u p90 %7u p99 %7u max %8u ns",
+           Bench_stage_name[k], st->count,
+           st->ns[st->count * 50 / 100], st->ns[st->count * 90 / 100],
+           st->ns[st->count * 99 / 100], st->ns[st->count - 1]);
+    if (k >= BENCH_STAGE_NMEA && k <= BENCH_STAGE_JSON) {
+      printf(" %8.0f bytes/s", (double) st->bytes / seconds);
+    }
+    printf("\n");
+    free(st->ns);
+  }
+
+  free(fleet);
+
+  memset(Container, 0, sizeof(ufo_t) * MAX_TRACKING_OBJECTS);
+  *settings = saved;
+  hasValidGPSDFix = fix;
+  protocol_decode = NULL;
+  SoC = soc;
+}
+
+/*
+ * Codec microbenchmarks over the golden corpora. Each case does one
+ * operation per call on corpus entry n. With Bench_check set, a case
+ * also compares its result with the golden one and returns false on a
+ * mismatch. Decoders work on a copy of the frame because some of them
+ * decrypt in place; the copy is part of the cost measured.
+ */
+
+typedef struct Bench_case_struct {
+  const char    *name;
+  bool          (*op)(unsigned int);
+} Bench_case_t;
+
+typedef struct Bench_frame_struct {
+  byte          data[LONG_FRAME_DATA_BYTES];
+  size_t        size;
+} Bench_frame_t;
+
+static bool          Bench_check;
+static ufo_t         Bench_ufo   [CORPUS_STATES];
+static Bench_frame_t Bench_legacy[CORPUS_STATES];
+static Bench_frame_t Bench_ogntp [CORPUS_STATES];
+static Bench_frame_t Bench_fanet [CORPUS_STATES];
+static Bench_frame_t Bench_p3i   [CORPUS_STATES];
+static Bench_frame_t Bench_adsb  [CORPUS_STATES];
+static Bench_frame_t Bench_uat978[CORPUS_STATES];
+
+static byte          Bench_pkt[MAX_PKT_SIZE > LONG_FRAME_DATA_BYTES ?
+                               MAX_PKT_SIZE : LONG_FRAME_DATA_BYTES];
+static ufo_t         Bench_rx;
+static GPS_Position  Bench_pos;
+static OGN_TxPacket  Bench_ogn;
+static struct uat_adsb_mdb Bench_mdb;
+
+static void Bench_corpus_load(Bench_frame_t *frames, const char **hex)
+{
+  for (size_t i = 0; i < CORPUS_STATES; i++) {
+    size_t len = strlen(hex[i]) / 2;
+
+    frames[i].size = len > sizeof(frames[i].data) ? sizeof(frames[i].data) : len;
+    for (size_t j = 0; j < frames[i].size; j++) {
+      unsigned int b;
+
+      sscanf(hex[i] + 2 * j, "%2x", &b);
+      frames[i].data[j] = (byte) b;
+    }
+  }
+}
+
+static void Bench_corpus_setup()
+{
+  setTime(CORPUS_EPOCH);
+
+  memset(&ThisAircraft, 0, sizeof(ThisAircraft));
+  ThisAircraft.addr      = CORPUS_ADDR;
+  ThisAircraft.latitude  = CORPUS_LAT;
+  ThisAircraft.longitude = CORPUS_LON;
+  ThisAircraft.altitude  = CORPUS_ALT;
+  ThisAircraft.timestamp = CORPUS_EPOCH;
+
+  for (size_t i = 0; i < CORPUS_STATES; i++) {
+    const Corpus_state_t *s = &Corpus_state[i];
+    ufo_t *fop = &Bench_ufo[i];
+
+    memset(fop, 0, sizeof(ufo_t));
+    fop->addr          = s->addr;
+    fop->addr_type     = ADDR_TYPE_FLARM;
+    fop->timestamp     = CORPUS_EPOCH;
+    fop->latitude      = s->latitude;
+    fop->longitude     = s->longitude;
+    fop->altitude      = s->altitude;
+    fop->course        = s->course;
+    fop->speed         = s->speed;
+    fop->vs            = s->vs;
+    fop->aircraft_type = s->aircraft_type;
+  }
+
+  Bench_corpus_load(Bench_legacy, Corpus_legacy);
+  Bench_corpus_load(Bench_ogntp,  Corpus_ogntp);
+  Bench_corpus_load(Bench_fanet,  Corpus_fanet);
+  Bench_corpus_load(Bench_p3i,    Corpus_p3i);
+  Bench_corpus_load(Bench_adsb,   Corpus_adsb);
+  Bench_corpus_load(Bench_uat978, Corpus_uat978);
+}
+
+static bool Bench_golden(const Bench_frame_t *golden, const void *buf, size_t size)
+{
+  return !Bench_check || (size == golden->size && !memcmp(buf, golden->data, size));
+}
+
+static bool Bench_decoded_as(bool ok, unsigned int n)
+{
+  return !Bench_check || (ok && Bench_rx.addr == Bench_ufo[n].addr);
+}
+
+static bool Bench_legacy_encode(unsigned int n)
+{
+  size_t size = legacy_encode(Bench_pkt, &Bench_ufo[n]);
+  return Bench_golden(&Bench_legacy[n], Bench_pkt, size);
+}
+
+static bool Bench_legacy_decode(unsigned int n)
+{
+  memcpy(Bench_pkt, Bench_legacy[n].data, Bench_legacy[n].size);
+  return Bench_decoded_as(legacy_decode(Bench_pkt, &ThisAircraft, &Bench_rx), n);
+}
+
+static bool Bench_ogntp_encode(unsigned int n)
+{
+  size_t size = ogntp_encode(Bench_pkt, &Bench_ufo[n]);
+  return Bench_golden(&Bench_ogntp[n], Bench_pkt, size);
+}
+
+static bool Bench_ogntp_decode(unsigned int n)
+{
+  memcpy(Bench_pkt, Bench_ogntp[n].data, Bench_ogntp[n].size);
+  return Bench_decoded_as(ogntp_decode(Bench_pkt, &ThisAircraft, &Bench_rx), n);
+}
+
+/* The three stages of ogntp_encode() on their own */
+static bool Bench_ogn_pos_encode(unsigned int n)
+{
+  Bench_pos.Latitude  = (int32_t) (Bench_ufo[n].latitude  * 600000);
+  Bench_pos.Longitude = (int32_t) (Bench_ufo[n].longitude * 600000);
+  Bench_pos.Altitude  = (int32_t) (Bench_ufo[n].altitude  * 10);
+  Bench_pos.Heading   = (int16_t) (Bench_ufo[n].course    * 10);
+  Bench_pos.Encode(Bench_ogn.Packet);
+  return true;
+}
+
+static bool Bench_ogn_whiten(unsigned int n)
+{
+  Bench_ogn.Packet.Whiten();
+  return true;
+}
+
+static bool Bench_ogn_calcFEC(unsigned int n)
+{
+  Bench_ogn.calcFEC();
+  return true;
+}
+
+static bool Bench_fanet_encode(unsigned int n)
+{
+  size_t size = fanet_encode(Bench_pkt, &Bench_ufo[n]);
+  return Bench_golden(&Bench_fanet[n], Bench_pkt, size);
+}
+
+static bool Bench_fanet_decode(unsigned int n)
+{
+  bool ok;
+
+  memcpy(Bench_pkt, Bench_fanet[n].data, Bench_fanet[n].size);
+  ok = fanet_decode(Bench_pkt, &ThisAircraft, &Bench_rx);
+  /* FANET carries the lower 16 bits of the address under a vendor id */
+  return !Bench_check ||
+         (ok && Bench_rx.addr == ((SOFRF_FANET_VENDOR_ID << 16) |
+                                  (Bench_ufo[n].addr & 0xFFFF)));
+}
+
+static bool Bench_p3i_encode(unsigned int n)
+{
+  size_t size = p3i_encode(Bench_pkt, &Bench_ufo[n]);
+  return Bench_golden(&Bench_p3i[n], Bench_pkt, size);
+}
+
+static bool Bench_p3i_decode(unsigned int n)
+{
+  memcpy(Bench_pkt, Bench_p3i[n].data, Bench_p3i[n].size);
+  return Bench_decoded_as(p3i_decode(Bench_pkt, &ThisAircraft, &Bench_rx), n);
+}
+
+static bool Bench_uat978_decode(unsigned int n)
+{
+  memset(Bench_pkt, 0, LONG_FRAME_DATA_BYTES);
+  memcpy(Bench_pkt, Bench_uat978[n].data, Bench_uat978[n].size);
+  return Bench_decoded_as(uat978_decode(Bench_pkt, &ThisAircraft, &Bench_rx), n);
+}
+
+static bool Bench_uat_decode_adsb_mdb(unsigned int n)
+{
+  uat_decode_adsb_mdb(Bench_uat978[n].data, &Bench_mdb);
+  return !Bench_check || Bench_mdb.address == Bench_ufo[n].addr;
+}
+
+static bool Bench_adsb_air_position(unsigned int n)
+{
+  const ufo_t *fop = &Bench_ufo[n];
+  frame_data_t df17 = make_air_position_frame(11, fop->addr, fop->latitude,
+                        fop->longitude, fop->altitude * _GPS_FEET_PER_METER,
+                        CPR_EVEN, DF17);
+  return Bench_golden(&Bench_adsb[n], df17.msg, sizeof(df17.msg));
+}
+
+static bool Bench_adsb_surface_position(unsigned int n)
+{
+  const ufo_t *fop = &Bench_ufo[n];
+  frame_data_t df17 = make_surface_position_frame(7, fop->addr, fop->latitude,
+                        fop->longitude, (unsigned int) fop->speed, true,
+                        fop->course, n & 1, DF17);
+  return df17.msg[0] != 0;
+}
+
+static bool Bench_adsb_velocity(unsigned int n)
+{
+  const ufo_t *fop = &Bench_ufo[n];
+  double rad = fop->course * M_PI / 180;
+  frame_data_t df17 = make_velocity_frame(fop->addr, fop->speed * cos(rad),
+                        fop->speed * sin(rad), fop->vs, DF17);
+  return df17.msg[0] != 0;
+}
+
+static bool Bench_adsb_identification(unsigned int n)
+{
+  unsigned char callsign[8] = { 'S', 'R', 'F', '0', '0', '0', '0', 0 };
+
+  callsign[6] += n;
+  frame_data_t df17 = make_aircraft_identification_frame(Bench_ufo[n].addr,
+                        callsign, Category_Set_D, 1, DF17);
+  return df17.msg[0] != 0;
+}
+
+static const Bench_case_t Bench_cases[] = {
+  { "legacy_encode",       Bench_legacy_encode        },
+  { "legacy_decode",       Bench_legacy_decode        },
+  { "ogntp_encode",        Bench_ogntp_encode         },
+  { "ogntp_decode",        Bench_ogntp_decode         },
+  { "ogn_pos_encode",      Bench_ogn_pos_encode       },
+  { "ogn_whiten",          Bench_ogn_whiten           },
+  { "ogn_calcFEC",         Bench_ogn_calcFEC          },
+  { "fanet_encode",        Bench_fanet_encode         },
+  { "fanet_decode",        Bench_fanet_decode         },
+  { "p3i_encode",          Bench_p3i_encode           },
+  { "p3i_decode",          Bench_p3i_decode           },
+  { "uat978_decode",       Bench_uat978_decode        },
+  { "uat_decode_mdb",      Bench_uat_decode_adsb_mdb  },
+  { "adsb_position",       Bench_adsb_air_position    },
+  { "adsb_surface",        Bench_adsb_surface_position},
+  { "adsb_velocity",       Bench_adsb_velocity        },
+  { "adsb_ident",          Bench_adsb_identification  },
+};
+
+#define BENCH_CASES (sizeof(Bench_cases) / sizeof(Bench_cases[0]))
+
+void Bench_Codec(unsigned long iterations)
+{
+  Bench_corpus_setup();
+
+  for (size_t c = 0; c < BENCH_CASES; c++) {
+    const Bench_case_t *bc = &Bench_cases[c];
+    unsigned long mismatches = 0;
+    Bench_perf_t perf;
+    uint64_t start, ns;
+
+    /* one pass over the corpus against the golden results */
+    setTime(CORPUS_EPOCH);  /* OGNTP sends the second of the minute */
+    Bench_check = true;
+    for (unsigned int n = 0; n < CORPUS_STATES; n++) {
+      if (!bc->op(n)) {
+        mismatches++;
+      }
+    }
+    Bench_check = false;
+
+    for (unsigned long i = 0; i < iterations / BENCH_CODEC_WARMUP; i++) {
+      bc->op(i % CORPUS_STATES);
+    }
+
+    Bench_perf_start();
+    start = Bench_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+      bc->op(i % CORPUS_STATES);
+    }
+    ns = Bench_ns() - start;
+    Bench_perf_stop(&perf);
+
+    Bench_result(bc->name, iterations, ns, &perf, mismatches);
+  }
+}
+
+/*
+ * The gpsd client against a scripted gpsd on a loopback port. The client
+ * has to subscribe, take its fix from a session of reports (one of them
+ * split across two writes, one without a fix) and notice the server
+ * going away. In between, a stream of TPV reports is timed. A failed
+ * check fails the run.
+ */
+
+static const char *Bench_gpsd_session[] = {
+  "{\"class\":\"VERSION\",\"release\":\"3.22\",\"rev\":\"3.22\","
+    "\"proto_major\":3,\"proto_minor\":14}\n",
+  "{\"class\":\"DEVICES\",\"devices\":[{\"class\":\"DEVICE\","
+    "\"path\":\"/dev/ttyAMA0\",\"driver\":\"u-blox\"}]}\n",
+  "{\"class\":\"TPV\",\"device\":\"/dev/ttyAMA0\",\"mode\":1}\n",
+  "{\"class\":\"SKY\",\"device\":\"/dev/ttyAMA0\",\"hdop\":0.87,"
+    "\"satellites\":[{\"PRN\":5,\"el\":40,\"az\":80,\"ss\":42,\"used\":true}]}\n",
+  "{\"class\":\"TPV\",\"device\":\"/dev/ttyAMA0\",\"mode\":3,"
+    "\"time\":\"2023-11-14T22:13:20.250Z\",",
+  "\"lat\":55.751244,\"lon\":-37.618423,\"altHAE\":210.5,\"altMSL\":195.0,"
+    "\"geoidSep\":15.5,\"track\":270.0,\"speed\":25.72}\n",
+  "{\"class\":\"PPS\",\"device\":\"/dev/ttyAMA0\",\"real_sec\":1700000001,"
+    "\"real_nsec\":0,\"clock_sec\":1700000001,\"clock_nsec\":120}\n",
+};
+
+#define BENCH_GPSD_SESSION  (sizeof(Bench_gpsd_session) / sizeof(Bench_gpsd_session[0]))
+#define BENCH_GPSD_BATCH    100   /* TPV reports per write, well within the socket buffers */
+
+static unsigned long Bench_failures;
+
+static void Bench_expect(const char *what, bool ok)
+{
+  if (!ok) {
+    printf("%-16s %10s %s\n", "", "FAIL", what);
+    Bench_failures++;
+  }
+}
+
+static bool Bench_send(int fd, const char *buf, size_t size)
+{
+  return send(fd, buf, size, MSG_NOSIGNAL) == (ssize_t) size;
+}
+
+/* Runs the client until *count reaches until, for up to a second */
+static uint64_t Bench_gpsd_run(const uint32_t *count, uint32_t until)
+{
+  uint64_t start = Bench_ns();
+
+  while (*count < until && Bench_ns() - start < 1000000000ULL) {
+    GPSD_loop();
+  }
+
+  return Bench_ns() - start;
+}
+
+void Bench_GPSD(unsigned long reports)
+{
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  char endpoint[32], watch[128];
+  unsigned long failures = Bench_failures;
+  uint64_t ns = 0;
+  int server, client = -1;
+  ssize_t n;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port        = 0;
+
+  server = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (server < 0 ||
+      bind(server, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+      listen(server, 1) < 0 ||
+      getsockname(server, (struct sockaddr *) &addr, &addr_len) < 0) {
+    perror("gpsd bench");
+    Bench_failures++;
+    if (server >= 0) {
+      close(server);
+    }
+    return;
+  }
+  snprintf(endpoint, sizeof(endpoint), "127.0.0.1:%u", ntohs(addr.sin_port));
+
+  memset(&GPSD_stats, 0, sizeof(GPSD_stats));
+  hasValidGPSDFix = false;
+  ThisAircraft.latitude = ThisAircraft.longitude = 0;
+
+  GPSD_setup();
+  Bench_expect("endpoint accepted", GPSD_configure(endpoint));
+
+  /* subscription */
+  Bench_gpsd_run(&GPSD_stats.connects, 1);
+  Bench_expect("connected", GPSD_stats.connects == 1 && !GPSD_connecting());
+  if (GPSD_stats.connects == 1) {
+    client = accept(server, NULL, NULL);
+  }
+  if (client < 0) {
+    Bench_expect("accepted", false);
+    goto done;
+  }
+  n = recv(client, watch, sizeof(watch) - 1, 0);
+  watch[n > 0 ? n : 0] = 0;
+  Bench_expect("?WATCH sent", !strcmp(watch, GPSD_WATCH));
+
+  /* a session, sent one write at a time */
+  for (size_t i = 0; i < BENCH_GPSD_SESSION; i++) {
+    Bench_send(client, Bench_gpsd_session[i], strlen(Bench_gpsd_session[i]));
+    GPSD_loop();
+  }
+  Bench_gpsd_run(&GPSD_stats.pps, 1);
+
+  Bench_expect("TPV, SKY and PPS parsed",
+               GPSD_stats.tpv == 2 && GPSD_stats.sky == 1 && GPSD_stats.pps == 1);
+  Bench_expect("3D fix", isValidGPSDFix());
+  Bench_expect("position", fabs(ThisAircraft.latitude  - 55.751244) < 1e-5 &&
+                           fabs(ThisAircraft.longitude + 37.618423) < 1e-5);
+  Bench_expect("MSL altitude", fabs(ThisAircraft.altitude - 195.0) < 1e-3);
+  Bench_expect("geoid separation", fabs(ThisAircraft.geoid_separation - 15.5) < 1e-3);
+  Bench_expect("course and speed", fabs(ThisAircraft.course - 270.0) < 1e-3 &&
+                                   fabs(ThisAircraft.speed - 50.0) < 0.01);
+  Bench_expect("HDOP", ThisAircraft.hdop == 87);
+  Bench_expect("time of the fix", now() - 1700000001 <= 1);
+  Bench_expect("PPS edge", GPSD_pps.count == 1 && GPSD_pps.offset_ns == -120);
+
+  /* a stream of reports, a second of TPVs apart */
+  for (unsigned long sent = 0; sent < reports; ) {
+    static char batch[BENCH_GPSD_BATCH * 256];
+    size_t len = 0;
+    uint32_t until;
+
+    for (int i = 0; i < BENCH_GPSD_BATCH && sent < reports; i++, sent++) {
+      time_t t = 1700000002 + sent;
+      tmElements_t tm;
+
+      breakTime(t, tm);
+      len += snprintf(batch + len, sizeof(batch) - len,
+                      "{\"class\":\"TPV\",\"device\":\"/dev/ttyAMA0\",\"mode\":3,"
+                      "\"time\":\"%04d-%02d-%02dT%02d:%02d:%02d.000Z\","
+                      "\"lat\":%.6f,\"lon\":-37.618423,\"altMSL\":195.0,"
+                      "\"track\":270.0,\"speed\":25.72}\n",
+                      tmYearToCalendar(tm.Year), tm.Month, tm.Day,
+                      tm.Hour, tm.Minute, tm.Second,
+                      55.0 + (double) sent / reports);
+    }
+
+    until = GPSD_stats.tpv + (sent % BENCH_GPSD_BATCH ? sent % BENCH_GPSD_BATCH
+                                                       : BENCH_GPSD_BATCH);
+    if (!Bench_send(client, batch, len)) {
+      Bench_expect("stream sent", false);
+      break;
+    }
+    ns += Bench_gpsd_run(&GPSD_stats.tpv, until);
+  }
+
+  Bench_expect("stream parsed", GPSD_stats.tpv == 2 + reports);
+  Bench_expect("last position", reports == 0 ||
+               fabs(ThisAircraft.latitude - (55.0 + (double) (reports - 1) / reports)) < 1e-5);
+
+  /* gpsd goes away */
+  close(client);
+  for (uint64_t start = Bench_ns();
+       GPSD_fd() >= 0 && Bench_ns() - start < 1000000000ULL; ) {
+    GPSD_loop();
+  }
+  Bench_expect("connection lost", GPSD_fd() < 0);
+
+done:
+  GPSD_configure("OFF");
+  GPSD_fini();
+  close(server);
+  hasValidGPSDFix = false;
+  Time_reset();
+
+  if (reports > 0) {
+    Bench_report("GPSD TPV", reports, ns);
+  }
+  printf("%-16s %10s %lu of the checks failed\n", "",
+         Bench_failures == failures ? "ok" : "FAIL", Bench_failures - failures);
+}
+
+#if defined(USE_EPAPER) && defined(USE_EPD_CANVAS)
+/*
+ * The e-paper views, drawn into the in-memory panel one frame per call
+ * with none, one, half and all of the traffic slots in use. The traffic
+ * turns a degree around own ship every frame, so that the views have
+ * something new to draw. The time per frame includes the transfer to
+ * the panel; the hash of the last frame tells a change of the picture.
+ * A view leaves the panel alone when nothing it shows has changed, so
+ * the percentiles are of the frames that refreshed it.
+ */
+
+static const char *Bench_frames;
+
+static const struct {
+  const char    *name;
+  void          (*loop)();
+} Bench_view[] = {
+  { "status",  EPD_status_loop },
+  { "radar",   EPD_radar_loop  },
+  { "text",    EPD_text_loop   },
+  { "time",    EPD_time_loop   },
+};
+
+#define BENCH_VIEWS (sizeof(Bench_view) / sizeof(Bench_view[0]))
+
+/* A fix for isValidGNSSFix() to hold for a few more seconds */
+static void Bench_GNSS_fix()
+{
+  static const char fix[] =
+    "$GPGGA,120000.00,5600.000,N,03800.000,E,1,08,1.0,1000.0,M,14.0,M,,*5A\r\n"
+    "$GPRMC,120000.00,A,5600.000,N,03800.000,E,0.0,90.0,010121,,,A*6F\r\n";
+
+  for (const char *p = fix; *p; p++) {
+    gnss.encode(*p);
+  }
+}
+
+static void Bench_View_traffic(int aircraft, unsigned long frame)
+{
+  Bench_Traffic();
+
+  for (int i = 0; i < MAX_TRACKING_OBJECTS; i++) {
+    ufo_t *fop = &Container[i];
+
+    if (i >= aircraft) {
+      memset(fop, 0, sizeof(ufo_t));
+      continue;
+    }
+
+    /* all of them inside of the default radar range */
+    fop->distance = 300 + 1500 * (i + 1) / MAX_TRACKING_OBJECTS;
+    fop->bearing  = (40 * i + frame) % 360;
+  }
+
+  Traffic_publish(true);
+}
+
+void Bench_Views(unsigned long frames)
+{
+  static EPD_display_t canvas((EPD_Canvas()));
+  EPD_display_t *saved = display;
+  const int load[] = { 0, 1, MAX_TRACKING_OBJECTS / 2, MAX_TRACKING_OBJECTS };
+  uint32_t *ns;
+
+  if (frames == 0) {
+    return;
+  }
+
+  ns = (uint32_t *) calloc(frames, sizeof(uint32_t));
+
+  RPi_defaults();   /* the views take their settings from ui */
+
+  /* as EPD_setup() has it, less the splash screen */
+  display = &canvas;
+  display->init();
+  display->setRotation(1);
+  display->setTextColor(GxEPD_BLACK);
+  display->setTextWrap(false);
+  canvas.epd2.rotation = display->getRotation();
+
+  EPD_status_setup();
+  EPD_radar_setup();
+  EPD_text_setup();
+  EPD_time_setup();
+
+  for (size_t v = 0; v < BENCH_VIEWS; v++) {
+    for (size_t l = 0; l < sizeof(load) / sizeof(load[0]); l++) {
+      uint32_t refreshes = canvas.epd2.frames;
+      uint64_t pixels    = canvas.epd2.refreshed_pixels;
+      uint64_t total     = 0;
+      unsigned long drawn = 0;
+      char name[24];
+
+      EPD_vmode_updated = true;
+
+      for (unsigned long f = 0; f < frames; f++) {
+        uint32_t before = canvas.epd2.frames;
+        uint64_t start, elapsed;
+
+        Bench_GNSS_fix();
+        Bench_View_traffic(load[l], f);
+
+        start = Bench_ns();
+        Bench_view[v].loop();
+        if (EPD_ready_to_display) {
+          /* what EPD_Task() does */
+          display->display(true);
+          EPD_POWEROFF;
+          EPD_ready_to_display = false;
+        }
+        elapsed = Bench_ns() - start;
+        total  += elapsed;
+
+        if (canvas.epd2.frames != before) {
+          ns[drawn++] = elapsed;
+        }
+      }
+
+      refreshes = canvas.epd2.frames - refreshes;
+      pixels    = canvas.epd2.refreshed_pixels - pixels;
+
+      snprintf(name, sizeof(name), "%s/%d", Bench_view[v].name, load[l]);
+      Bench_report(name, frames, total);
+
+      if (drawn > 0) {
+        qsort(ns, drawn, sizeof(uint32_t), Bench_cmp_ns);
+        printf("%-16s %10lu drawing p50 %7u p90 %7u max %8u ns,",
+               "", drawn, ns[drawn * 50 / 100], ns[drawn * 90 / 100],
+               ns[drawn - 1]);
+      } else {
+        printf("%-16s %10s drawing,", "", "none");
+      }
+      printf(" %u refreshes %6.0f pixels each, hash %08x\n",
+             refreshes, refreshes ? (double) pixels / refreshes : 0.0,
+             canvas.epd2.hash());
+
+      if (Bench_frames) {
+        char path[PATH_MAX];
+
+        snprintf(path, sizeof(path), "%s/%s-%d.pbm",
+                 Bench_frames, Bench_view[v].name, load[l]);
+        if (!canvas.epd2.save(path, canvas.epd2.rotation)) {
+          perror(path);
+        }
+      }
+    }
+  }
+
+  free(ns);
+
+  memset(Container, 0, sizeof(ufo_t) * MAX_TRACKING_OBJECTS);
+  display = saved;
+}
+#endif /* USE_EPAPER && USE_EPD_CANVAS */
+
+typedef struct Bench_struct {
+  const char    *name;
+  void          (*run)(unsigned long);
+  unsigned long cycles;
+} Bench_t;
+
+static const Bench_t Bench_table[] = {
+  { "nmea",  Bench_NMEA,  BENCH_NMEA_CYCLES  },
+  { "d1090", Bench_D1090, BENCH_D1090_CYCLES },
+  { "json",  Bench_JSON,  BENCH_JSON_CYCLES  },
+  { "queue", Bench_Queue, BENCH_QUEUE_CYCLES },
+  { "clock", Bench_Clock, BENCH_CLOCK_CYCLES },
+  { "pps",   Bench_PPS,   BENCH_PPS_SECONDS  },
+  { "traffic", Bench_Scenario, BENCH_TRAFFIC_AIRCRAFT },
+  { "codec", Bench_Codec,  BENCH_CODEC_CYCLES },
+  { "gpsd",  Bench_GPSD,   BENCH_GPSD_REPORTS },
+#if defined(USE_EPAPER) && defined(USE_EPD_CANVAS)
+  { "views", Bench_Views,  BENCH_VIEWS_FRAMES },
+#endif /* USE_EPAPER && USE_EPD_CANVAS */
+};
+
+#define BENCH_COUNT (sizeof(Bench_table) / sizeof(Bench_table[0]))
+
+/* Length of the name part of a "name[:count]" argument */
+static size_t Bench_name_len(const char *arg)
+{
+  const char *colon = strchr(arg, ':');
+
+  return colon ? (size_t) (colon - arg) : strlen(arg);
+}
+
+static bool Bench_is(const char *arg, const Bench_t *bench)
+{
+  size_t len = Bench_name_len(arg);
+
+  return len == strlen(bench->name) && !strncmp(arg, bench->name, len);
+}
+
+/* Runs the benchmarks named, or all of them */
+int Bench_main(int argc, char *argv[])
+{
+  char **names = argv;
+  int  count = 0;
+
+  Bench_started = time(NULL);
+
+  for (int j = 0; j < argc; j++) {
+    size_t i;
+
+    if (!strncmp(argv[j], "--json=", 7)) {
+      Bench_json = fopen(argv[j] + 7, "a");
+      if (Bench_json == NULL) {
+        perror(argv[j] + 7);
+        return EXIT_FAILURE;
+      }
+      continue;
+    }
+    if (!strcmp(argv[j], "--perf")) {
+      Bench_perf_open();
+      continue;
+    }
+#if defined(USE_EPAPER) && defined(USE_EPD_CANVAS)
+    if (!strncmp(argv[j], "--frames=", 9)) {
+      Bench_frames = argv[j] + 9;
+      continue;
+    }
+#endif /* USE_EPAPER && USE_EPD_CANVAS */
+
+    for (i = 0; i < BENCH_COUNT && !Bench_is(argv[j], &Bench_table[i]); i++);
+    if (i == BENCH_COUNT) {
+      fprintf(stderr, "Unknown benchmark: %s\n", argv[j]);
+      return EXIT_FAILURE;
+    }
+    names[count++] = argv[j];
+  }
+
+  for (size_t i = 0; i < BENCH_COUNT; i++) {
+    unsigned long cycles = Bench_table[i].cycles;
+    bool selected = (count == 0);
+
+    for (int j = 0; j < count; j++) {
+      if (Bench_is(names[j], &Bench_table[i])) {
+        const char *arg = names[j] + Bench_name_len(names[j]);
+
+        if (*arg == ':') {
+          cycles = strtoul(arg + 1, NULL, 0);
+        }
+        selected = true;
+      }
+    }
+    if (selected) {
+      Bench_name = Bench_table[i].name;
+      Bench_table[i].run(cycles);
+    }
+  }
+
+  if (Bench_json) {
+    fclose(Bench_json);
+  }
+
+  return Bench_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif /* RASPBERRY_PI */
@@ -0,0 +1,61 @@
+/*
+ * BenchHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHHELPER_H
+#define BENCHHELPER_H
+
+#if defined(RASPBERRY_PI)
+
+#define BENCH_NMEA_CYCLES   200000
+#define BENCH_D1090_CYCLES  50000
+#define BENCH_JSON_CYCLES   50000
+#define BENCH_QUEUE_CYCLES  5000000
+#define BENCH_CLOCK_CYCLES  10000000
+#define BENCH_PPS_SECONDS   7200
+
+/* aircraft in the traffic scenario and how long it runs */
+#define BENCH_TRAFFIC_AIRCRAFT  100
+#define BENCH_TRAFFIC_SECONDS   300
+
+/* operations per codec case, a tenth as many again to warm up */
+#define BENCH_CODEC_CYCLES      1000000
+#define BENCH_CODEC_WARMUP      10
+
+/* TPV reports the gpsd client parses from a scripted server */
+#define BENCH_GPSD_REPORTS      100000
+
+/* frames per view and traffic load, in the host build */
+#define BENCH_VIEWS_FRAMES      1000
+
+int  Bench_main(int, char *[]);
+void Bench_NMEA(unsigned long);
+void Bench_D1090(unsigned long);
+void Bench_JSON(unsigned long);
+void Bench_Queue(unsigned long);
+void Bench_Clock(unsigned long);
+void Bench_PPS(unsigned long);
+void Bench_Scenario(unsigned long);
+void Bench_Codec(unsigned long);
+void Bench_GPSD(unsigned long);
+#if defined(USE_EPAPER) && defined(USE_EPD_CANVAS)
+void Bench_Views(unsigned long);
+#endif /* USE_EPAPER && USE_EPD_CANVAS */
+
+#endif /* RASPBERRY_PI */
+
+#endif /* BENCHHELPER_H */
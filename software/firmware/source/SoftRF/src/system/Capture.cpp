@@ -0,0 +1,402 @@
+/*
+ * CaptureHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <TimeLib.h>
+
+#include "Capture.h"
+#include "Time.h"
+#include "../driver/EEPROM.h"
+
+#if CAPTURE_IS_ENABLED
+
+#include <atomic>
+
+#define CAPTURE_MASK  (CAPTURE_RING_SIZE - 1)
+
+Capture_stats_t Capture_stats;
+
+/*
+ * Producers - the receive and the transmit paths - fill the ring at
+ * Capture_tail, the writer empties it at Capture_head. Indices run
+ * freely; only the writer moves the head and it takes the bytes out
+ * of the ring without the lock, as no producer touches them until then.
+ */
+static byte Capture_ring[CAPTURE_RING_SIZE];
+static uint32_t Capture_head = 0;
+static uint32_t Capture_tail = 0;
+static std::atomic<bool> Capture_active(false);   /* cleared by a failed write */
+
+static void Capture_header(Capture_header_t *hdr)
+{
+  memset(hdr, 0, sizeof(Capture_header_t));
+  hdr->magic     = CAPTURE_MAGIC;
+  hdr->version   = CAPTURE_VERSION;
+  hdr->size      = sizeof(Capture_header_t);
+  hdr->device_id = SoC->getChipId() & 0x00FFFFFF;
+}
+
+#if defined(RASPBERRY_PI)
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+static FILE *Capture_file = NULL;
+static pthread_t Capture_thread;
+static pthread_mutex_t Capture_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Capture_cond = PTHREAD_COND_INITIALIZER;
+static bool Capture_stop = false;
+
+/* frames come from the radio stage and from the traffic stage */
+static void Capture_lock()   { pthread_mutex_lock(&Capture_mutex); }
+static void Capture_unlock() { pthread_mutex_unlock(&Capture_mutex); }
+static void Capture_kick()   { pthread_cond_signal(&Capture_cond); }
+
+static bool Capture_write(const byte *buf, size_t size)
+{
+  return fwrite(buf, size, 1, Capture_file) == 1;
+}
+
+#else
+
+#include <FS.h>
+#include <SPIFFS.h>
+
+static File Capture_file;
+
+/* a single thread: Capture_loop() is the writer */
+static void Capture_lock()   {}
+static void Capture_unlock() {}
+static void Capture_kick()   {}
+
+static bool Capture_write(const byte *buf, size_t size)
+{
+  return Capture_file.write(buf, size) == size;
+}
+
+#endif /* RASPBERRY_PI */
+
+/* Write out what the ring holds: whole chunks only, unless all is set */
+static void Capture_drain(bool all)
+{
+  Capture_lock();
+  uint32_t head = Capture_head;
+  uint32_t fill = Capture_tail - head;
+  Capture_unlock();
+
+  while (fill >= CAPTURE_CHUNK || (all && fill > 0)) {
+    uint32_t offset = head & CAPTURE_MASK;
+    size_t size = fill < CAPTURE_CHUNK ? fill : CAPTURE_CHUNK;
+
+    if (size > CAPTURE_RING_SIZE - offset) {
+      size = CAPTURE_RING_SIZE - offset;
+    }
+
+    if (!Capture_write(&Capture_ring[offset], size)) {
+      Capture_active = false;     /* out of space: keep what is there */
+      return;
+    }
+    Capture_stats.writes++;
+    Capture_stats.bytes += size;
+
+    head += size;
+    fill -= size;
+
+    Capture_lock();
+    Capture_head = head;
+    Capture_unlock();
+  }
+}
+
+static void Capture_copy(uint32_t at, const void *src, size_t size)
+{
+  uint32_t offset = at & CAPTURE_MASK;
+  size_t first = size < CAPTURE_RING_SIZE - offset ? size : CAPTURE_RING_SIZE - offset;
+
+  memcpy(&Capture_ring[offset], src, first);
+  memcpy(&Capture_ring[0], (const byte *) src + first, size - first);
+}
+
+/* Called where the radio is driven from, for RF_frequency to be that of the frame */
+void Capture_frame(const byte *raw, size_t size, int8_t rssi, uint64_t utc, bool tx)
+{
+  Capture_record_t rec;
+
+  if (!Capture_active) {
+    return;
+  }
+
+  size = size > MAX_PKT_SIZE ? MAX_PKT_SIZE : size;
+
+  rec.time_us   = utc ? utc : (uint64_t) now() * 1000000;
+  rec.frequency = RF_frequency;
+  rec.protocol  = settings->rf_protocol;
+  rec.flags     = (tx ? CAPTURE_TX : 0) | (utc ? 0 : CAPTURE_COARSE);
+  rec.rssi      = tx ? 0 : rssi;
+  rec.size      = size;
+
+  Capture_lock();
+  if (CAPTURE_RING_SIZE - (Capture_tail - Capture_head) < sizeof(rec) + size) {
+    Capture_stats.dropped++;
+  } else {
+    Capture_copy(Capture_tail, &rec, sizeof(rec));
+    Capture_copy(Capture_tail + sizeof(rec), raw, size);
+    Capture_tail += sizeof(rec) + size;
+    Capture_stats.frames++;
+
+    if (Capture_tail - Capture_head >= CAPTURE_CHUNK) {
+      Capture_kick();
+    }
+  }
+  Capture_unlock();
+}
+
+#if defined(RASPBERRY_PI)
+
+/*
+ * Chunks as they fill up, and whatever is there once a second,
+ * until told to stop or until a write fails
+ */
+static void *Capture_task(void *arg)
+{
+  Capture_lock();
+  while (!Capture_stop && Capture_active) {
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += CAPTURE_FLUSH_INTERVAL / 1000;
+
+    while (!Capture_stop && Capture_tail - Capture_head < CAPTURE_CHUNK) {
+      if (pthread_cond_timedwait(&Capture_cond, &Capture_mutex, &deadline) == ETIMEDOUT) {
+        break;
+      }
+    }
+
+    Capture_unlock();
+    Capture_drain(true);
+    Capture_lock();
+  }
+  Capture_unlock();
+
+  return NULL;
+}
+
+bool Capture_setup(const char *path)
+{
+  Capture_header_t hdr;
+
+  if (path == NULL) {
+    return false;
+  }
+
+  Capture_file = fopen(path, "ab");
+  if (Capture_file == NULL) {
+    perror(path);
+    return false;
+  }
+  /* the ring already makes chunks; no second copy through stdio */
+  setvbuf(Capture_file, NULL, _IONBF, 0);
+
+  fseek(Capture_file, 0, SEEK_END);
+  if (ftell(Capture_file) == 0) {
+    Capture_header(&hdr);
+    Capture_write((byte *) &hdr, sizeof(hdr));
+  }
+
+  Capture_stop = false;
+  Capture_active = true;
+
+  if (pthread_create(&Capture_thread, NULL, Capture_task, NULL) != 0) {
+    perror("pthread_create");
+    Capture_active = false;
+    fclose(Capture_file);
+    Capture_file = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+void Capture_loop()
+{
+  /* the writer thread does it all */
+}
+
+void Capture_fini()
+{
+  if (Capture_file == NULL) {
+    return;
+  }
+
+  Capture_lock();
+  Capture_stop = true;
+  Capture_kick();
+  Capture_unlock();
+  pthread_join(Capture_thread, NULL);
+
+  if (Capture_active) {
+    Capture_drain(true);
+  }
+  Capture_active = false;
+  fclose(Capture_file);
+  Capture_file = NULL;
+
+  fprintf( stderr, "capture: %u frames, %u dropped, %llu bytes in %u writes\n",
+           Capture_stats.frames, Capture_stats.dropped,
+           (unsigned long long) Capture_stats.bytes, Capture_stats.writes );
+}
+
+/*
+ * Conversion into pcap, for Wireshark and friends:
+ *
+ *   ./SoftRF --pcap CAPTURE [PCAP]
+ *
+ * Link type is USER0; the data of each packet is the capture record
+ * less its time stamp - frequency (4 bytes), protocol, flags, RSSI and
+ * size - followed by the raw frame.
+ */
+#define PCAP_MAGIC        0xa1b2c3d4
+#define PCAP_LINKTYPE     147         /* LINKTYPE_USER0 */
+
+typedef struct pcap_header_struct {
+  uint32_t  magic;
+  uint16_t  version_major;
+  uint16_t  version_minor;
+  int32_t   thiszone;
+  uint32_t  sigfigs;
+  uint32_t  snaplen;
+  uint32_t  linktype;
+} pcap_header_t;
+
+typedef struct pcap_record_struct {
+  uint32_t  ts_sec;
+  uint32_t  ts_usec;
+  uint32_t  incl_len;
+  uint32_t  orig_len;
+} pcap_record_t;
+
+static int Capture_pcap_usage(const char *name)
+{
+  fprintf( stderr, "Usage: %s --pcap CAPTURE [PCAP]\n", name );
+  return EXIT_FAILURE;
+}
+
+int Capture_pcap_main(int argc, char *argv[])
+{
+  Capture_header_t hdr;
+  Capture_record_t rec;
+  byte raw[256];
+  FILE *in, *out = stdout;
+  unsigned long packets = 0;
+
+  if (argc < 1 || argc > 2) {
+    return Capture_pcap_usage("SoftRF");
+  }
+  if ((in = fopen(argv[0], "rb")) == NULL) {
+    perror(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (fread(&hdr, sizeof(hdr), 1, in) != 1 ||
+      hdr.magic != CAPTURE_MAGIC || hdr.version != CAPTURE_VERSION) {
+    fprintf( stderr, "%s: not a SoftRF capture\n", argv[0] );
+    return EXIT_FAILURE;
+  }
+  fseek(in, hdr.size, SEEK_SET);
+
+  if (argc > 1 && (out = fopen(argv[1], "wb")) == NULL) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  pcap_header_t ph = { PCAP_MAGIC, 2, 4, 0, 0,
+                       sizeof(rec) - sizeof(rec.time_us) + sizeof(raw),
+                       PCAP_LINKTYPE };
+  fwrite(&ph, sizeof(ph), 1, out);
+
+  while (fread(&rec, sizeof(rec), 1, in) == 1 &&
+         fread(raw, rec.size, 1, in) == (rec.size ? 1 : 0)) {
+    const size_t meta = sizeof(rec) - sizeof(rec.time_us);
+    pcap_record_t pr;
+
+    pr.ts_sec   = rec.time_us / 1000000;
+    pr.ts_usec  = rec.time_us % 1000000;
+    pr.incl_len = pr.orig_len = meta + rec.size;
+
+    fwrite(&pr, sizeof(pr), 1, out);
+    fwrite((byte *) &rec + sizeof(rec.time_us), meta, 1, out);
+    fwrite(raw, rec.size, 1, out);
+    packets++;
+  }
+
+  fclose(in);
+  if (fclose(out) != 0) {
+    perror(argc > 1 ? argv[1] : "stdout");
+    return EXIT_FAILURE;
+  }
+
+  fprintf( stderr, "%lu packets\n", packets );
+  return EXIT_SUCCESS;
+}
+
+#else
+
+bool Capture_setup(const char *path)
+{
+  Capture_header_t hdr;
+
+  if (!SPIFFS.begin()) {
+    return false;
+  }
+
+  Capture_file = SPIFFS.open(path, FILE_APPEND);
+  if (!Capture_file) {
+    return false;
+  }
+
+  if (Capture_file.size() == 0) {
+    Capture_header(&hdr);
+    Capture_write((byte *) &hdr, sizeof(hdr));
+  }
+  Capture_active = true;
+
+  return true;
+}
+
+/* Whole chunks only, to keep the number of flash writes down */
+void Capture_loop()
+{
+  if (Capture_active) {
+    Capture_drain(false);
+  }
+}
+
+void Capture_fini()
+{
+  if (Capture_active) {
+    Capture_drain(true);
+    Capture_active = false;
+  }
+  if (Capture_file) {
+    Capture_file.close();
+  }
+}
+
+#endif /* RASPBERRY_PI */
+
+#endif /* CAPTURE_IS_ENABLED */
@@ -0,0 +1,103 @@
+/*
+ * CaptureHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAPTUREHELPER_H
+#define CAPTUREHELPER_H
+
+#include "SoC.h"
+#include "../driver/RF.h"
+
+/*
+ * Binary capture of every frame received or sent: a file header, then
+ * one record per frame - Capture_record_t followed by size raw bytes,
+ * all little-endian. Frames are put into a RAM ring and written out in
+ * CAPTURE_CHUNK pieces, by a thread on the Raspberry Pi and from the
+ * main loop on ESP32 (SPIFFS).
+ */
+#if !defined(CAPTURE_IS_ENABLED)
+#if defined(RASPBERRY_PI)
+#define CAPTURE_IS_ENABLED      1         /* still needs --capture FILE */
+#else
+#define CAPTURE_IS_ENABLED      0         /* 1 on ESP32 with a SPIFFS partition */
+#endif /* RASPBERRY_PI */
+#endif /* CAPTURE_IS_ENABLED */
+
+#define CAPTURE_MAGIC           0x43465253 /* "SRFC" */
+#define CAPTURE_VERSION         1
+
+#define CAPTURE_TX              0x01      /* record flags */
+#define CAPTURE_COARSE          0x02      /* no UTC model, time is whole seconds */
+
+#if defined(RASPBERRY_PI)
+#define CAPTURE_RING_SIZE       (1UL << 20)
+#define CAPTURE_CHUNK           (64UL << 10)
+#else
+#define CAPTURE_RING_SIZE       (16UL << 10)
+#define CAPTURE_CHUNK           (4UL << 10)   /* a multiple of the flash page */
+#define CAPTURE_FILE            "/capture.srfc"
+#endif /* RASPBERRY_PI */
+
+#define CAPTURE_FLUSH_INTERVAL  1000      /* ms, for a part chunk */
+
+typedef struct Capture_header_struct {
+  uint32_t  magic;
+  uint16_t  version;
+  uint16_t  size;                         /* of this header */
+  uint32_t  device_id;
+  uint32_t  reserved;
+} __attribute__((packed)) Capture_header_t;
+
+typedef struct Capture_record_struct {
+  uint64_t  time_us;                      /* UTC */
+  uint32_t  frequency;                    /* Hz, of the plan channel in use */
+  uint8_t   protocol;
+  uint8_t   flags;
+  int8_t    rssi;                         /* dBm, 0 for a frame sent */
+  uint8_t   size;                         /* of the raw bytes that follow */
+} __attribute__((packed)) Capture_record_t;
+
+typedef struct Capture_stats_struct {
+  uint32_t  frames;
+  uint32_t  dropped;                      /* ring full */
+  uint32_t  writes;
+  uint64_t  bytes;
+} Capture_stats_t;
+
+#if CAPTURE_IS_ENABLED
+
+bool Capture_setup(const char *);
+void Capture_frame(const byte *, size_t, int8_t, uint64_t, bool);
+void Capture_loop(void);
+void Capture_fini(void);
+
+extern Capture_stats_t Capture_stats;
+
+#if defined(RASPBERRY_PI)
+int  Capture_pcap_main(int, char *[]);
+#endif /* RASPBERRY_PI */
+
+#else
+
+#define Capture_setup(path)                     {}
+#define Capture_frame(raw, size, rssi, utc, tx) {}
+#define Capture_loop()                          {}
+#define Capture_fini()                          {}
+
+#endif /* CAPTURE_IS_ENABLED */
+
+#endif /* CAPTUREHELPER_H */
@@ -0,0 +1,131 @@
+/*
+ * CorpusHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORPUSHELPER_H
+#define CORPUSHELPER_H
+
+/*
+ * Golden inputs for the codec benchmarks. Every radio protocol frame
+ * below is what its encoder makes of the aircraft with the same index,
+ * at CORPUS_EPOCH, with the receiver at CORPUS_LAT/CORPUS_LON.
+ * A change of any encoder output shows up as a mismatch in the results.
+ */
+
+#define CORPUS_EPOCH    1700000000
+#define CORPUS_LAT      56.0
+#define CORPUS_LON      38.0
+#define CORPUS_ALT      1000.0
+#define CORPUS_ADDR     0xABCDEF
+
+typedef struct Corpus_state_struct {
+  uint32_t  addr;
+  float     latitude;
+  float     longitude;
+  float     altitude;   /* m */
+  float     course;     /* deg */
+  float     speed;      /* kt */
+  float     vs;         /* ft/min */
+  uint8_t   aircraft_type;
+} Corpus_state_t;
+
+static const Corpus_state_t Corpus_state[] = {
+  { 0x3E0001, 56.0120, 38.0150,  1150,  45,  48,   300, AIRCRAFT_TYPE_GLIDER     },
+  { 0x3E0002, 55.9950, 37.9800,   600, 270,  80,   600, AIRCRAFT_TYPE_TOWPLANE   },
+  { 0xDD1234, 56.0500, 38.1000,  1500, 180, 110,  -500, AIRCRAFT_TYPE_POWERED    },
+  { 0x4B1A2C, 55.9800, 38.0300,   300,  90,  70,     0, AIRCRAFT_TYPE_HELICOPTER },
+  { 0x3E0005, 56.0030, 37.9950,  1800, 315,  20,   200, AIRCRAFT_TYPE_PARAGLIDER },
+  { 0x424242, 56.2000, 38.4000, 10000, 120, 450, -1000, AIRCRAFT_TYPE_JET        },
+  { 0x3E0007, 56.0010, 38.0010,   900,   0,   5,   100, AIRCRAFT_TYPE_BALLOON    },
+  { 0x3E0008, 55.9990, 38.0020,   150, 200,  30,     0, AIRCRAFT_TYPE_UAV        },
+};
+
+#define CORPUS_STATES   (sizeof(Corpus_state) / sizeof(Corpus_state[0]))
+
+static const char *Corpus_legacy[CORPUS_STATES] = {
+  "01003E20039AA34EC650A66630A4FC9E9280EA743C6695B4",
+  "02003E2012ADDF830FF9B8DB4F2D09F4412C07E8B699660F",
+  "3412DD20EDF167A8CDBFE90CADFD7CA1479E11019D523558",
+  "2C1A4B206991A6027AE312DABA4897F9B0A421BCF0913267",
+  "05003E203BF11E9998978E922FA55463DA4AAB1FED86FD15",
+  "4242422039A794ED03B7093601EA75826E9103E5EAB41683",
+  "07003E20FCE42D268BE98DB0CE6F67A911CBEA95F80B0090",
+  "08003E20126479E93AF0103F882B89B65D71723BBE8CE299"
+};
+
+static const char *Corpus_ogntp[CORPUS_STATES] = {
+  "01003E030176D733D2BEAE7BC2ED3E942C564BFB1FBD5D2AA9A3",
+  "02003E0340AD756F6B9B458B8342FEC5FB4ACE5AAF3E90D99F45",
+  "3412DD0BC9F46CB91282E03EBC625EF9AA1196CAD6D473D3A724",
+  "2C1A4B03A17CD4512F0FFA72080504106D90317F1C54AF233926",
+  "05003E0B280A7E253998CDF5A6F187B199C5AEA23AB153E27441",
+  "42424203E2379EBDCF69B43AA366322EAE4CF099D34BE440D1A2",
+  "07003E03CD99C7E4E18458E3456D1843DEC4200CFD348A359C07",
+  "08003E03EEEA77A3682C3659DA52B972AF1E58D1B45FD912306E"
+};
+
+static const char *Corpus_fanet[CORPUS_STATES] = {
+  "410701002FA94F5D081B7EC4A40F2000",
+  "41070200FEA24FFE011B58D2BB1EC000",
+  "4107341204B74FD6171BDCD5D1678000",
+  "41072C1A889D4F180B1B2CE1B4004000",
+  "41070500E8A54FB9041B08974A0AE000",
+  "41074242A2ED4F734E1B00D8FF4D5500",
+  "410707002DA54FD1051B84B313050000",
+  "4107080073A44FFF051B96F06F008E00"
+};
+
+static const char *Corpus_p3i[CORPUS_STATES] = {
+  "2401003E5C0F18424A0C60427E042D000000000030000110",
+  "2402003E85EB1742E1FA5F4258020E010000000050000222",
+  "243412DD6666184233336042DC05B400000000006E0008AC",
+  "242C1A4BB81E184285EB5F422C015A0000000000460003E4",
+  "2405003EE1FA17421203604208073B010000000014000744",
+  "244242429A991942CDCC60421027780000000000C2010998",
+  "2407003E0601184206016042840300000000000005000BEC",
+  "2408003E0C021842FAFE5F429600C800000000001E000D12"
+};
+
+/* DF17 airborne position, even CPR format, as D1090 sends it */
+static const char *Corpus_adsb[CORPUS_STATES] = {
+  "8E3E00015817F15762F82CE25A81",
+  "8E3E0002580F71547AF6878279D1",
+  "8EDD1234581DD15DDEFC2915C447",
+  "8E4B1A2C5809F151ECF8E0573CB9",
+  "8E3E000558234155D8F73B1AD706",
+  "8E42424258A98177790A3D776D03",
+  "8E3E00075813E15582F783D1FF36",
+  "8E3E00085807C1552AF78F794EF7"
+};
+
+/*
+ * UAT ADS-B payloads (without the Reed-Solomon parity) for the same
+ * aircraft: basic frames (type 0) for the even ones, long frames with
+ * the callsign (type 1) for the odd ones. Altitudes are geometric.
+ */
+static const char *Corpus_uat978[CORPUS_STATES] = {
+  "003E00014FA9583610D70BF8008C11806800",
+  "083E00024FA328360419077810062880A80ABB5DC000740800950200000730000000",
+  "00DD12344FB72E362FCB0ED811BC00A09800",
+  "084B1A2C4F9DB236164D05080004238018303B5DF20E8408009502000004C0000000",
+  "003E00054FA61236098F1158003E07804800",
+  "084242424FEDCC369D0554981388C3A118173B5E6219740800950200005450000000",
+  "003E00074FA558360BBF09F8001800803800",
+  "083E00084FA49E360C1D03C810760580185BFB5DC001640800950200000380000000"
+};
+
+#endif /* CORPUSHELPER_H */
@@ -0,0 +1,307 @@
+/*
+ * CoverageHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Coverage.h"
+#include "Time.h"
+#include "../driver/EEPROM.h"
+#include "../driver/GNSS.h"
+
+#if !defined(EXCLUDE_COVERAGE)
+
+Coverage_t Coverage;
+
+/* 0 stands for "any further" */
+const uint32_t Coverage_ring_m[COVERAGE_RINGS] = {
+  1000, 2000, 5000, 10000, 20000, 50000, 100000, 0
+};
+
+static uint64_t Coverage_saved_ms = 0;
+static bool Coverage_dirty = false;
+
+void Coverage_reset()
+{
+  memset(&Coverage, 0, sizeof(Coverage));
+  Coverage.magic   = COVERAGE_MAGIC;
+  Coverage.version = COVERAGE_VERSION;
+  Coverage.size    = sizeof(Coverage);
+}
+
+#if defined(RASPBERRY_PI)
+
+#include <pthread.h>
+#include <stdio.h>
+
+static pthread_mutex_t Coverage_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* packets come from the traffic stage, saves and reports from the main loop */
+static void Coverage_lock()   { pthread_mutex_lock(&Coverage_mutex); }
+static void Coverage_unlock() { pthread_mutex_unlock(&Coverage_mutex); }
+
+static void Coverage_load()
+{
+  FILE *f = fopen(COVERAGE_FILE, "rb");
+  Coverage_t saved;
+
+  if (f == NULL) {
+    return;
+  }
+
+  if (fread(&saved, sizeof(saved), 1, f) == 1 &&
+      saved.magic   == COVERAGE_MAGIC   &&
+      saved.version == COVERAGE_VERSION &&
+      saved.size    == sizeof(saved)) {
+    Coverage = saved;
+  } else {
+    fprintf(stderr, "%s: not a coverage map of this build, ignored\n", COVERAGE_FILE);
+  }
+
+  fclose(f);
+}
+
+/*
+ * Written aside then renamed, so that a crash never leaves a torn file.
+ * A copy is written, so that packets are not held up by the disk.
+ */
+static void Coverage_save()
+{
+  static Coverage_t copy;
+  const char *tmp = COVERAGE_FILE ".tmp";
+  FILE *f = fopen(tmp, "wb");
+
+  if (f == NULL) {
+    return;
+  }
+
+  Coverage_lock();
+  copy = Coverage;
+  Coverage_unlock();
+
+  bool ok = fwrite(&copy, sizeof(copy), 1, f) == 1;
+
+  if (fclose(f) == 0 && ok) {
+    rename(tmp, COVERAGE_FILE);
+  } else {
+    remove(tmp);
+  }
+}
+
+#else
+
+/* Kept in RAM only, and added to from the one thread there is */
+static void Coverage_lock()   {}
+static void Coverage_unlock() {}
+static void Coverage_load()   {}
+static void Coverage_save()   {}
+
+#endif /* RASPBERRY_PI */
+
+void Coverage_setup()
+{
+  Coverage_reset();
+  Coverage_load();
+  Coverage_saved_ms = Time_ms();
+}
+
+/* O(1): one cell, found by division for the bearing and a short walk for the range */
+void Coverage_add(ufo_t *fop)
+{
+#if !defined(RASPBERRY_PI)
+  /* a coverage map only makes sense for a station that stays put */
+  if (settings->mode != SOFTRF_MODE_RECEIVER) {
+    return;
+  }
+#endif /* RASPBERRY_PI */
+
+  /* distance and bearing are from nowhere until we know where we are */
+  if (!isValidFix()) {
+    return;
+  }
+
+  uint32_t range = (uint32_t) fop->distance;
+  int sector = (int) (fop->bearing * COVERAGE_SECTORS / 360.0);
+  int bucket = (fop->rssi - RF_RSSI_FLOOR) / RF_RSSI_STEP;
+  uint8_t ring = 0;
+
+  if (sector < 0 || sector >= COVERAGE_SECTORS) {
+    sector = 0;
+  }
+  while (ring < COVERAGE_RINGS - 1 && range >= Coverage_ring_m[ring]) {
+    ring++;
+  }
+
+  Coverage_lock();
+
+  Coverage_sector_t *s = &Coverage.sector[sector];
+  Coverage_cell_t *cell = &s->cell[ring];
+  uint16_t *slot = &cell->rssi[constrain(bucket, 0, RF_RSSI_BUCKETS - 1)];
+
+  cell->count++;
+  if (*slot < UINT16_MAX) {
+    (*slot)++;
+  }
+  if (range > s->max_range) {
+    s->max_range = range;
+  }
+
+  if (Coverage.packets++ == 0) {
+    Coverage.since = now();
+  }
+  Coverage_dirty = true;
+
+  Coverage_unlock();
+}
+
+/* Clears the dirty mark, telling whether it was set */
+static bool Coverage_clean()
+{
+  bool dirty;
+
+  Coverage_lock();
+  dirty = Coverage_dirty;
+  Coverage_dirty = false;
+  Coverage_unlock();
+
+  return dirty;
+}
+
+void Coverage_loop()
+{
+  if (Time_since(Coverage_saved_ms) > COVERAGE_SAVE_INTERVAL * 1000UL) {
+    if (Coverage_clean()) {
+      Coverage_save();
+    }
+    Coverage_saved_ms = Time_ms();
+  }
+}
+
+void Coverage_fini()
+{
+  if (Coverage_clean()) {
+    Coverage_save();
+  }
+}
+
+/* Lower edge in dBm of the RSSI bucket the given percentile falls into */
+int Coverage_percentile(Coverage_cell_t *cell, uint8_t pct)
+{
+  uint32_t total = 0;
+  uint32_t seen = 0;
+  uint32_t rank;
+  uint8_t b;
+
+  for (b = 0; b < RF_RSSI_BUCKETS; b++) {
+    total += cell->rssi[b];
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  rank = (total * pct + 99) / 100;
+  for (b = 0; b < RF_RSSI_BUCKETS - 1; b++) {
+    seen += cell->rssi[b];
+    if (seen >= rank) {
+      break;
+    }
+  }
+
+  return RF_RSSI_FLOOR + b * RF_RSSI_STEP;
+}
+
+static size_t Coverage_JSON_locked(char *buf, size_t size)
+{
+  static const uint8_t pct[] = { 10, 50, 90 };
+  size_t len = 0;
+  int n;
+
+#define COVERAGE_PUT(...)                                           \
+  do {                                                              \
+    n = snprintf(buf + len, size - len, __VA_ARGS__);               \
+    if (n < 0 || (size_t) n >= size - len) { buf[0] = 0; return 0; } \
+    len += n;                                                       \
+  } while (0)
+
+  if (size == 0) {
+    return 0;
+  }
+
+  COVERAGE_PUT("{\"since\":%lu,\"packets\":%lu,\"sector\":%d,\"rings\":[",
+               (unsigned long) Coverage.since, (unsigned long) Coverage.packets,
+               360 / COVERAGE_SECTORS);
+  for (uint8_t r = 0; r < COVERAGE_RINGS; r++) {
+    COVERAGE_PUT("%s%lu", r ? "," : "", (unsigned long) Coverage_ring_m[r]);
+  }
+
+  COVERAGE_PUT("],\"max_range\":[");
+  for (uint8_t s = 0; s < COVERAGE_SECTORS; s++) {
+    COVERAGE_PUT("%s%lu", s ? "," : "", (unsigned long) Coverage.sector[s].max_range);
+  }
+
+  COVERAGE_PUT("],\"count\":[");
+  for (uint8_t s = 0; s < COVERAGE_SECTORS; s++) {
+    COVERAGE_PUT("%s[", s ? "," : "");
+    for (uint8_t r = 0; r < COVERAGE_RINGS; r++) {
+      COVERAGE_PUT("%s%lu", r ? "," : "",
+                   (unsigned long) Coverage.sector[s].cell[r].count);
+    }
+    COVERAGE_PUT("]");
+  }
+  COVERAGE_PUT("]");
+
+  for (uint8_t p = 0; p < sizeof(pct); p++) {
+    COVERAGE_PUT(",\"p%u\":[", pct[p]);
+    for (uint8_t s = 0; s < COVERAGE_SECTORS; s++) {
+      COVERAGE_PUT("%s[", s ? "," : "");
+      for (uint8_t r = 0; r < COVERAGE_RINGS; r++) {
+        Coverage_cell_t *cell = &Coverage.sector[s].cell[r];
+
+        if (cell->count) {
+          COVERAGE_PUT("%s%d", r ? "," : "", Coverage_percentile(cell, pct[p]));
+        } else {
+          COVERAGE_PUT("%snull", r ? "," : "");
+        }
+      }
+      COVERAGE_PUT("]");
+    }
+    COVERAGE_PUT("]");
+  }
+
+  COVERAGE_PUT("}");
+
+#undef COVERAGE_PUT
+
+  return len;
+}
+
+/*
+ * {"since":..,"packets":..,"sector":10,"rings":[1000,...,0],
+ *  "max_range":[..],"count":[[..],..],"p10":[[..],..],"p50":..,"p90":..}
+ * with one row per sector, one column per ring; NUL terminated,
+ * returns the length or 0
+ */
+size_t Coverage_JSON(char *buf, size_t size)
+{
+  size_t len;
+
+  Coverage_lock();
+  len = Coverage_JSON_locked(buf, size);
+  Coverage_unlock();
+
+  return len;
+}
+
+#endif /* EXCLUDE_COVERAGE */
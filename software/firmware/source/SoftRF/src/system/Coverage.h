@@ -0,0 +1,84 @@
+/*
+ * CoverageHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COVERAGEHELPER_H
+#define COVERAGEHELPER_H
+
+#include "SoC.h"
+#include "../driver/RF.h"
+
+/*
+ * Receiver coverage: a polar grid around the station of
+ * COVERAGE_SECTORS bearing sectors by COVERAGE_RINGS range rings,
+ * each cell with a packet count and an RSSI histogram.
+ */
+#define COVERAGE_SECTORS        36        /* of 10 degrees */
+#define COVERAGE_RINGS          8         /* outer edges in Coverage_ring_m[] */
+
+#define COVERAGE_MAGIC          0x564F4353 /* "SCOV" */
+#define COVERAGE_VERSION        1
+
+#define COVERAGE_SAVE_INTERVAL  600       /* seconds */
+#define COVERAGE_JSON_SIZE      8192
+
+#if !defined(COVERAGE_FILE)
+#define COVERAGE_FILE           "/var/tmp/SoftRF-coverage.dat"
+#endif
+
+typedef struct Coverage_cell_struct {
+  uint32_t  count;
+  uint16_t  rssi[RF_RSSI_BUCKETS];        /* saturate at 65535 */
+} Coverage_cell_t;
+
+typedef struct Coverage_sector_struct {
+  uint32_t        max_range;              /* m */
+  Coverage_cell_t cell[COVERAGE_RINGS];
+} Coverage_sector_t;
+
+typedef struct Coverage_struct {
+  uint32_t          magic;
+  uint16_t          version;
+  uint16_t          size;                 /* of the whole, as a layout check */
+  uint32_t          since;                /* UTC of the first packet */
+  uint32_t          packets;
+  Coverage_sector_t sector[COVERAGE_SECTORS];
+} Coverage_t;
+
+#if defined(EXCLUDE_COVERAGE)
+
+#define Coverage_setup()    {}
+#define Coverage_add(fop)   {}
+#define Coverage_loop()     {}
+#define Coverage_fini()     {}
+
+#else
+
+void   Coverage_setup(void);
+void   Coverage_add(ufo_t *);
+void   Coverage_loop(void);
+void   Coverage_fini(void);
+void   Coverage_reset(void);
+int    Coverage_percentile(Coverage_cell_t *, uint8_t);
+size_t Coverage_JSON(char *, size_t);
+
+extern Coverage_t Coverage;
+extern const uint32_t Coverage_ring_m[COVERAGE_RINGS];
+
+#endif /* EXCLUDE_COVERAGE */
+
+#endif /* COVERAGEHELPER_H */
@@ -0,0 +1,260 @@
+/*
+ * EventHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Event loop of the RPi build.
+ *
+ * The main loop sleeps in epoll_wait() until one of the watched
+ * descriptors (stdin, gpsd, TCP clients, traffic server, radio DIO line)
+ * becomes ready or one of the deadlines expires. Deadlines are one-shot
+ * timerfds armed from the very same Time_ms() markers the modules keep.
+ */
+
+#if defined(RASPBERRY_PI)
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "Event.h"
+#include "Time.h"
+
+Event_stats_t Event_stats;
+
+typedef struct Event_source_struct {
+  int       fd;
+  uint32_t  events;
+} Event_source_t;
+
+typedef struct Event_timer_struct {
+  int           fd;
+  uint64_t      armed;    /* deadline the timerfd is set for */
+  uint64_t      fired;    /* last deadline already reported */
+} Event_timer_t;
+
+static int Event_epoll_fd = -1;
+static int Event_notify_fd = -1;
+
+static Event_source_t Event_sources[EVENT_SOURCES];
+static Event_timer_t  Event_timers[EVENT_TIMERS];
+
+static uint32_t Event_always = 0; /* sources epoll can not wait for */
+static uint32_t Event_due    = 0; /* deadlines found expired when armed */
+
+static void Event_drain(int fd, size_t size)
+{
+  uint64_t buf[16];
+
+  while (read(fd, buf, size) > 0);
+}
+
+bool Event_setup()
+{
+  struct epoll_event ev;
+
+  if (Event_epoll_fd >= 0) {
+    return true;
+  }
+
+  Event_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (Event_epoll_fd < 0) {
+    perror("epoll_create1");
+    return false;
+  }
+
+  for (uint8_t i = 0; i < EVENT_SOURCES; i++) {
+    Event_sources[i].fd = -1;
+  }
+
+  for (uint8_t t = 0; t < EVENT_TIMERS; t++) {
+    Event_timers[t].fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    Event_timers[t].armed = 0;
+    Event_timers[t].fired = 0;
+
+    if (Event_timers[t].fd < 0) {
+      perror("timerfd_create");
+      continue;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.u32 = EVENT_SOURCES + t;
+    epoll_ctl(Event_epoll_fd, EPOLL_CTL_ADD, Event_timers[t].fd, &ev);
+  }
+
+  Event_notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (Event_notify_fd < 0) {
+    perror("eventfd");
+  } else {
+    Event_watch(EVENT_TRAFFIC, Event_notify_fd, EPOLLIN);
+  }
+
+  memset(&Event_stats, 0, sizeof(Event_stats));
+
+  return true;
+}
+
+void Event_fini()
+{
+  if (Event_epoll_fd < 0) {
+    return;
+  }
+
+  for (uint8_t t = 0; t < EVENT_TIMERS; t++) {
+    if (Event_timers[t].fd >= 0) {
+      close(Event_timers[t].fd);
+      Event_timers[t].fd = -1;
+    }
+  }
+
+  if (Event_notify_fd >= 0) {
+    close(Event_notify_fd);
+    Event_notify_fd = -1;
+  }
+
+  close(Event_epoll_fd);
+  Event_epoll_fd = -1;
+}
+
+/*
+ * Keep a source registered with the descriptor given, -1 to stop watching.
+ * Cheap to call on every pass: epoll is only touched when something changes.
+ */
+void Event_watch(uint8_t src, int fd, uint32_t events)
+{
+  Event_source_t *s = &Event_sources[src];
+  struct epoll_event ev;
+
+  if (Event_epoll_fd < 0 || (fd == s->fd && events == s->events)) {
+    return;
+  }
+
+  if (s->fd >= 0) {
+    /* fails harmlessly if the descriptor has been closed already */
+    epoll_ctl(Event_epoll_fd, EPOLL_CTL_DEL, s->fd, NULL);
+    Event_always &= ~EVENT_SOURCE(src);
+  }
+
+  s->fd     = fd;
+  s->events = events;
+
+  if (fd < 0) {
+    return;
+  }
+
+  ev.events   = events;
+  ev.data.u32 = src;
+
+  if (epoll_ctl(Event_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    if (errno == EEXIST) {
+      epoll_ctl(Event_epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    } else if (errno == EPERM) {
+      /* regular file (e.g. stdin redirected from a log) - always readable */
+      Event_always |= EVENT_SOURCE(src);
+    } else {
+      perror("epoll_ctl");
+    }
+  }
+}
+
+/*
+ * Arm a one-shot deadline, a Time_ms() value, 0 to disarm.
+ * A deadline is reported once. If the owner of the marker does not act
+ * on it the loop goes back to sleep rather than spinning on it.
+ * Time_ms() runs on CLOCK_MONOTONIC, so is the timerfd set to.
+ */
+void Event_timer(uint8_t t, uint64_t deadline)
+{
+  Event_timer_t *tm = &Event_timers[t];
+  struct itimerspec its;
+
+  if (tm->fd < 0 || deadline == tm->armed) {
+    return;
+  }
+
+  memset(&its, 0, sizeof(its));
+
+  if (deadline != 0 && deadline != tm->fired) {
+    if (deadline <= Time_ms()) {
+      Event_due |= EVENT_TIMER(t);
+      tm->fired = deadline;
+      deadline  = 0;
+    } else {
+      its.it_value.tv_sec  = deadline / 1000;
+      its.it_value.tv_nsec = (deadline % 1000) * 1000000L;
+    }
+  } else {
+    deadline = 0;
+  }
+
+  if (deadline != tm->armed) {
+    timerfd_settime(tm->fd, TFD_TIMER_ABSTIME, &its, NULL);
+    tm->armed = deadline;
+  }
+}
+
+/* eventfd for other threads to wake the loop up with */
+int Event_notifier()
+{
+  return Event_notify_fd;
+}
+
+/* Sleep up to timeout ms; returns the mask of the sources and timers ready */
+uint32_t Event_wait(int timeout)
+{
+  struct epoll_event ev[EVENT_MAX_READY];
+  uint32_t ready = Event_due | Event_always;
+  int n;
+
+  if (Event_epoll_fd < 0) {
+    return ready;
+  }
+
+  Event_due = 0;
+  n = epoll_wait(Event_epoll_fd, ev, EVENT_MAX_READY, ready ? 0 : timeout);
+  Event_stats.wakeups++;
+
+  if (n <= 0) {
+    if (n == 0 && !ready) {
+      Event_stats.timeouts++;
+    }
+    return ready;
+  }
+
+  for (int i = 0; i < n; i++) {
+    uint32_t id = ev[i].data.u32;
+
+    if (id >= EVENT_SOURCES) {
+      Event_timer_t *tm = &Event_timers[id - EVENT_SOURCES];
+
+      Event_drain(tm->fd, sizeof(uint64_t));
+      tm->fired = tm->armed;
+      tm->armed = 0;
+    } else if (id == EVENT_TRAFFIC) {
+      Event_drain(Event_notify_fd, sizeof(uint64_t));
+    }
+
+    ready |= 1UL << id;
+    Event_stats.fired[id]++;
+  }
+
+  return ready;
+}
+
+#endif /* RASPBERRY_PI */
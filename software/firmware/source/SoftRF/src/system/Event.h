@@ -0,0 +1,69 @@
+/*
+ * EventHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVENTHELPER_H
+#define EVENTHELPER_H
+
+#include "SoC.h"
+
+#if defined(RASPBERRY_PI)
+
+#define EVENT_MAX_READY     16
+
+/* File descriptors the main loop sleeps on */
+enum
+{
+	EVENT_STDIN,
+	EVENT_GPSD,
+	EVENT_TCPOUT,
+	EVENT_TRAFFIC,    /* traffic server thread has got a message */
+	EVENT_RADIO,      /* DIO edge of the radio */
+	EVENT_PIPELINE,   /* radio stage has got frames */
+	EVENT_SOURCES
+};
+
+/* One-shot deadlines, in Time_ms() */
+enum
+{
+	EVENT_TIMER_EXPORT,
+	EVENT_TIMER_TRAFFIC,
+	EVENT_TIMER_TX,
+	EVENT_TIMERS
+};
+
+#define EVENT_SOURCE(s)     (1UL << (s))
+#define EVENT_TIMER(t)      (1UL << (EVENT_SOURCES + (t)))
+
+typedef struct Event_stats_struct {
+  uint32_t  wakeups;
+  uint32_t  timeouts;
+  uint32_t  fired[EVENT_SOURCES + EVENT_TIMERS];
+} Event_stats_t;
+
+bool     Event_setup(void);
+void     Event_fini(void);
+void     Event_watch(uint8_t, int, uint32_t);
+void     Event_timer(uint8_t, uint64_t);
+int      Event_notifier(void);
+uint32_t Event_wait(int);
+
+extern Event_stats_t Event_stats;
+
+#endif /* RASPBERRY_PI */
+
+#endif /* EVENTHELPER_H */
@@ -0,0 +1,540 @@
+/*
+ * PipelineHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Threaded pipeline of the RPi build, normal mode only:
+ *
+ *   radio stage   - owns the RF IC: channel hopping, TX, RX
+ *   traffic stage - the main thread: inputs, decode, traffic table
+ *   export stage  - NMEA, GDL90, D1090 and JSON output, TCP and UDP sinks
+ *
+ * Frames travel through single producer, single consumer rings.
+ * The export stage works on a snapshot of own ship and the traffic table,
+ * published by the traffic stage once per export cycle, so that
+ * neither the radio nor the traffic table ever wait on output formatting.
+ */
+
+#if defined(RASPBERRY_PI)
+
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "Pipeline.h"
+#include "../TrafficHelper.h"
+#include "../driver/EEPROM.h"
+#include "../driver/TCPOut.h"
+#include "../driver/UDPOut.h"
+#include "../protocol/data/NMEA.h"
+#include "../protocol/data/GDL90.h"
+#include "../protocol/data/D1090.h"
+#include "../protocol/data/JSON.h"
+
+Pipeline_stats_t Pipeline_stats;
+
+static Queue_t Pipeline_rxq;    /* radio   -> traffic */
+static Queue_t Pipeline_txq;    /* traffic -> radio */
+static Queue_t Pipeline_nmeaq;  /* traffic -> export */
+
+static std::atomic<uint32_t> Pipeline_published(0);  /* seq of the latest cycle */
+static uint32_t              Pipeline_exported  = 0;
+
+static int       Pipeline_wake_fd[PIPELINE_STAGES] = { -1, -1, -1 };
+static pthread_t Pipeline_thread[PIPELINE_STAGES];
+
+static std::atomic<bool> Pipeline_running(false);
+static std::atomic<bool> Pipeline_hold(false);
+static std::atomic<int>  Pipeline_held(0);
+
+static thread_local bool Pipeline_in_export = false;
+
+extern uint32_t tx_packets_counter;
+
+bool Queue_init(Queue_t *q, uint32_t depth, size_t item_size)
+{
+  /* depth is a power of two */
+  q->items = (byte *) calloc(depth, item_size);
+  if (q->items == NULL) {
+    return false;
+  }
+
+  q->head.store(0);
+  q->tail.store(0);
+  q->mask      = depth - 1;
+  q->item_size = item_size;
+  q->dropped   = 0;
+
+  return true;
+}
+
+bool Queue_push(Queue_t *q, const void *item)
+{
+  uint32_t tail = q->tail.load(std::memory_order_relaxed);
+
+  if (tail - q->head.load(std::memory_order_acquire) > q->mask) {
+    q->dropped++;
+    return false;
+  }
+
+  memcpy(q->items + (tail & q->mask) * q->item_size, item, q->item_size);
+  q->tail.store(tail + 1, std::memory_order_release);
+
+  return true;
+}
+
+bool Queue_pop(Queue_t *q, void *item)
+{
+  uint32_t head = q->head.load(std::memory_order_relaxed);
+
+  if (head == q->tail.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  memcpy(item, q->items + (head & q->mask) * q->item_size, q->item_size);
+  q->head.store(head + 1, std::memory_order_release);
+
+  return true;
+}
+
+static bool Queue_empty(Queue_t *q)
+{
+  return q->head.load(std::memory_order_acquire) ==
+         q->tail.load(std::memory_order_acquire);
+}
+
+static void Pipeline_wake(uint8_t stage)
+{
+  uint64_t one = 1;
+
+  if (Pipeline_wake_fd[stage] >= 0) {
+    write(Pipeline_wake_fd[stage], &one, sizeof(one));
+  }
+}
+
+static void Pipeline_drain(int fd)
+{
+  uint64_t count;
+
+  if (fd >= 0) {
+    read(fd, &count, sizeof(count));
+  }
+}
+
+static void Pipeline_latency(uint8_t i, unsigned int us)
+{
+  Pipeline_latency_t *l = &Pipeline_stats.latency[i];
+
+  l->count++;
+  l->sum_us += us;
+  if (us > l->max_us) {
+    l->max_us = us;
+  }
+}
+
+static void Pipeline_pin(int core)
+{
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  cpu_set_t set;
+
+  if (cores < 2) {
+    return;
+  }
+
+  CPU_ZERO(&set);
+  CPU_SET(core % cores, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* Stages park here while the traffic stage reconfigures the hardware */
+static void Pipeline_checkpoint()
+{
+  if (Pipeline_hold.load()) {
+    Pipeline_held++;
+    while (Pipeline_hold.load() && Pipeline_running.load()) {
+      usleep(1000);
+    }
+    Pipeline_held--;
+  }
+}
+
+/* Radio stage: a frame for the traffic stage */
+static void Pipeline_hand_over(Pipeline_rx_t *rx)
+{
+  bool idle = Queue_empty(&Pipeline_rxq);
+
+  if (Queue_push(&Pipeline_rxq, rx) && idle) {
+    Pipeline_wake(PIPELINE_TRAFFIC);
+  }
+}
+
+static void *Pipeline_radio_task(void *arg)
+{
+  struct pollfd pfd[2];
+  struct sched_param param;
+  Pipeline_tx_t tx;
+  Pipeline_rx_t rx;
+  bool has_tx = false;
+  int gpio_fd = -1;
+
+  Pipeline_pin(PIPELINE_CORE_RADIO);
+
+  param.sched_priority = PIPELINE_RADIO_PRIORITY;
+  pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+  /* drained by the radio driver, on the next RF_Receive() */
+  gpio_fd = RF_irq_fd();
+
+  pfd[0].fd     = Pipeline_wake_fd[PIPELINE_RADIO];
+  pfd[0].events = POLLIN;
+  pfd[1].fd     = gpio_fd;
+  pfd[1].events = POLLIN;
+
+  while (Pipeline_running.load()) {
+    Pipeline_checkpoint();
+
+    /*
+     * Only the most recent own ship is worth sending. The duty cycle
+     * state is the radio stage's own, so encoding happens here too.
+     * GNSS state and own ship belong to the main loop: channels are
+     * picked with the sync that came along with the latest copy.
+     */
+    while (Queue_pop(&Pipeline_txq, &tx)) {
+      has_tx = true;
+    }
+    if (has_tx) {
+      RF_Hop(&tx.sync);
+    }
+    if (has_tx && tx.fix && micros() - tx.stamp < PIPELINE_TX_STALE_MS * 1000UL) {
+      uint32_t sent = tx_packets_counter;
+
+      tx.own.timestamp = now();
+      if (RF_Transmit(RF_Encode(&tx.own), true)) {
+        Pipeline_latency(PIPELINE_LAT_TX, micros() - tx.stamp);
+      }
+
+      /* $PSRFO is written by the main loop, like $PSRFI */
+      if (tx_packets_counter != sent && settings->nmea_p) {
+        memcpy(rx.raw, TxBuffer, sizeof(rx.raw));
+        rx.rssi  = 0;
+        rx.tx    = true;
+        rx.stamp = micros();
+        rx.utc   = RF_last_tx_utc;
+        Pipeline_hand_over(&rx);
+      }
+    }
+
+    if (RF_Receive()) {
+      memcpy(rx.raw, RxBuffer, sizeof(rx.raw));
+      rx.rssi  = RF_last_rssi;
+      rx.tx    = false;
+      rx.stamp = RF_last_stamp;
+      rx.utc   = RF_last_utc;
+      Pipeline_hand_over(&rx);
+      continue;
+    }
+
+    if (poll(pfd, gpio_fd < 0 ? 1 : 2,
+             gpio_fd < 0 ? PIPELINE_RADIO_POLL_MS : PIPELINE_RADIO_GUARD_MS) > 0 &&
+        pfd[0].revents) {
+      Pipeline_drain(pfd[0].fd);
+    }
+  }
+
+  return NULL;
+}
+
+static traffic_snapshot_t *Pipeline_consume()
+{
+  traffic_snapshot_t *snap;
+
+  if (Pipeline_published.load() == Pipeline_exported) {
+    return NULL;
+  }
+
+  snap = Traffic_acquire(TRAFFIC_READER_EXPORT);
+  if (snap->seq - Pipeline_exported > 1 && Pipeline_exported != 0) {
+    Pipeline_stats.overwritten += snap->seq - Pipeline_exported - 1;
+  }
+  Pipeline_exported = snap->seq;
+
+  return snap;
+}
+
+static void *Pipeline_export_task(void *arg)
+{
+  struct pollfd pfd[2];
+  Pipeline_nmea_t msg;
+  traffic_snapshot_t *snap;
+
+  Pipeline_pin(PIPELINE_CORE_EXPORT);
+  Pipeline_in_export = true;
+
+  pfd[0].fd     = Pipeline_wake_fd[PIPELINE_EXPORT];
+  pfd[0].events = POLLIN;
+  pfd[1].events = POLLIN;
+
+  while (Pipeline_running.load()) {
+    Pipeline_checkpoint();
+
+    pfd[1].fd = TCPOut_fd();
+    if (poll(pfd, pfd[1].fd < 0 ? 1 : 2, PIPELINE_EXPORT_IDLE_MS) > 0 &&
+        pfd[0].revents) {
+      Pipeline_drain(pfd[0].fd);
+    }
+
+    while (Queue_pop(&Pipeline_nmeaq, &msg)) {
+      NMEA_Out(msg.dest, (byte *) msg.text, msg.size, msg.nl);
+    }
+
+    snap = Pipeline_consume();
+    if (snap) {
+      traffic_view_t view = { &snap->own, snap->traffic, snap->fix };
+
+      NMEA_Export_view(&view);
+      if (view.fix) {
+        GDL90_Export_view(&view);
+        D1090_Export_view(&view);
+        JSON_Export_view(&view);
+      }
+    }
+
+    TCPOut_loop();
+    UDPOut_loop();
+
+    if (snap) {
+      Pipeline_latency(PIPELINE_LAT_EXPORT, micros() - snap->stamp);
+      Traffic_release(TRAFFIC_READER_EXPORT);
+    }
+  }
+
+  return NULL;
+}
+
+bool Pipeline_setup()
+{
+  if (Pipeline_running.load()) {
+    return true;
+  }
+
+  if (settings->mode != SOFTRF_MODE_NORMAL) {
+    return false;
+  }
+
+  if ((Pipeline_rxq.items   == NULL &&
+       !Queue_init(&Pipeline_rxq,   PIPELINE_RX_DEPTH,   sizeof(Pipeline_rx_t))) ||
+      (Pipeline_txq.items   == NULL &&
+       !Queue_init(&Pipeline_txq,   PIPELINE_TX_DEPTH,   sizeof(Pipeline_tx_t))) ||
+      (Pipeline_nmeaq.items == NULL &&
+       !Queue_init(&Pipeline_nmeaq, PIPELINE_NMEA_DEPTH, sizeof(Pipeline_nmea_t)))) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < PIPELINE_STAGES; i++) {
+    if (Pipeline_wake_fd[i] < 0) {
+      Pipeline_wake_fd[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (Pipeline_wake_fd[i] < 0) {
+        perror("eventfd");
+        return false;
+      }
+    }
+  }
+
+  Pipeline_pin(PIPELINE_CORE_TRAFFIC);
+  Pipeline_running.store(true);
+
+  if (pthread_create(&Pipeline_thread[PIPELINE_RADIO], NULL,
+                     Pipeline_radio_task, NULL) != 0) {
+    Pipeline_running.store(false);
+    return false;
+  }
+
+  if (pthread_create(&Pipeline_thread[PIPELINE_EXPORT], NULL,
+                     Pipeline_export_task, NULL) != 0) {
+    Pipeline_running.store(false);
+    Pipeline_wake(PIPELINE_RADIO);
+    pthread_join(Pipeline_thread[PIPELINE_RADIO], NULL);
+    return false;
+  }
+
+  return true;
+}
+
+void Pipeline_fini()
+{
+  if (!Pipeline_running.load()) {
+    return;
+  }
+
+  Pipeline_running.store(false);
+  Pipeline_hold.store(false);
+
+  Pipeline_wake(PIPELINE_RADIO);
+  Pipeline_wake(PIPELINE_EXPORT);
+
+  pthread_join(Pipeline_thread[PIPELINE_RADIO], NULL);
+  pthread_join(Pipeline_thread[PIPELINE_EXPORT], NULL);
+}
+
+bool Pipeline_active()
+{
+  return Pipeline_running.load();
+}
+
+/* Bring the radio and export stages to a halt, e.g. to apply new settings */
+void Pipeline_pause()
+{
+  if (!Pipeline_running.load()) {
+    return;
+  }
+
+  Pipeline_hold.store(true);
+  Pipeline_wake(PIPELINE_RADIO);
+  Pipeline_wake(PIPELINE_EXPORT);
+
+  while (Pipeline_held.load() < PIPELINE_STAGES - 1) {
+    usleep(500);
+  }
+}
+
+void Pipeline_resume()
+{
+  Pipeline_hold.store(false);
+}
+
+/* eventfd the traffic stage is woken up with */
+int Pipeline_fd()
+{
+  return Pipeline_wake_fd[PIPELINE_TRAFFIC];
+}
+
+/*
+ * Hand own ship to the radio stage, once per new position report,
+ * whenever the fix comes or goes and once per slot second.
+ */
+void Pipeline_transmit(ufo_t *fop, bool fix)
+{
+  static Pipeline_tx_t last;
+  Pipeline_tx_t tx;
+
+  RF_Sync(&tx.sync);
+
+  if (fix == last.fix && tx.sync.second == last.sync.second &&
+      (!fix || (fop->latitude  == last.own.latitude  &&
+                fop->longitude == last.own.longitude &&
+                fop->altitude  == last.own.altitude  &&
+                fop->timestamp == last.own.timestamp))) {
+    return;
+  }
+
+  tx.own   = *fop;
+  tx.fix   = fix;
+  tx.stamp = micros();
+  if (Queue_push(&Pipeline_txq, &tx)) {
+    last = tx;
+    Pipeline_wake(PIPELINE_RADIO);
+  }
+}
+
+/* File everything the radio has received into the traffic table */
+void Pipeline_receive(bool fix)
+{
+  Pipeline_rx_t rx;
+
+  Pipeline_drain(Pipeline_wake_fd[PIPELINE_TRAFFIC]);
+
+  while (Queue_pop(&Pipeline_rxq, &rx)) {
+    if (rx.tx) {
+      RF_PrintFrame(true, rx.raw, RF_Payload_Size(settings->rf_protocol),
+                    rx.utc, now(), 0);
+      continue;
+    }
+    ParseFrame(rx.raw, rx.rssi, rx.utc, fix);
+    Pipeline_latency(PIPELINE_LAT_RX, micros() - rx.stamp);
+  }
+}
+
+/* Hand own ship and the traffic table over to the export stage */
+void Pipeline_publish(bool fix)
+{
+  Pipeline_published.store(Traffic_publish(fix));
+  Pipeline_stats.snapshots++;
+
+  Pipeline_wake(PIPELINE_EXPORT);
+}
+
+/*
+ * NMEA output of the other stages (GNSS pass-through, PGRMZ)
+ * is written out by the export stage, which owns the sinks.
+ */
+bool Pipeline_defer(uint8_t dest, const byte *buf, size_t size, bool nl)
+{
+  Pipeline_nmea_t msg;
+  bool idle;
+
+  if (!Pipeline_running.load() || Pipeline_in_export) {
+    return false;
+  }
+
+  idle = Queue_empty(&Pipeline_nmeaq);
+
+  do {
+    msg.dest = dest;
+    msg.size = size > PIPELINE_NMEA_SIZE ? PIPELINE_NMEA_SIZE : size;
+    msg.nl   = nl && msg.size == size;
+    memcpy(msg.text, buf, msg.size);
+
+    if (!Queue_push(&Pipeline_nmeaq, &msg)) {
+      break;
+    }
+    buf  += msg.size;
+    size -= msg.size;
+  } while (size > 0);
+
+  if (idle) {
+    Pipeline_wake(PIPELINE_EXPORT);
+  }
+
+  return true;
+}
+
+void Pipeline_report()
+{
+  static const char *names[PIPELINE_LATENCIES] = {
+    [PIPELINE_LAT_RX]     = "rx -> traffic",
+    [PIPELINE_LAT_TX]     = "own ship -> tx",
+    [PIPELINE_LAT_EXPORT] = "publish -> export",
+  };
+
+  for (uint8_t i = 0; i < PIPELINE_LATENCIES; i++) {
+    Pipeline_latency_t *l = &Pipeline_stats.latency[i];
+
+    if (l->count > 0) {
+      fprintf(stderr, "pipeline: %-17s %u, avg %u us, max %u us\n", names[i],
+              l->count, (unsigned int) (l->sum_us / l->count), l->max_us);
+    }
+  }
+
+  fprintf(stderr, "pipeline: %u snapshots, %u overwritten, dropped %u rx %u tx %u nmea\n",
+          Pipeline_stats.snapshots, Pipeline_stats.overwritten,
+          Pipeline_rxq.dropped, Pipeline_txq.dropped, Pipeline_nmeaq.dropped);
+}
+
+#endif /* RASPBERRY_PI */
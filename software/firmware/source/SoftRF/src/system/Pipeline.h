@@ -0,0 +1,132 @@
+/*
+ * PipelineHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINEHELPER_H
+#define PIPELINEHELPER_H
+
+#include "SoC.h"
+
+#if defined(RASPBERRY_PI)
+
+#include <atomic>
+
+#include "../driver/RF.h"
+
+#define PIPELINE_RX_DEPTH       32    /* frames received, waiting for decode */
+#define PIPELINE_TX_DEPTH       4
+#define PIPELINE_NMEA_DEPTH     64    /* sentences of the traffic stage, waiting for output */
+#define PIPELINE_NMEA_SIZE      256
+
+#define PIPELINE_RADIO_POLL_MS  2     /* no DIO line to wake the radio stage up */
+#define PIPELINE_RADIO_GUARD_MS 100
+#define PIPELINE_EXPORT_IDLE_MS 1000
+#define PIPELINE_TX_STALE_MS    3000  /* own ship not sent once this old */
+
+/* Cores the stages are pinned to, modulo the number of cores online */
+#define PIPELINE_CORE_TRAFFIC   0
+#define PIPELINE_CORE_RADIO     1
+#define PIPELINE_CORE_EXPORT    2
+
+#define PIPELINE_RADIO_PRIORITY 10    /* SCHED_FIFO, when permitted */
+
+enum
+{
+	PIPELINE_TRAFFIC,   /* main thread: inputs, decode, traffic table */
+	PIPELINE_RADIO,
+	PIPELINE_EXPORT,
+	PIPELINE_STAGES
+};
+
+/* Bounded ring of fixed size items, one producer and one consumer */
+typedef struct Queue_struct {
+  std::atomic<uint32_t> head;       /* next to pop, moved by the consumer */
+  std::atomic<uint32_t> tail;       /* next to push, moved by the producer */
+  uint32_t              mask;
+  size_t                item_size;
+  byte                  *items;
+  uint32_t              dropped;    /* pushes refused by a full ring */
+} Queue_t;
+
+/* A frame received, or one sent that the traffic stage is to print */
+typedef struct Pipeline_rx_struct {
+  byte          raw[MAX_PKT_SIZE];
+  int8_t        rssi;
+  bool          tx;
+  unsigned int  stamp;              /* micros() at reception */
+  uint64_t      utc;                /* UTC in us of the same, or 0 */
+} Pipeline_rx_t;
+
+/*
+ * Own ship for the radio stage to encode when the duty cycle lets it,
+ * and what it takes of the main loop to hop channels with
+ */
+typedef struct Pipeline_tx_struct {
+  ufo_t         own;
+  bool          fix;
+  RF_sync_t     sync;
+  unsigned int  stamp;              /* micros() when handed over */
+} Pipeline_tx_t;
+
+typedef struct Pipeline_nmea_struct {
+  uint8_t       dest;
+  bool          nl;
+  uint16_t      size;
+  char          text[PIPELINE_NMEA_SIZE];
+} Pipeline_nmea_t;
+
+enum
+{
+	PIPELINE_LAT_RX,      /* received -> filed into the traffic table */
+	PIPELINE_LAT_TX,      /* own ship handed over -> on air */
+	PIPELINE_LAT_EXPORT,  /* published -> every export written */
+	PIPELINE_LATENCIES
+};
+
+typedef struct Pipeline_latency_struct {
+  uint32_t  count;
+  uint32_t  max_us;
+  uint64_t  sum_us;
+} Pipeline_latency_t;
+
+typedef struct Pipeline_stats_struct {
+  Pipeline_latency_t  latency[PIPELINE_LATENCIES];
+  uint32_t            snapshots;
+  uint32_t            overwritten;  /* replaced before the export stage took them */
+} Pipeline_stats_t;
+
+bool Queue_init(Queue_t *, uint32_t, size_t);
+bool Queue_push(Queue_t *, const void *);
+bool Queue_pop(Queue_t *, void *);
+
+bool Pipeline_setup(void);
+void Pipeline_fini(void);
+bool Pipeline_active(void);
+void Pipeline_pause(void);
+void Pipeline_resume(void);
+int  Pipeline_fd(void);
+void Pipeline_transmit(ufo_t *, bool);
+void Pipeline_receive(bool);
+void Pipeline_publish(bool);
+bool Pipeline_defer(uint8_t, const byte *, size_t, bool);
+void Pipeline_report(void);
+
+extern Pipeline_stats_t Pipeline_stats;
+
+#endif /* RASPBERRY_PI */
+
+#endif /* PIPELINEHELPER_H */
@@ -0,0 +1,173 @@
+/*
+ * ProfileHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Profile.h"
+#include "../protocol/data/NMEA.h"
+
+Profile_hist_t Profile_hist[PROFILE_STAGES];
+
+const char *Profile_name[PROFILE_STAGES] = {
+  [PROFILE_RX]      = "rx",
+  [PROFILE_RX_WAIT] = "rx_wait",
+  [PROFILE_TX]      = "tx",
+  [PROFILE_DECODE]  = "decode",
+  [PROFILE_TRAFFIC] = "traffic",
+  [PROFILE_NMEA]    = "nmea",
+  [PROFILE_GDL90]   = "gdl90",
+  [PROFILE_D1090]   = "d1090",
+  [PROFILE_JSON]    = "json",
+  [PROFILE_DISPLAY] = "display",
+};
+
+#if !defined(EXCLUDE_PROFILER)
+/*
+ * Every stage is timed by one thread only, so that plain
+ * counters do. Readers may see a sample half way in.
+ */
+void Profile_record(uint8_t stage, uint32_t us)
+{
+  Profile_hist_t *h = &Profile_hist[stage];
+  uint8_t n = us ? 32 - __builtin_clz(us) : 0;
+
+  h->bucket[n < PROFILE_BUCKETS ? n : PROFILE_BUCKETS - 1]++;
+  h->count++;
+  h->sum_us += us;
+  if (us > h->max_us) {
+    h->max_us = us;
+  }
+}
+#endif /* EXCLUDE_PROFILER */
+
+void Profile_reset()
+{
+  memset(Profile_hist, 0, sizeof(Profile_hist));
+}
+
+/* Upper bound of the bucket the given percentile falls into, in us */
+uint32_t Profile_percentile(uint8_t stage, uint8_t pct)
+{
+  Profile_hist_t *h = &Profile_hist[stage];
+  uint32_t rank = (uint32_t) (((uint64_t) h->count * pct + 99) / 100);
+  uint32_t seen = 0;
+
+  if (h->count == 0) {
+    return 0;
+  }
+
+  for (uint8_t n = 0; n < PROFILE_BUCKETS - 1; n++) {
+    seen += h->bucket[n];
+    if (seen >= rank) {
+      uint32_t bound = n ? (1UL << n) - 1 : 0;
+
+      return bound < h->max_us ? bound : h->max_us;
+    }
+  }
+
+  return h->max_us;
+}
+
+/*
+ * $PSRFS,PROF,<stage>,<count>,<p50 us>,<p99 us>,<max us>,<mean us>
+ * for every stage that has run so far
+ */
+void Profile_NMEA(uint8_t dest)
+{
+  char buf[NMEA_BATCH_SIZE];
+  NmeaWriter_t w;
+
+  NMEA_writer_init(&w, buf, sizeof(buf), dest);
+
+  for (uint8_t i = 0; i < PROFILE_STAGES; i++) {
+    Profile_hist_t *h = &Profile_hist[i];
+
+    if (h->count == 0) {
+      continue;
+    }
+
+    NMEA_begin(&w, "PSRFS,PROF");
+    NMEA_field(&w); NMEA_put_str(&w, Profile_name[i]);
+    NMEA_field(&w); NMEA_put_uint(&w, h->count, 0);
+    NMEA_field(&w); NMEA_put_uint(&w, Profile_percentile(i, 50), 0);
+    NMEA_field(&w); NMEA_put_uint(&w, Profile_percentile(i, 99), 0);
+    NMEA_field(&w); NMEA_put_uint(&w, h->max_us, 0);
+    NMEA_field(&w); NMEA_put_uint(&w, (uint32_t) (h->sum_us / h->count), 0);
+    NMEA_end(&w);
+  }
+
+  NMEA_flush(&w);
+}
+
+/* One JSON object, keyed by stage, NUL terminated; returns its length or 0 */
+size_t Profile_JSON(char *buf, size_t size)
+{
+  size_t len = 0;
+  int n;
+
+#define PROFILE_PUT(...)                                            \
+  do {                                                              \
+    n = snprintf(buf + len, size - len, __VA_ARGS__);               \
+    if (n < 0 || (size_t) n >= size - len) { buf[0] = 0; return 0; } \
+    len += n;                                                       \
+  } while (0)
+
+  if (size == 0) {
+    return 0;
+  }
+
+  PROFILE_PUT("{");
+
+  for (uint8_t i = 0; i < PROFILE_STAGES; i++) {
+    Profile_hist_t *h = &Profile_hist[i];
+
+    PROFILE_PUT("%s\"%s\":{\"count\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu,"
+                "\"mean\":%lu,\"hist\":[",
+                i ? "," : "", Profile_name[i], (unsigned long) h->count,
+                (unsigned long) Profile_percentile(i, 50),
+                (unsigned long) Profile_percentile(i, 99),
+                (unsigned long) h->max_us,
+                (unsigned long) (h->count ? h->sum_us / h->count : 0));
+
+    for (uint8_t b = 0; b < PROFILE_BUCKETS; b++) {
+      PROFILE_PUT("%s%lu", b ? "," : "", (unsigned long) h->bucket[b]);
+    }
+    PROFILE_PUT("]}");
+  }
+
+  PROFILE_PUT("}");
+
+#undef PROFILE_PUT
+
+  return len;
+}
+
+#if defined(RASPBERRY_PI)
+void Profile_report()
+{
+  for (uint8_t i = 0; i < PROFILE_STAGES; i++) {
+    Profile_hist_t *h = &Profile_hist[i];
+
+    if (h->count > 0) {
+      fprintf(stderr, "profile: %-8s %u, p50 %u us, p99 %u us, max %u us\n",
+              Profile_name[i], h->count, Profile_percentile(i, 50),
+              Profile_percentile(i, 99), h->max_us);
+    }
+  }
+}
+#else
+void Profile_report() {}
+#endif /* RASPBERRY_PI */
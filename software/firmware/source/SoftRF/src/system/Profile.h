@@ -0,0 +1,96 @@
+/*
+ * ProfileHelper.h
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILEHELPER_H
+#define PROFILEHELPER_H
+
+#include "SoC.h"
+
+/*
+ * Durations in us fall into power of two buckets:
+ * bucket 0 holds 0 us, bucket n holds [2^(n-1), 2^n) us and the
+ * last one everything from 2^(PROFILE_BUCKETS-2) us upwards.
+ */
+#define PROFILE_BUCKETS     20
+
+/*
+ * Worst case of Profile_JSON(): per stage the name, 5 figures, the
+ * histogram and the keys, every figure 10 digits long.
+ */
+#define PROFILE_NAME_MAX    8
+#define PROFILE_JSON_STAGE  (64 + PROFILE_NAME_MAX + (5 + PROFILE_BUCKETS) * 11)
+#define PROFILE_JSON_SIZE   (PROFILE_STAGES * PROFILE_JSON_STAGE + 3)
+
+enum
+{
+	PROFILE_RX,         /* a frame drained from the radio */
+	PROFILE_RX_WAIT,    /* radio IRQ to the drain, where the driver stamps it */
+	PROFILE_TX,
+	PROFILE_DECODE,     /* decoded and filed into the traffic table */
+	PROFILE_TRAFFIC,
+	PROFILE_NMEA,
+	PROFILE_GDL90,
+	PROFILE_D1090,
+	PROFILE_JSON,
+	PROFILE_DISPLAY,
+	PROFILE_STAGES
+};
+
+typedef struct Profile_hist_struct {
+  uint32_t  count;
+  uint32_t  max_us;
+  uint64_t  sum_us;
+  uint32_t  bucket[PROFILE_BUCKETS];
+} Profile_hist_t;
+
+#if defined(EXCLUDE_PROFILER)
+
+#define PROFILE(stage)
+#define Profile_start()             0
+#define Profile_stop(stage, start)  do { (void) (start); } while (0)
+
+#else
+
+void Profile_record(uint8_t, uint32_t);
+
+#define Profile_start()             ((uint32_t) micros())
+#define Profile_stop(stage, start)  Profile_record((stage), (uint32_t) micros() - (start))
+
+/* Times the rest of the enclosing block */
+struct Profile_probe {
+  uint8_t   stage;
+  uint32_t  start;
+
+  Profile_probe(uint8_t s) : stage(s), start(Profile_start()) {}
+  ~Profile_probe() { Profile_stop(stage, start); }
+};
+
+#define PROFILE(stage)  Profile_probe profile_probe(stage)
+
+#endif /* EXCLUDE_PROFILER */
+
+void     Profile_reset(void);
+uint32_t Profile_percentile(uint8_t, uint8_t);
+void     Profile_NMEA(uint8_t);
+size_t   Profile_JSON(char *, size_t);
+void     Profile_report(void);
+
+extern Profile_hist_t Profile_hist[PROFILE_STAGES];
+extern const char *Profile_name[PROFILE_STAGES];
+
+#endif /* PROFILEHELPER_H */
@@ -0,0 +1,427 @@
+/*
+ * ReplayHelper.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../../SoftRF.h"
+
+#if defined(RASPBERRY_PI)
+
+#include <time.h>
+
+#include <TimeLib.h>
+
+#include "Replay.h"
+#include "SoC.h"
+#include "../TrafficHelper.h"
+#include "../driver/RF.h"
+#include "../driver/GNSS.h"
+#include "../driver/EEPROM.h"
+#include "../protocol/data/NMEA.h"
+#include "../protocol/data/GDL90.h"
+#include "../protocol/radio/Legacy.h"
+#include "../protocol/radio/OGNTP.h"
+#include "../protocol/radio/P3I.h"
+#include "../protocol/radio/FANET.h"
+#include "../protocol/radio/UAT978.h"
+
+/*
+ * Replay of a log recorded with nmea_p on:
+ *
+ *   ./SoftRF --replay [--protocol NAME] [--addr HEX] [--gdl90 FILE] [LOG]
+ *
+ * GNSS sentences of the log move the own ship, $PSRFI frames go through
+ * the decoder and the traffic table, $PSRFO lines are passed on as they
+ * are. Anything else, such as the $PFLAA and $PFLAU that were recorded,
+ * is skipped. Time is that of the log, not of the host: an export cycle
+ * runs for every second of it, as soon as a line of the next second
+ * turns up. Frame stamps are the device clock; GNSS sentences carry
+ * no stamp, so their time is moved by the offset of the device clock
+ * from GNSS time seen last. A fix, too, is as old as the log says, not
+ * as the host clock does. NMEA goes to standard output, GDL90 to the
+ * file given, so that both can be compared with what the device sent.
+ */
+
+typedef struct Replay_protocol_struct {
+  const char  *name;
+  uint8_t     protocol;
+  bool        (*decode)(void *, ufo_t *, ufo_t *);
+} Replay_protocol_t;
+
+static const Replay_protocol_t Replay_protocols[] = {
+  { "legacy", RF_PROTOCOL_LEGACY,   legacy_decode },
+  { "ogntp",  RF_PROTOCOL_OGNTP,    ogntp_decode  },
+  { "p3i",    RF_PROTOCOL_P3I,      p3i_decode    },
+  { "fanet",  RF_PROTOCOL_FANET,    fanet_decode  },
+  { "uat",    RF_PROTOCOL_ADSB_UAT, uat978_decode },
+};
+
+#define REPLAY_PROTOCOLS (sizeof(Replay_protocols) / sizeof(Replay_protocols[0]))
+
+typedef struct Replay_stats_struct {
+  unsigned long lines;
+  unsigned long sentences;
+  unsigned long frames;
+  unsigned long decoded;
+  unsigned long transmitted;
+  unsigned long skipped;
+  unsigned long cycles;
+} Replay_stats_t;
+
+static Replay_stats_t Replay_stats;
+static time_t Replay_second;      /* the second an export cycle is due for */
+static time_t Replay_gnss;        /* GNSS time of the latest sentence */
+static time_t Replay_offset;      /* device clock less GNSS time */
+static time_t Replay_fixed;       /* the second of the latest position */
+static FILE   *Replay_gdl90;
+static bool   (*Replay_decoder)(void *, ufo_t *, ufo_t *);
+
+static size_t Replay_GDL90_write(const uint8_t *buf, size_t size)
+{
+  return fwrite(buf, 1, size, Replay_gdl90);
+}
+
+static IODev_ops_t Replay_GDL90_ops = {
+  "Replay GDL90",
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Replay_GDL90_write
+};
+
+static bool Replay_decode(void *pkt, ufo_t *this_aircraft, ufo_t *fop)
+{
+  bool decoded = Replay_decoder(pkt, this_aircraft, fop);
+
+  if (decoded) {
+    Replay_stats.decoded++;
+  }
+
+  return decoded;
+}
+
+/* isValidGNSSFix() by the clock of the log */
+static bool Replay_fix()
+{
+  return Replay_fixed != 0 && Replay_second - Replay_fixed <= NMEA_EXP_TIME / 1000;
+}
+
+/* What the main loop does once a second, after the radio */
+static void Replay_cycle()
+{
+  traffic_view_t view = { &ThisAircraft, Container, Replay_fix() };
+
+  setTime(Replay_second);
+  ThisAircraft.timestamp = now();
+
+  if (view.fix) {
+    UpdateTrafficTimeMarker = 0;
+    Traffic_loop();
+  }
+
+  NMEA_Export_view(&view);
+
+  if (view.fix) {
+    GDL90_Export_view(&view);
+  }
+
+  ClearExpired();
+
+  Replay_stats.cycles++;
+}
+
+/* Runs the export cycles due before the second given, then moves to it */
+static void Replay_clock(time_t second)
+{
+  /* a step of the device clock is not to be filled in, nor gone back over */
+  if (Replay_second == 0 || second - Replay_second > REPLAY_MAX_GAP ||
+      Replay_second - second > 2) {
+    Replay_second = second;
+  }
+
+  while (Replay_second < second) {
+    Replay_cycle();
+    Replay_second++;
+  }
+
+  setTime(second);
+  ThisAircraft.timestamp = second;
+}
+
+/* "sec" or "sec.usec", as RF_PrintFrame() writes it */
+static bool Replay_stamp(const char *str, time_t *second, uint64_t *utc)
+{
+  char *end;
+  unsigned long sec = strtoul(str, &end, 10);
+
+  if (end == str) {
+    return false;
+  }
+
+  *second = (time_t) sec;
+  *utc    = 0;
+
+  if (*end == '.') {
+    unsigned long usec = strtoul(end + 1, &end, 10);
+
+    *utc = (uint64_t) sec * 1000000 + usec;
+  }
+
+  /* the device clock has been set or stepped since */
+  if (Replay_gnss) {
+    time_t offset = *second - Replay_gnss;
+
+    if (offset - Replay_offset > 2 || Replay_offset - offset > 2) {
+      Replay_offset = offset;
+    }
+  }
+
+  return *end == ',';
+}
+
+static size_t Replay_hex(const char *str, byte *buf, size_t size)
+{
+  size_t n = 0;
+
+  while (n < size && isxdigit(str[0]) && isxdigit(str[1])) {
+    char byte_str[3] = { str[0], str[1], 0 };
+
+    buf[n++] = (byte) strtoul(byte_str, NULL, 16);
+    str += 2;
+  }
+
+  return n;
+}
+
+/* $PSRFI,<time>,<hex>,<rssi> */
+static void Replay_PSRFI(char *str)
+{
+  char     *hex = strchr(str + 7, ',');
+  char     *rssi;
+  time_t   second;
+  uint64_t utc;
+
+  if (hex == NULL || !Replay_stamp(str + 7, &second, &utc) ||
+      (rssi = strchr(hex + 1, ',')) == NULL) {
+    Replay_stats.skipped++;
+    return;
+  }
+
+  Replay_clock(second);
+
+  memset(RxBuffer, 0, sizeof(RxBuffer));
+  Replay_hex(hex + 1, RxBuffer, sizeof(RxBuffer));
+  RF_last_rssi = (int8_t) atoi(rssi + 1);
+  RF_last_utc  = utc;
+
+  Replay_stats.frames++;
+
+  ParseData(Replay_fix());
+}
+
+/* $PSRFO,<time>,<hex> - what the device sent itself */
+static void Replay_PSRFO(char *str, size_t len)
+{
+  time_t   second;
+  uint64_t utc;
+
+  if (!Replay_stamp(str + 7, &second, &utc)) {
+    Replay_stats.skipped++;
+    return;
+  }
+
+  Replay_clock(second);
+
+  if (settings->nmea_p) {
+    StdOut.println(str);
+  }
+
+  Replay_stats.transmitted++;
+}
+
+/* GNSS sentence: the clock moves first, so that it lands in its own second */
+static void Replay_GNSS(char *str, size_t len)
+{
+  for (size_t i = 0; i < len; i++) {
+    gnss.encode(str[i]);
+  }
+  gnss.encode('\n');
+
+  if (gnss.time.isValid() && gnss.time.isUpdated() && gnss.date.isValid()) {
+    tmElements_t tm;
+
+    tm.Year   = CalendarYrToTm(gnss.date.year());
+    tm.Month  = gnss.date.month();
+    tm.Day    = gnss.date.day();
+    tm.Hour   = gnss.time.hour();
+    tm.Minute = gnss.time.minute();
+    tm.Second = gnss.time.second();
+
+    Replay_gnss = makeTime(tm);
+    Replay_clock(Replay_gnss + Replay_offset);
+  }
+
+  if (settings->nmea_g) {
+    NMEA_Out(settings->nmea_out, (byte *) str, len, true);
+  }
+
+  if (gnss.location.isValid() && gnss.location.isUpdated()) {
+    Replay_fixed = Replay_second;
+  }
+  if (Replay_fix()) {
+    GNSS_Ownship(&ThisAircraft);
+  }
+
+  Replay_stats.sentences++;
+}
+
+static int Replay_usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s --replay [--protocol NAME] [--addr HEX] [--gdl90 FILE] [LOG]\n",
+          prog);
+  fprintf(stderr, "Protocols:");
+  for (size_t i = 0; i < REPLAY_PROTOCOLS; i++) {
+    fprintf(stderr, " %s", Replay_protocols[i].name);
+  }
+  fprintf(stderr, "\n");
+
+  return EXIT_FAILURE;
+}
+
+int Replay_main(int argc, char *argv[])
+{
+  const Replay_protocol_t *rp = NULL;
+  const SoC_ops_t *soc = SoC;
+  FILE *log = stdin;
+  char *line = NULL;
+  size_t size = 0;
+  ssize_t len;
+  struct timespec start, end;
+
+  RPi_defaults();
+
+  for (int i = 0; i < argc; i++) {
+    if (!strcmp(argv[i], "--protocol") && i + 1 < argc) {
+      i++;
+      for (size_t j = 0; j < REPLAY_PROTOCOLS; j++) {
+        if (!strcasecmp(argv[i], Replay_protocols[j].name)) {
+          rp = &Replay_protocols[j];
+        }
+      }
+      if (rp == NULL) {
+        return Replay_usage("SoftRF");
+      }
+    } else if (!strcmp(argv[i], "--addr") && i + 1 < argc) {
+      ThisAircraft.addr = strtoul(argv[++i], NULL, 16) & 0x00FFFFFF;
+    } else if (!strcmp(argv[i], "--gdl90") && i + 1 < argc) {
+      Replay_gdl90 = fopen(argv[++i], "wb");
+      if (Replay_gdl90 == NULL) {
+        perror(argv[i]);
+        return EXIT_FAILURE;
+      }
+    } else if (argv[i][0] != '-' || !strcmp(argv[i], "-")) {
+      if (strcmp(argv[i], "-") && (log = fopen(argv[i], "r")) == NULL) {
+        perror(argv[i]);
+        return EXIT_FAILURE;
+      }
+    } else {
+      return Replay_usage("SoftRF");
+    }
+  }
+
+  if (rp == NULL) {
+    for (size_t j = 0; j < REPLAY_PROTOCOLS; j++) {
+      if (Replay_protocols[j].protocol == settings->rf_protocol) {
+        rp = &Replay_protocols[j];
+      }
+    }
+  }
+  if (rp == NULL) {
+    rp = &Replay_protocols[0];
+    fprintf(stderr, "Replay: no decoder for protocol %d of the settings, using %s\n",
+            settings->rf_protocol, rp->name);
+  }
+
+  settings->rf_protocol = rp->protocol;
+  settings->nmea_p      = true;
+  settings->nmea_out    = NMEA_UART;
+  settings->gdl90       = Replay_gdl90 ? GDL90_USB : GDL90_OFF;
+
+  SoC_ops_t replay_soc = RPi_ops;  /* none of the hardware is brought up */
+
+  replay_soc.USB_ops = &Replay_GDL90_ops;
+  SoC = &replay_soc;
+
+  Replay_decoder  = rp->decode;
+  protocol_decode = Replay_decode;
+
+  ThisAircraft.aircraft_type = settings->aircraft_type;
+  ThisAircraft.protocol      = settings->rf_protocol;
+
+  Traffic_setup();
+  NMEA_setup();
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  while ((len = getline(&line, &size, log)) >= 0) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+      line[--len] = 0;
+    }
+    Replay_stats.lines++;
+
+    if (!strncmp(line, "$PSRFI,", 7)) {
+      Replay_PSRFI(line);
+    } else if (!strncmp(line, "$PSRFO,", 7)) {
+      Replay_PSRFO(line, len);
+    } else if (len > 6 && line[0] == '$' && line[1] == 'G') {
+      Replay_GNSS(line, len);
+    } else {
+      Replay_stats.skipped++;
+    }
+  }
+
+  /* the last second of the log has its export cycle too */
+  if (Replay_second) {
+    Replay_cycle();
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  fflush(stdout);
+
+  double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  fprintf(stderr, "Replay (%s): %lu lines, %lu GNSS sentences, %lu frames received, "
+                  "%lu decoded, %lu sent, %lu skipped\n",
+          rp->name, Replay_stats.lines, Replay_stats.sentences, Replay_stats.frames,
+          Replay_stats.decoded, Replay_stats.transmitted, Replay_stats.skipped);
+  fprintf(stderr, "Replay: %lu s of log in %.3f s, %.0f times real time\n",
+          Replay_stats.cycles, wall, wall > 0 ? Replay_stats.cycles / wall : 0.0);
+
+  free(line);
+  if (log != stdin) {
+    fclose(log);
+  }
+  if (Replay_gdl90) {
+    fclose(Replay_gdl90);
+  }
+  SoC = soc;
+
+  return EXIT_SUCCESS;
+}
+
+#endif /* RASPBERRY_PI */
@@ -17,6 +17,332 @@
  */
 
 #include "SoC.h"
+#include "Time.h"
+
+#if defined(RASPBERRY_PI)
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/pps.h>
+#endif /* RASPBERRY_PI */
+
+#if defined(ESP32)
+#include <esp_timer.h>
+#endif /* ESP32 */
+
+/* Readings have to come at least once per wrap of the counter */
+uint64_t Time_extend(Time_ext_t *ext, uint32_t now)
+{
+  if (now < ext->last) {
+    ext->wraps++;
+  }
+  ext->last = now;
+
+  return ((uint64_t) ext->wraps << 32) | now;
+}
+
+#if defined(RASPBERRY_PI)
+
+uint64_t Time_us()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+#elif defined(ESP32)
+
+uint64_t Time_us()
+{
+  return (uint64_t) esp_timer_get_time();
+}
+
+#elif defined(ESP8266)
+
+uint64_t Time_us()
+{
+  return micros64();
+}
+
+#else
+
+static Time_ext_t Time_micros;
+
+/* The main loop reads the clock far more often than micros() wraps */
+uint64_t Time_us()
+{
+  return Time_extend(&Time_micros, micros());
+}
+
+#endif /* RASPBERRY_PI */
+
+/*
+ * The model is written from the main loop only, but read from any thread,
+ * so it is published seqlock style: an odd sequence is a write in progress.
+ */
+static Time_model_t Time_state;
+static uint32_t     Time_seq = 0;
+
+static void Time_commit(const Time_model_t *m)
+{
+  uint32_t seq = Time_seq;
+
+  __atomic_store_n(&Time_seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(&Time_state, m, sizeof(Time_model_t));
+  __atomic_store_n(&Time_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* Consistent copy of the model */
+void Time_model(Time_model_t *m)
+{
+  uint32_t seq;
+
+  do {
+    while ((seq = __atomic_load_n(&Time_seq, __ATOMIC_ACQUIRE)) & 1);
+    memcpy(m, &Time_state, sizeof(Time_model_t));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while (seq != __atomic_load_n(&Time_seq, __ATOMIC_RELAXED));
+}
+
+void Time_reset()
+{
+  Time_model_t m;
+
+  memset(&m, 0, sizeof(m));
+  Time_commit(&m);
+}
+
+static uint64_t Time_map(const Time_model_t *m, uint64_t local, uint32_t *err)
+{
+  int64_t  dl  = (int64_t) (local - m->local);
+  uint64_t age = dl < 0 ? -dl : dl;
+  uint64_t ppb, e;
+
+  if (m->source == TIME_SOURCE_PPS) {
+    /* until a few edges are in, the drift is no better than the crystal's rating */
+    ppb = m->wander + (m->edges < 2 ? 100000 : m->edges < TIME_PPS_LOCK ? 5000 : 100);
+    e   = 1 + (2 * (uint64_t) m->jitter + 999) / 1000;
+  } else {
+    ppb = 100000;
+    e   = TIME_NMEA_ERROR;
+  }
+  e += age / 1000 * ppb / 1000000;
+
+  if (err) {
+    *err = e > UINT32_MAX ? UINT32_MAX : (uint32_t) e;
+  }
+
+  /* in two parts, as us times ppb overflows after a few months */
+  return m->utc + dl - (dl / 1000000 * m->drift / 1000 +
+                        dl % 1000000 * m->drift / 1000000000);
+}
+
+/* UTC in us since the epoch at a Time_us() reading, or 0 when it is unknown */
+uint64_t Time_to_utc(uint64_t local, uint32_t *err)
+{
+  Time_model_t m;
+
+  Time_model(&m);
+  if (m.source == TIME_SOURCE_NONE) {
+    if (err) {
+      *err = UINT32_MAX;
+    }
+    return 0;
+  }
+
+  return Time_map(&m, local, err);
+}
+
+uint64_t utc_now_us(uint32_t *err)
+{
+  return Time_to_utc(Time_us(), err);
+}
+
+/* An edge known to have started the UTC second given */
+static void Time_label(Time_model_t *m, uint64_t local, uint32_t sec)
+{
+  uint64_t utc = (uint64_t) sec * 1000000;
+
+  if (m->source == TIME_SOURCE_PPS && m->edges > 0 &&
+      local > m->local && utc > m->utc &&
+      utc - m->utc <= TIME_PPS_SPAN * 1000000ULL) {
+    int32_t n      = (utc - m->utc) / 1000000;
+    int64_t dl     = (int64_t) (local - m->local);
+    int64_t sample = (dl - (int64_t) n * 1000000) * 1000 / n;
+
+    if (sample > TIME_DRIFT_MAX || sample < -TIME_DRIFT_MAX) {
+      m->slips++;
+      m->edges = 0;
+    } else if (m->edges == 1) {
+      m->drift  = sample;
+      m->jitter = 0;
+      m->wander = 0;
+    } else {
+      int64_t residual = dl * 1000 - (int64_t) n * 1000000000 - (int64_t) n * m->drift;
+      int32_t delta    = sample - m->drift;
+
+      if (residual < 0) {
+        residual = -residual;
+      }
+      m->jitter += ((int32_t) residual - (int32_t) m->jitter) / 8;
+      m->drift  += delta / 8;
+      m->wander += ((delta < 0 ? -delta : delta) - (int32_t) m->wander) / 8;
+    }
+  } else {
+    /* first edge, or after an outage - the drift estimate is kept */
+    m->edges = 0;
+  }
+
+  m->local   = local;
+  m->utc     = utc;
+  m->pending = 0;
+  m->source  = TIME_SOURCE_PPS;
+  m->edges++;
+}
+
+/*
+ * PPS edge at a Time_us() reading, with the UTC second it started when the
+ * source knows it, or 0. An edge is otherwise counted on from the previous
+ * one, or held until the next sentence tells which second it was.
+ */
+void Time_pps(uint64_t local, uint32_t sec)
+{
+  Time_model_t m = Time_state;
+
+  if (sec == 0) {
+    if (m.source != TIME_SOURCE_PPS || local - m.local > TIME_PPS_HOLDOVER) {
+      m.pending = local;
+      Time_commit(&m);
+      return;
+    }
+    sec = (Time_map(&m, local, NULL) + 500000) / 1000000;
+  }
+
+  Time_label(&m, local, sec);
+  Time_commit(&m);
+}
+
+/*
+ * Time of day from a GNSS sentence, received at a Time_us() reading.
+ * A sentence goes out after the edge of its second and before the next one.
+ */
+void Time_nmea(uint32_t sec, uint32_t usec, uint64_t local)
+{
+  Time_model_t m = Time_state;
+  uint64_t utc = (uint64_t) sec * 1000000 + usec;
+  bool pps = (m.source == TIME_SOURCE_PPS && local - m.local <= TIME_PPS_HOLDOVER);
+
+  if (m.pending && local >= m.pending + usec && local < m.pending + usec + 1000000) {
+    Time_label(&m, m.pending, sec);
+    pps = true;
+  } else if (pps) {
+    int64_t late = (int64_t) (Time_map(&m, local, NULL) - utc);
+
+    /* the edges have been counted off by a second or more */
+    if (late < -(TIME_NMEA_ERROR / 20) || late > TIME_NMEA_ERROR) {
+      m.slips++;
+      pps = false;
+    }
+  }
+
+  if (!pps) {
+    m.local  = local;
+    m.utc    = utc;
+    m.edges  = 0;
+    m.source = TIME_SOURCE_NMEA;
+  }
+  Time_commit(&m);
+}
+
+#if defined(RASPBERRY_PI)
+
+/* Time_us() reading of a CLOCK_REALTIME stamp from the recent past */
+uint64_t Time_from_realtime(int64_t sec, int32_t nsec)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+
+  return Time_us() - ((ts.tv_sec - sec) * 1000000LL + (ts.tv_nsec - nsec) / 1000);
+}
+
+/*
+ * Kernel PPS client (pps-gpio, pps-ldisc). The edges are stamped by the
+ * kernel, so a fetch once per pass of the main loop loses no accuracy.
+ */
+static char     Time_pps_dev[64] = TIME_PPS_DEVICE;
+static int      Time_pps_fd  = -1;
+static uint32_t Time_pps_sequence;
+
+/* "/dev/ppsN", or "OFF" */
+bool Time_pps_configure(const char *dev)
+{
+  if (strlen(dev) >= sizeof(Time_pps_dev)) {
+    return false;
+  }
+
+  Time_pps_fini();
+  strcpy(Time_pps_dev, strcmp(dev, "OFF") ? dev : "");
+
+  return true;
+}
+
+void Time_pps_setup()
+{
+  struct pps_fdata fdata;
+
+  if (Time_pps_fd >= 0 || !Time_pps_dev[0]) {
+    return;
+  }
+
+  /* most units have no PPS source at all */
+  Time_pps_fd = open(Time_pps_dev, O_RDONLY | O_CLOEXEC);
+  if (Time_pps_fd < 0) {
+    return;
+  }
+
+  memset(&fdata, 0, sizeof(fdata));
+  if (ioctl(Time_pps_fd, PPS_FETCH, &fdata) < 0) {
+    perror(Time_pps_dev);
+    Time_pps_fini();
+    return;
+  }
+  Time_pps_sequence = fdata.info.assert_sequence;
+}
+
+void Time_pps_loop()
+{
+  struct pps_fdata fdata;
+
+  if (Time_pps_fd < 0) {
+    return;
+  }
+
+  /* zero timeout - the latest edge, without waiting for the next one */
+  memset(&fdata, 0, sizeof(fdata));
+  if (ioctl(Time_pps_fd, PPS_FETCH, &fdata) < 0 ||
+      fdata.info.assert_sequence == Time_pps_sequence) {
+    return;
+  }
+  Time_pps_sequence = fdata.info.assert_sequence;
+
+  Time_pps(Time_from_realtime(fdata.info.assert_tu.sec,
+                              fdata.info.assert_tu.nsec), 0);
+}
+
+void Time_pps_fini()
+{
+  if (Time_pps_fd >= 0) {
+    close(Time_pps_fd);
+    Time_pps_fd = -1;
+  }
+}
+
+#endif /* RASPBERRY_PI */
 
 #if defined(EXCLUDE_WIFI)
 void Time_setup()     {}
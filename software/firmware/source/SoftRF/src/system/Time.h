@@ -19,6 +19,74 @@
 #ifndef TIMEHELPER_H
 #define TIMEHELPER_H
 
-void Time_setup(void);
+#include <stdint.h>
+
+/*
+ * Monotonic time base in microseconds, from an arbitrary origin.
+ * Being 64 bits wide, it does not wrap around in the lifetime of a unit,
+ * whereas millis() does after 49.7 days and micros() after 71.6 minutes.
+ */
+#define Time_ms()             (Time_us() / 1000)
+
+/* Milliseconds past a Time_ms() marker */
+#define Time_since(marker)    (Time_ms() - (marker))
+
+/* State of a 32-bit counter being extended to 64 bits */
+typedef struct Time_ext_struct {
+  uint32_t  last;
+  uint32_t  wraps;
+} Time_ext_t;
+
+/*
+ * UTC as a model of the local time base, disciplined by PPS edges
+ * and labelled with the time of day from GNSS sentences.
+ */
+enum
+{
+	TIME_SOURCE_NONE,
+	TIME_SOURCE_NMEA,   /* sentence arrival, late by up to a second */
+	TIME_SOURCE_PPS
+};
+
+#define TIME_PPS_HOLDOVER   60000000  /* us a model keeps running on without edges */
+#define TIME_PPS_LOCK       8         /* edges before the drift is trusted */
+#define TIME_PPS_SPAN       16        /* s, longest gap bridged by one drift sample */
+#define TIME_DRIFT_MAX      500000    /* ppb, anything worse is a mislabelled edge */
+#define TIME_NMEA_ERROR     1000000   /* us */
+#define TIME_STAMP_ERROR    1000      /* us, finest a frame stamp is worth printing */
+#define TIME_SLOT_ERROR     10000     /* us, good enough to pick a slot with */
+
+#define TIME_PPS_DEVICE     "/dev/pps0"
+
+typedef struct Time_model_struct {
+  uint64_t  local;      /* Time_us() of the reference point */
+  uint64_t  utc;        /* us since the epoch at the reference point */
+  int32_t   drift;      /* ppb the local clock runs fast by */
+  uint32_t  jitter;     /* ns, filtered residual of edges against the model */
+  uint32_t  wander;     /* ppb, filtered change of the drift between edges */
+  uint32_t  edges;      /* in a row since the last lock */
+  uint32_t  slips;      /* labels found off by whole seconds */
+  uint64_t  pending;    /* Time_us() of an edge yet to be labelled, or 0 */
+  uint8_t   source;
+} Time_model_t;
+
+void     Time_setup(void);
+uint64_t Time_us(void);
+uint64_t Time_extend(Time_ext_t *, uint32_t);
+
+void     Time_pps(uint64_t, uint32_t);
+void     Time_nmea(uint32_t, uint32_t, uint64_t);
+uint64_t Time_to_utc(uint64_t, uint32_t *);
+uint64_t utc_now_us(uint32_t *);
+void     Time_model(Time_model_t *);
+void     Time_reset(void);
+
+#if defined(RASPBERRY_PI)
+uint64_t Time_from_realtime(int64_t, int32_t);
+bool     Time_pps_configure(const char *);
+void     Time_pps_setup(void);
+void     Time_pps_loop(void);
+void     Time_pps_fini(void);
+#endif /* RASPBERRY_PI */
 
 #endif /* TIMEHELPER_H */
\ No newline at end of file
@@ -57,6 +57,8 @@ static void EPD_Draw_Radar()
   char cog_text[6];
 
   if (!EPD_ready_to_display) {
+    /* the traffic table keeps changing while the view is drawn */
+    traffic_snapshot_t *snap = Traffic_acquire(TRAFFIC_READER_DISPLAY);
 
     /* divider is a half of full scale */
     int32_t divider = 2000;
@@ -113,24 +115,24 @@ static void EPD_Draw_Radar()
 
     {
       for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (Container[i].addr && (now() - Container[i].timestamp) <= EPD_EXPIRATION_TIME) {
+        if (snap->traffic[i].addr && (now() - snap->traffic[i].timestamp) <= EPD_EXPIRATION_TIME) {
 
           int16_t rel_x;
           int16_t rel_y;
           float distance;
           float bearing;
 
-          bool isTeam = (Container[i].addr == ui->team) ;
+          bool isTeam = (snap->traffic[i].addr == ui->team) ;
 
-          distance = Container[i].distance;
-          bearing  = Container[i].bearing;
+          distance = snap->traffic[i].distance;
+          bearing  = snap->traffic[i].bearing;
 
           switch (ui->orientation)
           {
           case DIRECTION_NORTH_UP:
             break;
           case DIRECTION_TRACK_UP:
-            bearing -= ThisAircraft.course;
+            bearing -= snap->own.course;
             break;
           default:
             /* TBD */
@@ -145,7 +147,7 @@ static void EPD_Draw_Radar()
           int16_t x = ((int32_t) rel_x * (int32_t) radius) / divider;
           int16_t y = ((int32_t) rel_y * (int32_t) radius) / divider;
 
-          float RelativeVertical = Container[i].altitude - ThisAircraft.altitude;
+          float RelativeVertical = snap->traffic[i].altitude - snap->own.altitude;
 
           if        (RelativeVertical >   EPD_RADAR_V_THRESHOLD) {
             if (isTeam) {
@@ -258,7 +260,7 @@ static void EPD_Draw_Radar()
         display->print("B");
 
         display->setFont(&FreeMonoBold9pt7b);
-        snprintf(cog_text, sizeof(cog_text), "%03d", (int) ThisAircraft.course);
+        snprintf(cog_text, sizeof(cog_text), "%03d", (int) snap->own.course);
         display->getTextBounds(cog_text, 0, 0, &tbx, &tby, &tbw, &tbh);
 
         x = radar_x + (radar_w - tbw) / 2;
@@ -298,6 +300,8 @@ static void EPD_Draw_Radar()
       }
     }
 
+    Traffic_release(TRAFFIC_READER_DISPLAY);
+
     /* a signal to background EPD update task */
     EPD_ready_to_display = true;
   }
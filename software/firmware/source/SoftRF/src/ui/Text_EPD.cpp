@@ -52,34 +52,48 @@ static void EPD_Draw_Text()
   int bearing;
   char info_line [TEXT_VIEW_LINE_LENGTH];
   char id_text   [TEXT_VIEW_LINE_LENGTH];
+  traffic_by_dist_t by_dist[MAX_TRACKING_OBJECTS];
+  ufo_t target, own;
+  bool draw;
+  traffic_snapshot_t *snap = Traffic_acquire(TRAFFIC_READER_DISPLAY);
 
   for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-    if (Container[i].addr && (now() - Container[i].timestamp) <= EPD_EXPIRATION_TIME) {
+    if (snap->traffic[i].addr && (now() - snap->traffic[i].timestamp) <= EPD_EXPIRATION_TIME) {
 
-      traffic_by_dist[j].fop = &Container[i];
-      traffic_by_dist[j].distance = Container[i].distance;
+      by_dist[j].fop = &snap->traffic[i];
+      by_dist[j].distance = snap->traffic[i].distance;
       j++;
     }
   }
 
-  if (j > 0 && !EPD_ready_to_display) {
+  draw = (j > 0 && !EPD_ready_to_display);
 
-    uint8_t db;
-    const char *u_dist, *u_alt, *u_spd;
-    float disp_dist;
-    int   disp_alt, disp_spd;
-
-    qsort(traffic_by_dist, j, sizeof(traffic_by_dist_t), traffic_cmp_by_distance);
+  /* the view keeps copies, the snapshot goes back before drawing */
+  if (draw) {
+    qsort(by_dist, j, sizeof(traffic_by_dist_t), traffic_cmp_by_distance);
 
     if (EPD_current > j) {
       EPD_current = j;
     }
 
-    bearing = (int) traffic_by_dist[EPD_current - 1].fop->bearing;
+    target = *by_dist[EPD_current - 1].fop;
+    own    = snap->own;
+  }
+
+  Traffic_release(TRAFFIC_READER_DISPLAY);
+
+  if (draw) {
+
+    uint8_t db;
+    const char *u_dist, *u_alt, *u_spd;
+    float disp_dist;
+    int   disp_alt, disp_spd;
+
+    bearing = (int) target.bearing;
 
     /* This bearing is always relative to current ground track */
 //  if (ui->orientation == DIRECTION_TRACK_UP) {
-      bearing -= ThisAircraft.course;
+      bearing -= own.course;
 //  }
 
     if (bearing < 0) {
@@ -87,8 +101,7 @@ static void EPD_Draw_Text()
     }
 
     int oclock = ((bearing + 15) % 360) / 30;
-    float RelativeVertical = traffic_by_dist[EPD_current - 1].fop->altitude -
-                                ThisAircraft.altitude;
+    float RelativeVertical = target.altitude - own.altitude;
 
     switch (ui->units)
     {
@@ -96,31 +109,31 @@ static void EPD_Draw_Text()
       u_dist = "nm";
       u_alt  = "f";
       u_spd  = "kts";
-      disp_dist = (traffic_by_dist[EPD_current - 1].distance * _GPS_MILES_PER_METER) /
+      disp_dist = (target.distance * _GPS_MILES_PER_METER) /
                   _GPS_MPH_PER_KNOT;
       disp_alt  = abs((int) (RelativeVertical * _GPS_FEET_PER_METER));
-      disp_spd  = traffic_by_dist[EPD_current - 1].fop->speed;
+      disp_spd  = target.speed;
       break;
     case UNITS_MIXED:
       u_dist = "km";
       u_alt  = "f";
       u_spd  = "kph";
-      disp_dist = traffic_by_dist[EPD_current - 1].distance / 1000.0;
+      disp_dist = target.distance / 1000.0;
       disp_alt  = abs((int) (RelativeVertical * _GPS_FEET_PER_METER));
-      disp_spd  = traffic_by_dist[EPD_current - 1].fop->speed * _GPS_KMPH_PER_KNOT;
+      disp_spd  = target.speed * _GPS_KMPH_PER_KNOT;
       break;
     case UNITS_METRIC:
     default:
       u_dist = "km";
       u_alt  = "m";
       u_spd  = "kph";
-      disp_dist = traffic_by_dist[EPD_current - 1].distance / 1000.0;
+      disp_dist = target.distance / 1000.0;
       disp_alt  = abs((int) RelativeVertical);
-      disp_spd  = traffic_by_dist[EPD_current - 1].fop->speed * _GPS_KMPH_PER_KNOT;
+      disp_spd  = target.speed * _GPS_KMPH_PER_KNOT;
       break;
     }
 
-    uint32_t id = traffic_by_dist[EPD_current - 1].fop->addr;
+    uint32_t id = target.addr;
 
     snprintf(id_text, sizeof(id_text), "ID: %06X", id);
 
@@ -189,7 +202,7 @@ static void EPD_Draw_Text()
       y += TEXT_VIEW_LINE_SPACING;
 
       snprintf(info_line, sizeof(info_line), "CoG %3d deg",
-               (int) traffic_by_dist[EPD_current - 1].fop->course);
+               (int) target.course);
       display->getTextBounds(info_line, 0, 0, &tbx, &tby, &tbw, &tbh);
       y += tbh;
       display->setCursor(x, y);
@@ -37,6 +37,8 @@ void Web_fini()     {}
 #include "../protocol/data/NMEA.h"
 #include "../protocol/data/GDL90.h"
 #include "../protocol/data/D1090.h"
+#include "../system/Profile.h"
+#include "../system/Coverage.h"
 
 #if defined(ENABLE_AHRS)
 #include "../driver/AHRS.h"
@@ -575,7 +577,14 @@ void handleRoot() {
   char str_alt[16];
   char str_Vcc[8];
 
-  char *Root_temp = (char *) malloc(2300);
+  RF_stats_t *link = &RF_STATS(settings->rf_protocol);
+  uint32_t rejected = 0;
+
+  for (uint8_t r = 0; r < RF_REJECT_REASONS; r++) {
+    rejected += link->reject[r];
+  }
+
+  char *Root_temp = (char *) malloc(2700);
   if (Root_temp == NULL) {
     return;
   }
@@ -585,7 +594,7 @@ void handleRoot() {
   dtostrf(ThisAircraft.altitude, 7, 1, str_alt);
   dtostrf(vdd, 4, 2, str_Vcc);
 
-  snprintf_P ( Root_temp, 2300,
+  snprintf_P ( Root_temp, 2700,
     PSTR("<html>\
   <head>\
     <meta name='viewport' content='width=device-width, initial-scale=1'>\
@@ -622,6 +631,13 @@ void handleRoot() {
      <th align=left>Tx&nbsp;&nbsp;</th><td align=right>%u</td>\
      <th align=left>&nbsp;&nbsp;&nbsp;&nbsp;Rx&nbsp;&nbsp;</th><td align=right>%u</td>\
    </tr></table></td></tr>\
+   <tr><th align=left><a href='/stats'>Link</a></th>\
+    <td align=right><table><tr>\
+     <th align=left>CRC&nbsp;&nbsp;</th><td align=right>%u</td>\
+     <th align=left>&nbsp;&nbsp;FEC&nbsp;&nbsp;</th><td align=right>%u</td>\
+     <th align=left>&nbsp;&nbsp;Rejected&nbsp;&nbsp;</th><td align=right>%u</td>\
+     <th align=left>&nbsp;&nbsp;Deferred&nbsp;&nbsp;</th><td align=right>%u</td>\
+   </tr></table></td></tr>\
  </table>\
  <h2 align=center>Most recent GNSS fix</h2>\
  <table width=100%%>\
@@ -656,6 +672,7 @@ void handleRoot() {
     hr, min % 60, sec % 60, ESP.getFreeHeap(),
     low_voltage ? "red" : "green", str_Vcc,
     tx_packets_counter, rx_packets_counter,
+    link->crc_fail, link->fec_fail, rejected, link->tx_deferred,
     timestamp, sats, str_lat, str_lon, str_alt
   );
   SoC->swSer_enableRx(false);
@@ -790,6 +807,63 @@ void handleNotFound() {
   server.send ( 404, "text/plain", message );
 }
 
+/* Stage timings and radio link statistics, as one JSON object */
+void handleStats() {
+  size_t size = PROFILE_JSON_SIZE + RF_STATS_JSON_SIZE + 64;
+  char *Stats_temp = (char *) malloc(size);
+  size_t len, n;
+
+  if (Stats_temp == NULL) {
+    return;
+  }
+
+  len = snprintf_P(Stats_temp, size, PSTR("{\"class\":\"STATS\",\"profile\":"));
+  n = Profile_JSON(Stats_temp + len, size - len);
+  if (n > 0) {
+    len += n;
+    len += snprintf_P(Stats_temp + len, size - len, PSTR(",\"link\":"));
+    n = RF_Stats_JSON(Stats_temp + len, size - len);
+    len += n;
+  }
+
+  /* either part may not have fit, and half an object is no JSON */
+  if (n == 0) {
+    free(Stats_temp);
+    server.send ( 500, "text/plain", "Statistics do not fit the buffer\n" );
+    return;
+  }
+  snprintf_P(Stats_temp + len, size - len, PSTR("}"));
+
+  SoC->swSer_enableRx(false);
+  server.sendHeader(String(F("Cache-Control")), String(F("no-cache, no-store, must-revalidate")));
+  server.sendHeader(String(F("Pragma")), String(F("no-cache")));
+  server.sendHeader(String(F("Expires")), String(F("-1")));
+  server.send ( 200, "application/json", Stats_temp );
+  SoC->swSer_enableRx(true);
+  free(Stats_temp);
+}
+
+#if !defined(EXCLUDE_COVERAGE)
+/* Receiver coverage map, as JSON */
+void handleCoverage() {
+  char *Coverage_temp = (char *) malloc(COVERAGE_JSON_SIZE);
+
+  if (Coverage_temp == NULL) {
+    return;
+  }
+
+  Coverage_JSON(Coverage_temp, COVERAGE_JSON_SIZE);
+
+  SoC->swSer_enableRx(false);
+  server.sendHeader(String(F("Cache-Control")), String(F("no-cache, no-store, must-revalidate")));
+  server.sendHeader(String(F("Pragma")), String(F("no-cache")));
+  server.sendHeader(String(F("Expires")), String(F("-1")));
+  server.send ( 200, "application/json", Coverage_temp );
+  SoC->swSer_enableRx(true);
+  free(Coverage_temp);
+}
+#endif /* EXCLUDE_COVERAGE */
+
 void Web_setup()
 {
   server.on ( "/", handleRoot );
@@ -804,6 +878,10 @@ void Web_setup()
   } );
 
   server.on ( "/input", handleInput );
+  server.on ( "/stats", handleStats );
+#if !defined(EXCLUDE_COVERAGE)
+  server.on ( "/coverage", handleCoverage );
+#endif /* EXCLUDE_COVERAGE */
   server.on ( "/inline", []() {
     server.send ( 200, "text/plain", "this works as well" );
   } );
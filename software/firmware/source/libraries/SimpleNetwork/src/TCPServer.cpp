@@ -1,6 +1,7 @@
 #include "TCPServer.h" 
 
 string TCPServer::Message;
+int TCPServer::Notifier = -1;
 
 void* TCPServer::Task(void *arg)
 {
@@ -19,6 +20,10 @@ void* TCPServer::Task(void *arg)
 		msg[n]=0;
 		//send(newsockfd,msg,n,0);
 		Message = string(msg);
+		if (Notifier >= 0) {
+			uint64_t one = 1;
+			write(Notifier, &one, sizeof(one));
+		}
 	}
 	return 0;
 }
@@ -63,6 +68,12 @@ void TCPServer::clean()
 //	memset(msg, 0, MAXPACKETSIZE);
 }
 
+/* eventfd to be signalled whenever a new message has arrived */
+void TCPServer::notify(int fd)
+{
+	Notifier = fd;
+}
+
 void TCPServer::detach()
 {
 	close(sockfd);
@@ -39,6 +39,18 @@
 
 #include "TimeLib.h"
 
+#if defined(RASPBERRY_PI)
+#include <pthread.h>
+
+/* the clock is shared by the threads of the RPi pipeline */
+static pthread_mutex_t timeLock = PTHREAD_MUTEX_INITIALIZER;
+#define TIME_LOCK()   pthread_mutex_lock(&timeLock)
+#define TIME_UNLOCK() pthread_mutex_unlock(&timeLock)
+#else
+#define TIME_LOCK()
+#define TIME_UNLOCK()
+#endif /* RASPBERRY_PI */
+
 static tmElements_t tm;          // a cache of time elements
 static time_t cacheTime;   // the time the cache was updated
 static uint32_t syncInterval = 300;  // time sync will be attempted after this many seconds
@@ -252,6 +264,9 @@ time_t sysUnsyncedTime = 0; // the time sysTime unadjusted by sync
 
 
 time_t now() {
+  time_t t;
+
+  TIME_LOCK();
 	// calculate number of seconds passed since last call to now()
   while (millis() - prevMillis >= 1000) {
 		// millis() and prevMillis are both unsigned ints thus the subtraction will always be the absolute value of the difference
@@ -263,19 +278,26 @@ time_t now() {
   }
   if (nextSyncTime <= sysTime) {
     if (getTimePtr != 0) {
-      time_t t = getTimePtr();
+      TIME_UNLOCK();
+      t = getTimePtr();
       if (t != 0) {
         setTime(t);
       } else {
+        TIME_LOCK();
         nextSyncTime = sysTime + syncInterval;
         Status = (Status == timeNotSet) ?  timeNotSet : timeNeedsSync;
+        TIME_UNLOCK();
       }
+      return (time_t)sysTime;
     }
   }  
-  return (time_t)sysTime;
+  t = (time_t)sysTime;
+  TIME_UNLOCK();
+  return t;
 }
 
 void setTime(time_t t) { 
+  TIME_LOCK();
 #ifdef TIME_DRIFT_INFO
  if(sysUnsyncedTime == 0) 
    sysUnsyncedTime = t;   // store the time of the first call to set a valid Time   
@@ -285,6 +307,7 @@ void setTime(time_t t) {
   nextSyncTime = (uint32_t)t + syncInterval;
   Status = timeSet;
   prevMillis = millis();  // restart counting from now (thanks to Korman for this fix)
+  TIME_UNLOCK();
 } 
 
 void setTime(int hr,int min,int sec,int dy, int mnth, int yr){
@@ -15,6 +15,11 @@
 
 #if defined(RASPBERRY_PI)
 #include <raspi/raspi.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
 #endif /* RASPBERRY_PI */
 
 #if defined(ENERGIA_ARCH_CC13XX) || defined(ENERGIA_ARCH_CC13X2)
@@ -143,6 +148,84 @@ static void hal_interrupt_init() {
     }
 }
 
+#if defined(RASPBERRY_PI)
+// With no DIO mapped, the IRQ flags are still read over SPI, but the
+// edges of the radio IRQ line, timestamped by the kernel as they
+// happen, tell when. The line descriptor is also something to sleep on.
+#define HAL_GPIO_CHIP "/dev/gpiochip0"
+
+static int irq_fd = -1;
+static bool irq_pending = false;
+static ostime_t irq_ticks;
+
+int hal_irq_open (u1_t pin) {
+    struct gpioevent_request req;
+    int chip;
+
+    if (irq_fd >= 0)
+        return irq_fd;
+
+    chip = open(HAL_GPIO_CHIP, O_RDONLY | O_CLOEXEC);
+    if (chip < 0)
+        return -1;
+
+    memset(&req, 0, sizeof(req));
+    req.lineoffset  = pin;
+    req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    req.eventflags  = GPIOEVENT_REQUEST_RISING_EDGE;
+    strncpy(req.consumer_label, "SoftRF", sizeof(req.consumer_label) - 1);
+
+    if (ioctl(chip, GPIO_GET_LINEEVENT_IOCTL, &req) == 0) {
+        fcntl(req.fd, F_SETFL, fcntl(req.fd, F_GETFL) | O_NONBLOCK);
+        irq_fd = req.fd;
+    }
+    close(chip);
+
+    return irq_fd;
+}
+
+void hal_irq_close (void) {
+    if (irq_fd >= 0) {
+        close(irq_fd);
+        irq_fd = -1;
+    }
+    irq_pending = false;
+}
+
+// Microseconds elapsed since a kernel timestamp. Line events are stamped
+// with CLOCK_MONOTONIC since Linux 5.7 and with CLOCK_REALTIME before.
+static u4_t hal_irq_age (uint64_t stamp) {
+    static const clockid_t clocks[] = { CLOCK_MONOTONIC, CLOCK_REALTIME };
+    struct timespec ts;
+
+    for (uint8_t i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++) {
+        clock_gettime(clocks[i], &ts);
+
+        uint64_t now = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        if (now >= stamp && now - stamp < 1000000000ULL)
+            return (now - stamp) / 1000;
+    }
+    return 0;
+}
+
+// Take the latest edge off the line
+static void hal_irq_edges () {
+    struct gpioevent_data ev;
+    uint64_t stamp = 0;
+
+    if (irq_fd < 0)
+        return;
+
+    while (read(irq_fd, &ev, sizeof(ev)) == sizeof(ev))
+        stamp = ev.timestamp;
+
+    if (stamp) {
+        irq_ticks = hal_ticks() - (hal_irq_age(stamp) >> US_PER_OSTICK_EXPONENT);
+        irq_pending = true;
+    }
+}
+#endif /* RASPBERRY_PI */
+
 static bool dio_states[NUM_DIO] = {0};
 static void hal_io_check() {
     uint8_t i;
@@ -170,10 +253,21 @@ static void hal_io_check() {
 #endif
         }
     } else {
+#if defined(RASPBERRY_PI)
+        hal_irq_edges();
+
+        // Check IRQ flags in radio module
+        if ( radio_has_irq() ) {
+            radio_irq_handler(0, irq_pending ? irq_ticks : hal_ticks());
+        }
+        // an edge only dates the flags read right after it
+        irq_pending = false;
+#else
         // Check IRQ flags in radio module
         if ( radio_has_irq() ) {
             radio_irq_handler(0, hal_ticks());
         }
+#endif
     }
 
 }
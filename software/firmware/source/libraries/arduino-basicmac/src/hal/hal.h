@@ -61,4 +61,11 @@ typedef struct lmic_pinmap_struct {
 // Declared here, to be defined an initialized by the application
 extern lmic_pinmap lmic_pins;
 
+#if defined(RASPBERRY_PI)
+// Timestamp radio IRQs with the edges of this GPIO line (BCM numbering).
+// Returns a descriptor that becomes readable on an edge, or -1.
+int  hal_irq_open (u1_t pin);
+void hal_irq_close (void);
+#endif
+
 #endif // _hal_hal_h_
@@ -8,6 +8,7 @@
 #include <sys/time.h>
 #include <time.h>
 #include <assert.h>
+#include <sys/mman.h>
 #include "raspi.h"
 
 //Initialize the values for sanity
@@ -119,8 +120,9 @@ size_t TwoWire::write(uint8_t byte) {
 
 TwoWire Wire;
  
+/* GPIO is not mapped on a host without the BCM2835 peripherals */
 void pinMode(unsigned char pin, unsigned char mode) {
-  if (pin == LMIC_UNUSED_PIN) {
+  if (pin == LMIC_UNUSED_PIN || bcm2835_gpio == MAP_FAILED) {
     return;
   }
   if (mode == OUTPUT) {
@@ -131,14 +133,14 @@ void pinMode(unsigned char pin, unsigned char mode) {
 }
 
 void digitalWrite(unsigned char pin, unsigned char value) {
-  if (pin == LMIC_UNUSED_PIN) {
+  if (pin == LMIC_UNUSED_PIN || bcm2835_gpio == MAP_FAILED) {
     return;
   }
   bcm2835_gpio_write(pin, value);
 }
 
 unsigned char digitalRead(unsigned char pin) {
-  if (pin == LMIC_UNUSED_PIN) {
+  if (pin == LMIC_UNUSED_PIN || bcm2835_gpio == MAP_FAILED) {
     return 0;
   }
   return bcm2835_gpio_lev(pin);
@@ -0,0 +1,242 @@
+/*
+ * adb.cpp
+ * Copyright (C) 2021 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compiles an aircraft table into the read-only format that SkyView
+ * looks registrations up in (see SkyView/ADBHelper.h):
+ *
+ *   $ c++ -O2 -o adb adb.cpp
+ *   $ sqlite3 -separator "$(printf '\t')" fln.db \
+ *       "select id, registration, tail, type from aircrafts" | ./adb fln.adb
+ *
+ * Input is one aircraft per line: ID, then its labels in the order of
+ * idpref (registration, tail, model), separated by tabs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../firmware/source/SkyView/ADBHelper.h"
+
+#define ADB_LAMBDA  4       /* aircraft per hash bucket, on average */
+#define ADB_SEEDS   64      /* tries with another seed before giving up */
+
+typedef struct Record_struct {
+  uint32_t    id;
+  std::string label[ADB_FIELDS];
+} Record_t;
+
+/*
+ * Hash and displace: the largest buckets go first, each one with the
+ * smallest displacement that puts all of its IDs into free slots.
+ */
+static bool ADB_place(const std::vector<Record_t> &recs, ADB_header_t *hdr,
+                      std::vector<uint16_t> &disp, std::vector<uint32_t> &slot_rec)
+{
+  std::vector<std::vector<uint32_t> > bucket(hdr->buckets);
+  std::vector<uint32_t> order(hdr->buckets);
+  std::vector<bool> taken(hdr->count, false);
+  std::vector<uint32_t> pos;
+
+  for (uint32_t i = 0; i < recs.size(); i++) {
+    bucket[ADB_hash(recs[i].id, hdr->seed) % hdr->buckets].push_back(i);
+  }
+  for (uint32_t b = 0; b < hdr->buckets; b++) {
+    order[b] = b;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return bucket[a].size() > bucket[b].size();
+  });
+
+  disp.assign(hdr->buckets, 0);
+  slot_rec.assign(hdr->count, 0);
+
+  for (uint32_t b : order) {
+    bool placed = false;
+
+    if (bucket[b].empty()) {
+      break;
+    }
+
+    for (uint32_t d = 0; d <= 0xFFFF && !placed; d++) {
+      placed = true;
+      pos.clear();
+
+      for (uint32_t r : bucket[b]) {
+        uint32_t s = ADB_slot(hdr, recs[r].id, d);
+
+        if (taken[s] || std::find(pos.begin(), pos.end(), s) != pos.end()) {
+          placed = false;
+          break;
+        }
+        pos.push_back(s);
+      }
+
+      if (placed) {
+        disp[b] = d;
+        for (size_t j = 0; j < pos.size(); j++) {
+          taken[pos[j]] = true;
+          slot_rec[pos[j]] = bucket[b][j];
+        }
+      }
+    }
+
+    if (!placed) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  std::map<uint32_t, Record_t> table;
+  std::string line;
+  unsigned long skipped = 0;
+
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s OUTPUT < TSV\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  while (std::getline(std::cin, line)) {
+    Record_t rec;
+    char *end;
+    size_t start = 0, tab;
+    int field = -1;
+
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+      line.erase(line.size() - 1);
+    }
+
+    do {
+      tab = line.find('\t', start);
+      std::string value = line.substr(start, tab == std::string::npos ? std::string::npos : tab - start);
+
+      if (field < 0) {
+        rec.id = strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end || rec.id > 0xFFFFFF) {
+          break;
+        }
+      } else if (field < ADB_FIELDS) {
+        rec.label[field] = value.substr(0, ADB_LABEL_MAX - 1);
+      }
+      field++;
+      start = tab + 1;
+    } while (tab != std::string::npos);
+
+    if (field < 1) {
+      skipped++;
+      continue;
+    }
+    table[rec.id] = rec;    /* the last one of an ID wins */
+  }
+
+  std::vector<Record_t> recs;
+  for (auto &entry : table) {
+    recs.push_back(entry.second);
+  }
+
+  if (recs.empty()) {
+    fprintf(stderr, "no aircraft in the input\n");
+    return EXIT_FAILURE;
+  }
+
+  ADB_header_t hdr;
+  std::vector<uint16_t> disp;
+  std::vector<uint32_t> slot_rec;
+  int tries;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic   = ADB_MAGIC;
+  hdr.version = ADB_VERSION;
+  hdr.fields  = ADB_FIELDS;
+  hdr.count   = recs.size();
+  hdr.buckets = recs.size() / ADB_LAMBDA + 1;
+
+  for (tries = 0; tries < ADB_SEEDS; tries++) {
+    hdr.seed = ADB_hash(tries, 0x5EED5EED);
+    if (ADB_place(recs, &hdr, disp, slot_rec)) {
+      break;
+    }
+  }
+  if (tries == ADB_SEEDS) {
+    fprintf(stderr, "no perfect hash found\n");
+    return EXIT_FAILURE;
+  }
+
+  /* strings: each distinct one once, the empty one at 0 */
+  std::string strings(1, '\0');
+  std::map<std::string, uint32_t> str_offset;
+  std::vector<ADB_slot_t> slots(hdr.count);
+
+  str_offset[""] = 0;
+  for (uint32_t s = 0; s < hdr.count; s++) {
+    const Record_t &rec = recs[slot_rec[s]];
+
+    slots[s].id = rec.id;
+    for (int f = 0; f < ADB_FIELDS; f++) {
+      auto it = str_offset.find(rec.label[f]);
+
+      if (it == str_offset.end()) {
+        it = str_offset.insert(std::make_pair(rec.label[f], (uint32_t) strings.size())).first;
+        strings.append(rec.label[f]);
+        strings.push_back('\0');
+      }
+      slots[s].label[f] = it->second;
+    }
+  }
+
+  hdr.disp_offset = sizeof(hdr);
+  hdr.slot_offset = (hdr.disp_offset + hdr.buckets * sizeof(uint16_t) + 3) & ~3U;
+  hdr.str_offset  = hdr.slot_offset + hdr.count * sizeof(ADB_slot_t);
+  hdr.str_size    = strings.size();
+
+  FILE *out = fopen(argv[1], "wb");
+  if (out == NULL) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  static const char pad[4] = { 0 };
+
+  fwrite(&hdr, sizeof(hdr), 1, out);
+  fwrite(disp.data(), sizeof(uint16_t), disp.size(), out);
+  fwrite(pad, 1, hdr.slot_offset - (hdr.disp_offset + hdr.buckets * sizeof(uint16_t)), out);
+  fwrite(slots.data(), sizeof(ADB_slot_t), slots.size(), out);
+  fwrite(strings.data(), 1, strings.size(), out);
+
+  if (fclose(out) != 0) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  fprintf(stderr, "%s: %u aircraft, %u buckets, seed #%d, %u bytes of labels, %u bytes total (%lu lines skipped)\n",
+          argv[1], hdr.count, hdr.buckets, tries, hdr.str_size,
+          hdr.str_offset + hdr.str_size, skipped);
+
+  return EXIT_SUCCESS;
+}
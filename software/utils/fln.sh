@@ -25,12 +25,19 @@ SQL=sql/$FILENAME.sql
 
 CSV=$FILENAME.csv
 DB=$FILENAME.db
+ADB=$FILENAME.adb
+
+# compiled copy of the labels that SkyView looks up: ID, registration, tail, model
+ADB_SELECT="select id, registration, tail, type from aircrafts"
+TAB=$(printf '\t')
 
 FLNJSON="./flarm-db.pl"
 RAW=data.fln
 
-rm -f $CSV $DB
+rm -f $CSV $DB $ADB
+[ -x ./adb ] || c++ -O2 -o adb adb.cpp
 
 $FLNJSON | grep registration | jq -r '[._id,.owner,.airport,.type,.registration,.tail,.radio | tostring] | @csv' | gawk -f $GAWK > $CSV
 sqlite3 -init $SQL $DB .exit
+sqlite3 -separator "$TAB" $DB "$ADB_SELECT" | ./adb $ADB
 rm -f $CSV $RAW
@@ -25,11 +25,18 @@ SQL=sql/$FILENAME.sql
 
 CSV=$FILENAME.csv
 DB=$FILENAME.db
+ADB=$FILENAME.adb
+
+# compiled copy of the labels that SkyView looks up: ID, registration, tail, model
+ADB_SELECT="select id, registration, owner, type from aircrafts"
+TAB=$(printf '\t')
 
 ICAOCSV="cat ICAO.csv"
 
-rm -f $CSV $DB
+rm -f $CSV $DB $ADB
+[ -x ./adb ] || c++ -O2 -o adb adb.cpp
 
 $ICAOCSV | gawk -f $GAWK > $CSV
 sqlite3 -init $SQL $DB .exit
+sqlite3 -separator "$TAB" $DB "$ADB_SELECT" | ./adb $ADB
 rm -f $CSV
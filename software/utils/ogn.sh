@@ -25,10 +25,17 @@ SQL=sql/$FILENAME.sql
 
 CSV=$FILENAME.csv
 DB=$FILENAME.db
+ADB=$FILENAME.adb
+
+# compiled copy of the labels that SkyView looks up: ID, registration, tail, model
+ADB_SELECT="select id, acreg, accn, acmodel from devices"
+TAB=$(printf '\t')
 
 URL="http://ddb.glidernet.org/download/?t=1"
 
-rm -f $CSV $DB
+rm -f $CSV $DB $ADB
+[ -x ./adb ] || c++ -O2 -o adb adb.cpp
 wget -q -O - $URL | tail -n +2 | gawk -f $GAWK > $CSV
 sqlite3 -init $SQL $DB .exit
+sqlite3 -separator "$TAB" $DB "$ADB_SELECT" | ./adb $ADB
 rm -f $CSV